@@ -0,0 +1,113 @@
+#include "pch.h"
+#include "AsyncLog.h"
+#include <chrono>
+
+AsyncLog& AsyncLog::instance() {
+    static AsyncLog log;
+    return log;
+}
+
+AsyncLog::AsyncLog() {
+    for (size_t i = 0; i < CAPACITY; ++i) {
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+AsyncLog::~AsyncLog() {
+    stop();
+}
+
+void AsyncLog::start(Sink sink) {
+    if (running_.load()) {
+        return;
+    }
+
+    sink_ = std::move(sink);
+    running_.store(true);
+    drainThread_ = std::make_unique<std::thread>(&AsyncLog::drainLoop, this);
+}
+
+void AsyncLog::stop() {
+    if (!running_.load()) {
+        return;
+    }
+
+    running_.store(false);
+    if (drainThread_ && drainThread_->joinable()) {
+        drainThread_->join();
+    }
+    drainThread_.reset();
+
+    // Flush anything pushed after the thread's last pass
+    drain();
+    sink_ = nullptr;
+}
+
+void AsyncLog::setThreadTuning(const ThreadTuning& tuning) {
+    std::lock_guard<std::mutex> lock(tuningMutex_);
+    if (!(tuning == tuning_)) {
+        tuning_ = tuning;
+        tuningChanged_.store(true);
+    }
+}
+
+void AsyncLog::drainLoop() {
+    while (running_.load()) {
+        if (tuningChanged_.exchange(false)) {
+            ThreadTuning tuning;
+            {
+                std::lock_guard<std::mutex> lock(tuningMutex_);
+                tuning = tuning_;
+            }
+            tuning.applyToCurrentThread("log");
+        }
+
+        // Producers never signal; polling keeps push() free of syscalls
+        if (drain() == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    }
+}
+
+size_t AsyncLog::drain() {
+    static const char* levelPrefixes[] = { "[debug] ", "", "[warn] ", "[error] ", "" };
+
+    size_t drained = 0;
+    std::string line;
+    for (;;) {
+        Cell& cell = cells_[head_ & (CAPACITY - 1)];
+        if (cell.sequence.load(std::memory_order_acquire) != head_ + 1) {
+            break; // Empty, or the producer hasn't finished writing this slot
+        }
+
+        Record& record = cell.record;
+        std::string message;
+        try {
+            record.render(record, message);
+        }
+        catch (const std::exception& e) {
+            message = std::string("log format error: ") + e.what();
+        }
+
+        line = levelPrefixes[static_cast<size_t>(record.level)];
+        line += message;
+        if (uint32_t suppressed = record.site->takeSuppressed()) {
+            line += " (" + std::to_string(suppressed) + " similar lines suppressed)";
+        }
+
+        cell.sequence.store(head_ + CAPACITY, std::memory_order_release);
+        ++head_;
+        ++drained;
+
+        if (sink_) {
+            sink_(line);
+        }
+    }
+
+    size_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped != reportedDropped_ && sink_) {
+        sink_("[warn] async log full, dropped " + std::to_string(dropped - reportedDropped_) + " lines");
+        reportedDropped_ = dropped;
+    }
+    return drained;
+}
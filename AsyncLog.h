@@ -0,0 +1,211 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include "ThreadTuning.h"
+
+// Lines below this level are compiled out entirely (0 = debug, 1 = info, 2 = warn, 3 = error)
+#ifndef SIXMANS_MIN_LOG_LEVEL
+#define SIXMANS_MIN_LOG_LEVEL 1
+#endif
+
+enum class LogLevel : uint8_t {
+    Debug = 0,
+    Info = 1,
+    Warn = 2,
+    Error = 3,
+    Off = 4
+};
+
+// Asynchronous logger for hot paths.
+//
+// ASYNC_LOG copies its arguments into a slot of a bounded lock-free ring and
+// returns; formatting and the write to the console happen later on the drain
+// thread. Each call site has its own per-second budget so a chatty server can't
+// flood the console, and when the ring is full lines are dropped (and counted)
+// rather than blocking the caller. Use plain LOG for cold paths.
+class AsyncLog {
+public:
+    static constexpr size_t CAPACITY = 1024;           // Power of two
+    static constexpr size_t ARG_STORAGE = 128;         // Bytes of inline argument storage per line
+
+    using Sink = std::function<void(const std::string& line)>;
+
+    // Per call-site rate limiter: at most maxPerSecond lines per wall-clock second
+    class SiteLimiter {
+    public:
+        explicit SiteLimiter(uint32_t maxPerSecond) : maxPerSecond_(maxPerSecond) {}
+
+        bool allow() {
+            uint64_t second = currentSecond();
+            uint64_t window = window_.load(std::memory_order_relaxed);
+            if (second != window && window_.compare_exchange_strong(window, second, std::memory_order_relaxed)) {
+                uint32_t suppressed = count_.exchange(0, std::memory_order_relaxed);
+                if (suppressed > maxPerSecond_) {
+                    suppressed_.fetch_add(suppressed - maxPerSecond_, std::memory_order_relaxed);
+                }
+            }
+            return count_.fetch_add(1, std::memory_order_relaxed) < maxPerSecond_;
+        }
+
+        // Lines suppressed since the last call
+        uint32_t takeSuppressed() {
+            return suppressed_.exchange(0, std::memory_order_relaxed);
+        }
+
+    private:
+        static uint64_t currentSecond() {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        const uint32_t maxPerSecond_;
+        std::atomic<uint64_t> window_{ 0 };
+        std::atomic<uint32_t> count_{ 0 };
+        std::atomic<uint32_t> suppressed_{ 0 };
+    };
+
+    static AsyncLog& instance();
+
+    // Start the drain thread; lines are handed to sink one at a time
+    void start(Sink sink);
+
+    // Drain whatever is left and stop the drain thread
+    void stop();
+
+    // CPU affinity and priority for the drain thread, applied on its next pass
+    void setThreadTuning(const ThreadTuning& tuning);
+
+    void setLevel(LogLevel level) {
+        level_.store(level, std::memory_order_relaxed);
+    }
+
+    bool enabled(LogLevel level) const {
+        return level >= level_.load(std::memory_order_relaxed);
+    }
+
+    size_t droppedCount() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    // Enqueue a line. format must outlive the drain (string literals do).
+    template<typename... Args>
+    void push(LogLevel level, SiteLimiter& site, std::string_view format, Args&&... args) {
+        size_t position = tail_.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells_[position & (CAPACITY - 1)];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (diff < 0) {
+                dropped_.fetch_add(1, std::memory_order_relaxed); // Ring full
+                return;
+            }
+            else {
+                position = tail_.load(std::memory_order_relaxed);
+            }
+        }
+
+        Record& record = cell->record;
+        record.level = level;
+        record.site = &site;
+        store(record, format, std::forward<Args>(args)...);
+        cell->sequence.store(position + 1, std::memory_order_release);
+    }
+
+private:
+    struct Record {
+        LogLevel level = LogLevel::Info;
+        SiteLimiter* site = nullptr;
+        std::string_view format;
+        void (*render)(Record& record, std::string& out) = nullptr; // Formats, then destroys the arguments
+        alignas(std::max_align_t) unsigned char args[ARG_STORAGE];
+    };
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        Record record;
+    };
+
+    AsyncLog();
+    ~AsyncLog();
+
+    // C strings are copied: the pointer may not outlive the call (c_str(), what())
+    template<typename T>
+    using Captured = std::conditional_t<
+        std::is_same_v<std::decay_t<T>, const char*> || std::is_same_v<std::decay_t<T>, char*>,
+        std::string, std::decay_t<T>>;
+
+    template<typename... Args>
+    static void store(Record& record, std::string_view format, Args&&... args) {
+        using Tuple = std::tuple<Captured<Args>...>;
+        if constexpr (sizeof(Tuple) <= ARG_STORAGE && alignof(Tuple) <= alignof(std::max_align_t)) {
+            new (record.args) Tuple(std::forward<Args>(args)...);
+            record.format = format;
+            record.render = [](Record& r, std::string& out) {
+                Tuple* tuple = std::launder(reinterpret_cast<Tuple*>(r.args));
+                struct Destroy {
+                    Tuple* tuple;
+                    ~Destroy() { tuple->~Tuple(); }
+                } destroy{ tuple };
+                std::apply([&](auto&... values) {
+                    out = std::vformat(r.format, std::make_format_args(values...));
+                    }, *tuple);
+            };
+        }
+        else {
+            // Too big to defer: format now and keep only the result
+            store(record, "{}", std::vformat(format, std::make_format_args(args...)));
+        }
+    }
+
+    void drainLoop();
+    size_t drain();
+
+    std::array<Cell, CAPACITY> cells_;
+    alignas(64) std::atomic<size_t> tail_{ 0 };
+    alignas(64) size_t head_ = 0; // Drain thread only
+
+    std::atomic<LogLevel> level_{ static_cast<LogLevel>(SIXMANS_MIN_LOG_LEVEL) };
+    std::atomic<size_t> dropped_{ 0 };
+    size_t reportedDropped_ = 0;
+
+    Sink sink_;
+    std::atomic<bool> running_{ false };
+    std::unique_ptr<std::thread> drainThread_;
+
+    std::mutex tuningMutex_;
+    ThreadTuning tuning_;                       // Guarded by tuningMutex_
+    std::atomic<bool> tuningChanged_{ false };
+};
+
+#define ASYNC_LOG_AT(level, maxPerSecond, ...) \
+    do { \
+        if constexpr (static_cast<int>(level) >= SIXMANS_MIN_LOG_LEVEL) { \
+            static AsyncLog::SiteLimiter asyncLogSite_(maxPerSecond); \
+            if (AsyncLog::instance().enabled(level) && asyncLogSite_.allow()) { \
+                AsyncLog::instance().push(level, asyncLogSite_, __VA_ARGS__); \
+            } \
+        } \
+    } while (0)
+
+// Default budget of 10 lines per second per call site
+#define ASYNC_LOG(level, ...) ASYNC_LOG_AT(level, 10, __VA_ARGS__)
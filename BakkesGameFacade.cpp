@@ -0,0 +1,221 @@
+#include "pch.h"
+#include "BakkesGameFacade.h"
+#include "logging.h"
+
+namespace {
+    Region parseRegion(const std::string& region) {
+        if (region == "USW") return Region::USW;
+        if (region == "EU") return Region::EU;
+        if (region == "OCE") return Region::OCE;
+        if (region == "SAM") return Region::SAM;
+        if (region == "ME") return Region::ME;
+        if (region == "ASC") return Region::ASC;
+        if (region == "ASM") return Region::ASM;
+        if (region == "JPN") return Region::JPN;
+        if (region == "SAF") return Region::SAF;
+        return Region::USE;
+    }
+
+    CustomMatchSettings buildMatchSettings(const PrivateMatchRequest& request) {
+        // Configure match settings
+        CustomMatchSettings matchSettings;
+        matchSettings.MapName = request.mapName;
+        matchSettings.ServerName = request.serverName;
+        matchSettings.Password = request.password;
+        matchSettings.GameMode = 0;
+        matchSettings.GameTags = "BotsNone,PlayerCount3";
+
+        // Set team settings
+        matchSettings.BlueTeamSettings.Name = "Team 1";
+        matchSettings.OrangeTeamSettings.Name = "Team 2";
+        return matchSettings;
+    }
+
+    // The region and CustomMatchSettings, ready to hand to CreatePrivateMatch
+    class BakkesPreparedMatch : public PreparedMatch {
+    public:
+        explicit BakkesPreparedMatch(const PrivateMatchRequest& request)
+            : PreparedMatch(request), region(parseRegion(request.region)), settings(buildMatchSettings(request)) {}
+
+        Region region;
+        CustomMatchSettings settings;
+    };
+
+    // Parameters of GFxHUD_TA.HandleStatTickerMessage
+    struct StatTickerParams {
+        uintptr_t receiver;     // PRI_TA that got the stat
+        uintptr_t victim;       // PRI_TA on the other end, for demolitions
+        uintptr_t statEvent;    // StatEvent_TA
+    };
+
+    int parseStatKind(const std::string& eventName) {
+        if (eventName == "Goal") return static_cast<int>(StatKind::Goal);
+        if (eventName == "Assist") return static_cast<int>(StatKind::Assist);
+        if (eventName == "Save") return static_cast<int>(StatKind::Save);
+        if (eventName == "EpicSave") return static_cast<int>(StatKind::EpicSave);
+        if (eventName == "Shot") return static_cast<int>(StatKind::Shot);
+        if (eventName == "Demolish") return static_cast<int>(StatKind::Demolition);
+        return -1;
+    }
+
+    int teamOf(int teamNum) {
+        return teamNum == 0 || teamNum == 1 ? teamNum : -1;
+    }
+}
+
+BakkesGameFacade::BakkesGameFacade(std::shared_ptr<GameWrapper> gameWrapper)
+    : gameWrapper_(std::move(gameWrapper)) {}
+
+IGameFacade::Clock::time_point BakkesGameFacade::now() const {
+    return Clock::now();
+}
+
+void BakkesGameFacade::execute(Callback callback) {
+    gameWrapper_->Execute([callback = std::move(callback)](GameWrapper*) {
+        callback();
+        });
+}
+
+void BakkesGameFacade::setTimeout(Callback callback, float seconds) {
+    gameWrapper_->SetTimeout([callback = std::move(callback)](GameWrapper*) {
+        callback();
+        }, seconds);
+}
+
+void BakkesGameFacade::hookEvent(const std::string& eventName, HookCallback callback) {
+    gameWrapper_->HookEvent(eventName, [callback = std::move(callback)](std::string name) {
+        callback(name);
+        });
+}
+
+bool BakkesGameFacade::isInOnlineGame() const {
+    return gameWrapper_->IsInOnlineGame();
+}
+
+bool BakkesGameFacade::isGameReady() const {
+    // Matchmaking is the last thing lobby handling needs to come up
+    return !gameWrapper_->GetMatchmakingWrapper().IsNull();
+}
+
+void BakkesGameFacade::hookStatEvents(StatCallback callback) {
+    gameWrapper_->HookEventWithCallerPost<ServerWrapper>("Function TAGame.GFxHUD_TA.HandleStatTickerMessage",
+        [this, callback = std::move(callback)](ServerWrapper, void* params, std::string) {
+            const StatTickerParams* ticker = static_cast<const StatTickerParams*>(params);
+            if (!ticker || !ticker->statEvent) {
+                return;
+            }
+            int kind = statKind(ticker->statEvent);
+            if (kind < 0) {
+                return;
+            }
+            int team = -1;
+            if (ticker->receiver) {
+                team = teamOf(PriWrapper(ticker->receiver).GetTeamNum2());
+            }
+            callback(StatEvent{ static_cast<StatKind>(kind), ticker->receiver, team });
+        });
+}
+
+int BakkesGameFacade::statKind(uintptr_t statEvent) {
+    for (size_t i = 0; i < statKindCount_; ++i) {
+        if (statKinds_[i].first == statEvent) {
+            return statKinds_[i].second;
+        }
+    }
+    int kind = parseStatKind(StatEventWrapper(statEvent).GetEventName());
+    if (statKindCount_ < statKinds_.size()) {
+        statKinds_[statKindCount_++] = { statEvent, kind };
+    }
+    return kind;
+}
+
+void BakkesGameFacade::hookCarStates(HookProfiler& profiler, size_t hook, CarStateFilter wanted,
+    CarStateCallback callback) {
+    gameWrapper_->HookEventWithCaller<CarWrapper>("Function TAGame.Car_TA.SetVehicleInput",
+        [&profiler, hook, wanted = std::move(wanted), callback = std::move(callback)](CarWrapper car, void*, std::string) {
+            // The wrapper reads are most of the cost; menus and other matches skip them
+            HookProfiler::Scope scope(profiler, hook);
+            if (!wanted() || car.IsNull()) {
+                return;
+            }
+            PriWrapper pri = car.GetPRI();
+            BoostWrapper boost = car.GetBoostComponent();
+            Vector location = car.GetLocation();
+            Vector velocity = car.GetVelocity();
+            callback(CarState{
+                pri.IsNull() ? 0 : pri.memory_address,
+                { location.X, location.Y, location.Z },
+                { velocity.X, velocity.Y, velocity.Z },
+                boost.IsNull() ? 0.0f : boost.GetCurrentBoostAmount() });
+        });
+}
+
+bool BakkesGameFacade::readMatchResult(MatchResult& result) const {
+    ServerWrapper server = gameWrapper_->GetOnlineGame();
+    if (server.IsNull()) {
+        return false;
+    }
+
+    result.matchGuid = server.GetMatchGUID();
+    GameSettingPlaylistWrapper playlist = server.GetPlaylist();
+    result.privateMatch = !playlist.IsNull()
+        && playlist.GetPlaylistId() == static_cast<int>(PlaylistIds::PrivateMatch);
+
+    ArrayWrapper<TeamWrapper> teams = server.GetTeams();
+    for (int i = 0; i < teams.Count(); ++i) {
+        TeamWrapper team = teams.Get(i);
+        int index = team.IsNull() ? -1 : teamOf(team.GetTeamIndex());
+        if (index >= 0) {
+            result.teamScore[index] = team.GetScore();
+        }
+    }
+
+    ArrayWrapper<PriWrapper> pris = server.GetPRIs();
+    for (int i = 0; i < pris.Count(); ++i) {
+        PriWrapper pri = pris.Get(i);
+        if (pri.IsNull() || teamOf(pri.GetTeamNum2()) < 0) {
+            continue;
+        }
+        PlayerResult player;
+        player.player = pri.memory_address;
+        player.name = pri.GetPlayerName().ToString();
+        player.platformId = pri.GetUniqueIdWrapper().GetIdString();
+        player.team = teamOf(pri.GetTeamNum2());
+        player.score = pri.GetMatchScore();
+        player.goals = pri.GetMatchGoals();
+        player.assists = pri.GetMatchAssists();
+        player.saves = pri.GetMatchSaves();
+        player.shots = pri.GetMatchShots();
+        player.demolitions = pri.GetMatchDemolishes();
+        result.players.push_back(std::move(player));
+    }
+    return true;
+}
+
+bool BakkesGameFacade::joinPrivateMatch(const std::string& lobbyName, const std::string& password) {
+    // Get MatchmakingWrapper dynamically to avoid crashes
+    MatchmakingWrapper matchmaking = gameWrapper_->GetMatchmakingWrapper();
+    if (matchmaking.IsNull()) {
+        return false;
+    }
+    matchmaking.JoinPrivateMatch(lobbyName, password);
+    return true;
+}
+
+std::unique_ptr<PreparedMatch> BakkesGameFacade::prepareMatch(const PrivateMatchRequest& request) {
+    return std::make_unique<BakkesPreparedMatch>(request);
+}
+
+bool BakkesGameFacade::createPrivateMatch(const PreparedMatch& match) {
+    MatchmakingWrapper matchmaking = gameWrapper_->GetMatchmakingWrapper();
+    if (matchmaking.IsNull()) {
+        LOG("MatchmakingWrapper is NULL!");
+        return false;
+    }
+
+    // Only this facade makes them
+    const BakkesPreparedMatch& prepared = static_cast<const BakkesPreparedMatch&>(match);
+    LOG("Creating match {} on {}...", match.request().serverName, match.request().mapName);
+    matchmaking.CreatePrivateMatch(prepared.region, static_cast<int>(PlaylistIds::PrivateMatch), prepared.settings);
+    return true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "pch.h"
+#include "GameFacade.h"
+#include <array>
+#include <memory>
+#include <utility>
+
+// IGameFacade backed by BakkesMod
+class BakkesGameFacade : public IGameFacade {
+public:
+    explicit BakkesGameFacade(std::shared_ptr<GameWrapper> gameWrapper);
+
+    // Non-copyable
+    BakkesGameFacade(const BakkesGameFacade&) = delete;
+    BakkesGameFacade& operator=(const BakkesGameFacade&) = delete;
+
+    Clock::time_point now() const override;
+    void execute(Callback callback) override;
+    void setTimeout(Callback callback, float seconds) override;
+    void hookEvent(const std::string& eventName, HookCallback callback) override;
+    bool isInOnlineGame() const override;
+    bool isGameReady() const override;
+    void hookStatEvents(StatCallback callback) override;
+    void hookCarStates(HookProfiler& profiler, size_t hook, CarStateFilter wanted,
+        CarStateCallback callback) override;
+    bool readMatchResult(MatchResult& result) const override;
+    bool joinPrivateMatch(const std::string& lobbyName, const std::string& password) override;
+    std::unique_ptr<PreparedMatch> prepareMatch(const PrivateMatchRequest& request) override;
+    bool createPrivateMatch(const PreparedMatch& match) override;
+
+private:
+    // Which StatKind a StatEvent_TA object stands for, -1 for one we ignore
+    int statKind(uintptr_t statEvent);
+
+    std::shared_ptr<GameWrapper> gameWrapper_;
+
+    // StatEvent_TA objects live as long as the game; their names (a string
+    // allocation each) are looked up once and remembered by address
+    std::array<std::pair<uintptr_t, int>, 32> statKinds_{};
+    size_t statKindCount_ = 0;
+};
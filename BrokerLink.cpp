@@ -0,0 +1,501 @@
+#include "pch.h"
+#include "BrokerLink.h"
+#include "logging.h"
+#include <chrono>
+#include <cstring>
+#include <nlohmann/json.hpp>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <afunix.h>
+#include <windows.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using json = nlohmann::json;
+using namespace BrokerProtocol;
+
+namespace {
+    constexpr uintptr_t INVALID_HANDLE = ~uintptr_t{ 0 };
+    constexpr uint32_t MAX_CONTROL_FRAME = 64 * 1024;   // Payloads go through the rings, not here
+    constexpr int SEND_STALL_TIMEOUT_MS = 1000;
+
+#ifdef _WIN32
+    using NativeSocket = SOCKET;
+    using PollEntry = WSAPOLLFD;
+    constexpr int SEND_FLAGS = 0;
+
+    bool startSockets() {
+        static const bool started = []() {
+            WSADATA data;
+            return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+        }();
+        return started;
+    }
+
+    void closeSocket(NativeSocket socket) { closesocket(socket); }
+    bool setNonBlocking(NativeSocket socket) { u_long mode = 1; return ioctlsocket(socket, FIONBIO, &mode) == 0; }
+    bool wouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+    int lastSocketError() { return WSAGetLastError(); }
+    int pollSockets(PollEntry* entries, size_t count, int timeoutMs) { return WSAPoll(entries, static_cast<ULONG>(count), timeoutMs); }
+    void removeSocketFile(const std::string& path) { DeleteFileA(path.c_str()); }
+#else
+    using NativeSocket = int;
+    using PollEntry = pollfd;
+    constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+
+    bool startSockets() { return true; }
+    void closeSocket(NativeSocket socket) { ::close(socket); }
+    bool setNonBlocking(NativeSocket socket) { return fcntl(socket, F_SETFL, fcntl(socket, F_GETFL) | O_NONBLOCK) == 0; }
+    bool wouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR; }
+    int lastSocketError() { return errno; }
+    int pollSockets(PollEntry* entries, size_t count, int timeoutMs) { return ::poll(entries, count, timeoutMs); }
+    void removeSocketFile(const std::string& path) { ::unlink(path.c_str()); }
+#endif
+
+    NativeSocket native(uintptr_t handle) {
+        return static_cast<NativeSocket>(handle);
+    }
+
+    bool makeAddress(const std::string& path, sockaddr_un& address) {
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+            LOG("Broker socket path '{}' is empty or too long", path);
+            return false;
+        }
+        std::memcpy(address.sun_path, path.c_str(), path.size());
+        return true;
+    }
+}
+
+LocalSocket::LocalSocket(uintptr_t handle, std::string listenPath)
+    : handle_(handle), listenPath_(std::move(listenPath)) {}
+
+LocalSocket::~LocalSocket() {
+    if (handle_ != INVALID_HANDLE) {
+        closeSocket(native(handle_));
+    }
+    if (!listenPath_.empty()) {
+        removeSocketFile(listenPath_);
+    }
+}
+
+std::unique_ptr<LocalSocket> LocalSocket::listen(const std::string& path) {
+    sockaddr_un address;
+    if (!startSockets() || !makeAddress(path, address)) {
+        return nullptr;
+    }
+
+    NativeSocket socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (static_cast<uintptr_t>(socket) == INVALID_HANDLE) {
+        LOG("Could not create the broker socket (error {})", lastSocketError());
+        return nullptr;
+    }
+
+    removeSocketFile(path); // Left behind by a broker that didn't exit cleanly
+    if (::bind(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+        || ::listen(socket, 16) != 0 || !setNonBlocking(socket)) {
+        LOG("Could not listen on {} (error {})", path, lastSocketError());
+        closeSocket(socket);
+        return nullptr;
+    }
+    return std::unique_ptr<LocalSocket>(new LocalSocket(static_cast<uintptr_t>(socket), path));
+}
+
+std::unique_ptr<LocalSocket> LocalSocket::connect(const std::string& path) {
+    sockaddr_un address;
+    if (!startSockets() || !makeAddress(path, address)) {
+        return nullptr;
+    }
+
+    NativeSocket socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (static_cast<uintptr_t>(socket) == INVALID_HANDLE) {
+        return nullptr;
+    }
+
+    // Local connects complete (or fail) immediately; only then go non-blocking
+    if (::connect(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || !setNonBlocking(socket)) {
+        closeSocket(socket);
+        return nullptr;
+    }
+    return std::unique_ptr<LocalSocket>(new LocalSocket(static_cast<uintptr_t>(socket)));
+}
+
+bool LocalSocket::makePair(std::unique_ptr<LocalSocket>& first, std::unique_ptr<LocalSocket>& second) {
+#ifdef _WIN32
+    // No socketpair here; connect through a throwaway listener instead
+    static std::atomic<unsigned> pairCount{ 0 };
+    char tempDir[MAX_PATH];
+    DWORD length = GetTempPathA(MAX_PATH, tempDir);
+    if (length == 0 || length >= MAX_PATH) {
+        return false;
+    }
+    std::string path = std::string(tempDir) + "sixmans-" + std::to_string(GetCurrentProcessId())
+        + "-pair" + std::to_string(pairCount.fetch_add(1)) + ".sock";
+    std::unique_ptr<LocalSocket> listener = listen(path); // Removes the file again on the way out
+    if (!listener) {
+        return false;
+    }
+    second = connect(path);
+    first = second ? listener->accept() : nullptr;
+#else
+    NativeSocket sockets[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+        return false;
+    }
+    first.reset(new LocalSocket(static_cast<uintptr_t>(sockets[0])));
+    second.reset(new LocalSocket(static_cast<uintptr_t>(sockets[1])));
+    if (!setNonBlocking(sockets[0]) || !setNonBlocking(sockets[1])) {
+        first.reset();
+        second.reset();
+    }
+#endif
+    if (!first || !second) {
+        first.reset();
+        second.reset();
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<LocalSocket> LocalSocket::accept() {
+    NativeSocket socket = ::accept(native(handle_), nullptr, nullptr);
+    if (static_cast<uintptr_t>(socket) == INVALID_HANDLE) {
+        return nullptr;
+    }
+    if (!setNonBlocking(socket)) {
+        closeSocket(socket);
+        return nullptr;
+    }
+    return std::unique_ptr<LocalSocket>(new LocalSocket(static_cast<uintptr_t>(socket)));
+}
+
+bool LocalSocket::sendFrame(Frame type, std::string_view payload) {
+    FrameHeader header{ static_cast<uint32_t>(payload.size()), static_cast<uint8_t>(type), {} };
+    std::string frame(sizeof(header) + payload.size(), '\0');
+    std::memcpy(frame.data(), &header, sizeof(header));
+    std::memcpy(frame.data() + sizeof(header), payload.data(), payload.size());
+
+    std::lock_guard<std::mutex> lock(sendMutex_);
+    size_t sent = 0;
+    while (sent < frame.size()) {
+        auto n = ::send(native(handle_), frame.data() + sent, static_cast<int>(frame.size() - sent), SEND_FLAGS);
+        if (n > 0) {
+            sent += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && wouldBlock()) {
+            // Control frames are tiny; a peer that lets its buffer fill is stuck
+            PollEntry entry{};
+            entry.fd = native(handle_);
+            entry.events = POLLOUT;
+            if (pollSockets(&entry, 1, SEND_STALL_TIMEOUT_MS) > 0) {
+                continue;
+            }
+        }
+        return false;
+    }
+    return true;
+}
+
+bool LocalSocket::receive(std::vector<std::pair<Frame, std::string>>& frames) {
+    bool open = true;
+    char buffer[4096];
+    while (true) {
+        auto n = ::recv(native(handle_), buffer, static_cast<int>(sizeof(buffer)), 0);
+        if (n > 0) {
+            rxBuffer_.append(buffer, static_cast<size_t>(n));
+            continue;
+        }
+        open = n < 0 && wouldBlock();
+        break;
+    }
+
+    size_t offset = 0;
+    while (rxBuffer_.size() - offset >= sizeof(FrameHeader)) {
+        FrameHeader header;
+        std::memcpy(&header, rxBuffer_.data() + offset, sizeof(header));
+        if (header.length > MAX_CONTROL_FRAME) {
+            return false;
+        }
+        if (rxBuffer_.size() - offset - sizeof(header) < header.length) {
+            break;
+        }
+        frames.emplace_back(static_cast<Frame>(header.type), rxBuffer_.substr(offset + sizeof(header), header.length));
+        offset += sizeof(header) + header.length;
+    }
+    rxBuffer_.erase(0, offset);
+    return open;
+}
+
+int LocalSocket::waitReadable(LocalSocket* const* sockets, size_t count, int timeoutMs, bool* readable) {
+    std::vector<PollEntry> entries(count);
+    for (size_t i = 0; i < count; ++i) {
+        entries[i].fd = native(sockets[i]->handle_);
+        entries[i].events = POLLIN;
+    }
+    int ready = pollSockets(entries.data(), count, timeoutMs);
+    for (size_t i = 0; i < count; ++i) {
+        readable[i] = ready > 0 && (entries[i].revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+    }
+    return ready;
+}
+
+#ifdef _WIN32
+
+std::unique_ptr<SharedMemory> SharedMemory::create(const std::string& name, size_t size) {
+    ULARGE_INTEGER mappingSize;
+    mappingSize.QuadPart = size;
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+        mappingSize.HighPart, mappingSize.LowPart, name.c_str());
+    if (!mapping || GetLastError() == ERROR_ALREADY_EXISTS) {
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        return nullptr;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!view) {
+        CloseHandle(mapping);
+        return nullptr;
+    }
+
+    std::unique_ptr<SharedMemory> memory(new SharedMemory());
+    memory->view_ = view;
+    memory->size_ = size;
+    memory->name_ = name;
+    memory->owner_ = true;
+    memory->mappingHandle_ = mapping;
+    return memory;
+}
+
+std::unique_ptr<SharedMemory> SharedMemory::open(const std::string& name, size_t size) {
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+    if (!mapping) {
+        return nullptr;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!view) {
+        CloseHandle(mapping);
+        return nullptr;
+    }
+
+    // The size comes from the other process; a view past the section's end faults
+    MEMORY_BASIC_INFORMATION info;
+    if (VirtualQuery(view, &info, sizeof(info)) == 0 || info.RegionSize < size) {
+        UnmapViewOfFile(view);
+        CloseHandle(mapping);
+        return nullptr;
+    }
+
+    std::unique_ptr<SharedMemory> memory(new SharedMemory());
+    memory->view_ = view;
+    memory->size_ = size;
+    memory->name_ = name;
+    memory->mappingHandle_ = mapping;
+    return memory;
+}
+
+SharedMemory::~SharedMemory() {
+    if (view_) {
+        UnmapViewOfFile(view_);
+    }
+    if (mappingHandle_) {
+        CloseHandle(mappingHandle_); // The mapping itself lives on until the last handle goes
+    }
+}
+
+std::string SharedMemory::uniqueName(unsigned index) {
+    return "Local\\sixmans-" + std::to_string(GetCurrentProcessId()) + "-" + std::to_string(index);
+}
+
+#else
+
+std::unique_ptr<SharedMemory> SharedMemory::create(const std::string& name, size_t size) {
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        return nullptr;
+    }
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        ::close(fd);
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+
+    void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+
+    std::unique_ptr<SharedMemory> memory(new SharedMemory());
+    memory->view_ = view;
+    memory->size_ = size;
+    memory->name_ = name;
+    memory->owner_ = true;
+    return memory;
+}
+
+std::unique_ptr<SharedMemory> SharedMemory::open(const std::string& name, size_t size) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    // The size comes from the other process; pages past the object's end SIGBUS
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<uint64_t>(info.st_size) < size) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        return nullptr;
+    }
+
+    std::unique_ptr<SharedMemory> memory(new SharedMemory());
+    memory->view_ = view;
+    memory->size_ = size;
+    memory->name_ = name;
+    return memory;
+}
+
+SharedMemory::~SharedMemory() {
+    if (view_) {
+        munmap(view_, size_);
+    }
+    if (owner_) {
+        shm_unlink(name_.c_str());
+    }
+}
+
+std::string SharedMemory::uniqueName(unsigned index) {
+    return "/sixmans-" + std::to_string(getpid()) + "-" + std::to_string(index);
+}
+
+#endif
+
+bool BrokerLink::attach(const std::string& socketPath, const std::string& token, int timeoutMs) {
+    frames_.clear();
+    if (!LocalSocket::makePair(wakeReader_, wakeWriter_)) {
+        LOG("Could not create the broker link's wakeup sockets");
+        return false;
+    }
+    socket_ = LocalSocket::connect(socketPath);
+    if (!socket_ || !socket_->sendFrame(Frame::Attach, token)) {
+        socket_.reset();
+        return false;
+    }
+
+    // Ready comes straight back
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (true) {
+        for (auto it = frames_.begin(); it != frames_.end(); ++it) {
+            if (it->first != Frame::Ready) {
+                continue;
+            }
+            // Runs on the lws thread; a malformed Ready must fail the attach, not throw
+            json ready = json::parse(it->second, nullptr, false);
+            std::string name;
+            uint32_t ringBytes = 0;
+            if (ready.is_object()) {
+                auto region = ready.find("region");
+                if (region != ready.end() && region->is_string()) {
+                    name = region->get<std::string>();
+                }
+                auto bytes = ready.find("ringBytes");
+                if (bytes != ready.end() && bytes->is_number_unsigned() && bytes->get<uint64_t>() <= UINT32_MAX) {
+                    ringBytes = bytes->get<uint32_t>();
+                }
+            }
+            size_t blockBytes = SharedRing::blockSize(ringBytes);
+            region_ = name.empty() ? nullptr : SharedMemory::open(name, regionSize(ringBytes));
+            if (region_) {
+                inbound_ = SharedRing::attach(region_->data(), blockBytes);
+                outbound_ = SharedRing::attach(static_cast<uint8_t*>(region_->data()) + blockBytes, blockBytes);
+            }
+            if (!region_ || !inbound_.isValid() || !outbound_.isValid()) {
+                LOG("Could not map the broker's shared memory '{}'", name);
+                region_.reset();
+                socket_.reset();
+                return false;
+            }
+            frames_.erase(frames_.begin(), it + 1);
+            return true;
+        }
+
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        LocalSocket* socket = socket_.get();
+        bool readable = false;
+        if (remaining.count() <= 0
+            || LocalSocket::waitReadable(&socket, 1, static_cast<int>(remaining.count()), &readable) < 0
+            || !socket_->receive(frames_)) {
+            LOG("Broker at {} did not accept the attach", socketPath);
+            socket_.reset();
+            return false;
+        }
+    }
+}
+
+bool BrokerLink::poll(int timeoutMs) {
+    if (inbound_.isCorrupt() || outbound_.isCorrupt()) {
+        LOG("The broker's shared memory is corrupt, detaching");
+        return false;
+    }
+
+    if (!inbound_.prepareWait()) {
+        LocalSocket* sockets[2] = { socket_.get(), wakeReader_.get() };
+        bool readable[2] = { false, false };
+        LocalSocket::waitReadable(sockets, 2, timeoutMs, readable);
+    }
+    inbound_.endWait();
+
+    // Only Wake comes either way after Ready, and waking was all it had to do.
+    // The flag is cleared after reading so it is never set with nothing in
+    // flight; a wake() in between is covered by what the caller does next.
+    wakeReader_->receive(frames_);
+    wakePending_.store(false);
+    bool open = socket_->receive(frames_);
+    frames_.clear();
+    return open;
+}
+
+void BrokerLink::wake() {
+    // At most one frame in flight, so the send never waits for buffer space
+    if (!wakePending_.exchange(true)) {
+        wakeWriter_->sendFrame(Frame::Wake);
+    }
+}
+
+bool BrokerLink::sendHello(uint32_t generation, uint32_t upstream, const Headers& headers) {
+    json hello = { { "generation", generation }, { "upstream", upstream }, { "headers", json::object() } };
+    for (const auto& [name, value] : headers) {
+        hello["headers"][name] = value;
+    }
+    return socket_->sendFrame(Frame::Hello, hello.dump());
+}
+
+bool BrokerLink::push(uint32_t generation, std::string_view payload) {
+    if (!outbound_.push(generation, payload.data(), payload.size())) {
+        return false;
+    }
+    if (outbound_.takeWaiter()) {
+        socket_->sendFrame(Frame::Wake);
+    }
+    return true;
+}
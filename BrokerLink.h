@@ -0,0 +1,196 @@
+#pragma once
+
+#include "SharedRing.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Wire format between the plugin and tools/SixMansBroker, which holds one
+// upstream WebSocket for every game instance on the host.
+//
+// Each instance connects to the broker's local (Unix domain) socket and sends
+// Attach with its account token; the broker routes the upstream traffic of
+// that token to it. The reply, Ready, names a shared memory region holding two
+// SharedRings: messages to the instance, then messages to the broker. Payloads
+// only ever go through the rings; the socket carries the small control frames
+// below and the Wake doorbells, which SharedRing keeps to one per idle period.
+//
+// The broker tells the instance about the upstream connection with Up and
+// Down records in the instance's ring, so they stay in order with the
+// messages around them. The instance answers each Up with Hello carrying its
+// handshake headers (which the broker turns into the auth request) and a new
+// generation number. Records to the broker are tagged with the generation
+// they were sent in, so anything still queued from before a reconnect is
+// dropped instead of reaching the new connection.
+namespace BrokerProtocol {
+    constexpr const char* URL_PREFIX = "broker:";   // serverEndpoints entry: broker:<socket path>
+
+    enum class Frame : uint8_t {
+        Attach = 'A',   // Instance -> broker: account token
+        Ready = 'R',    // Broker -> instance: {"region": name, "ringBytes": n}
+        Hello = 'H',    // Instance -> broker: {"generation": g, "upstream": u, "headers": {name: value}}
+        Wake = 'W'      // Either way: the ring you read has records
+    };
+
+    // Tags of the records in the ring to the instance
+    enum Record : uint32_t {
+        Message = 0,    // A frame from the server
+        Up = 1,         // Upstream connected; payload is its number u, answer with Hello
+        Down = 2        // Upstream lost
+    };
+
+    struct FrameHeader {
+        uint32_t length;    // Payload bytes after the header
+        uint8_t type;       // Frame
+        uint8_t reserved[3];
+    };
+    static_assert(sizeof(FrameHeader) == 8, "FrameHeader layout changed");
+
+    // The region: ring to the instance, then ring to the broker
+    constexpr size_t regionSize(uint32_t ringBytes) {
+        return 2 * SharedRing::blockSize(ringBytes);
+    }
+
+    inline bool isBrokerUrl(const std::string& url) {
+        return url.rfind(URL_PREFIX, 0) == 0;
+    }
+}
+
+// Stream socket on a filesystem path (AF_UNIX on Linux and Windows 10+),
+// speaking BrokerProtocol frames. Non-blocking; sendFrame may be called from
+// several threads.
+class LocalSocket {
+public:
+    using Frame = BrokerProtocol::Frame;
+
+    ~LocalSocket();
+
+    // Non-copyable
+    LocalSocket(const LocalSocket&) = delete;
+    LocalSocket& operator=(const LocalSocket&) = delete;
+
+    // Replaces a stale socket file at path; the file is removed again on close
+    static std::unique_ptr<LocalSocket> listen(const std::string& path);
+    static std::unique_ptr<LocalSocket> connect(const std::string& path);
+
+    // Two connected sockets within this process, e.g. to wake a thread that
+    // waits in waitReadable
+    static bool makePair(std::unique_ptr<LocalSocket>& first, std::unique_ptr<LocalSocket>& second);
+
+    // Listener: the next pending connection, or nullptr
+    std::unique_ptr<LocalSocket> accept();
+
+    bool sendFrame(Frame type, std::string_view payload = {});
+
+    // Read whatever has arrived, appending complete frames. False once the
+    // peer has closed or the stream is corrupt.
+    bool receive(std::vector<std::pair<Frame, std::string>>& frames);
+
+    // Wait until one of sockets is readable (readable[i] set) or timeoutMs
+    // passes. Returns how many are readable, -1 on error.
+    static int waitReadable(LocalSocket* const* sockets, size_t count, int timeoutMs, bool* readable);
+
+private:
+    LocalSocket(uintptr_t handle, std::string listenPath = {});
+
+    uintptr_t handle_;
+    std::string listenPath_;
+    std::string rxBuffer_;
+    std::mutex sendMutex_;
+};
+
+// Named shared memory: a pagefile-backed mapping on Windows, POSIX shm on
+// Linux. The creator's name goes away when its object does; mappings already
+// opened stay valid.
+class SharedMemory {
+public:
+    ~SharedMemory();
+
+    // Non-copyable
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    static std::unique_ptr<SharedMemory> create(const std::string& name, size_t size);
+    static std::unique_ptr<SharedMemory> open(const std::string& name, size_t size);
+
+    // A name unused by other processes for this process' index-th region
+    static std::string uniqueName(unsigned index);
+
+    void* data() const { return view_; }
+    size_t size() const { return size_; }
+
+private:
+    SharedMemory() = default;
+
+    void* view_ = nullptr;
+    size_t size_ = 0;
+    std::string name_;
+    bool owner_ = false;
+#ifdef _WIN32
+    void* mappingHandle_ = nullptr;
+#endif
+};
+
+// The plugin's end of a broker attachment. Driven by one thread (poll, drain,
+// sendHello, push), which is the only one that rings the broker's doorbell:
+// that send can stall on a stuck broker. Other threads call wake() to get that
+// thread out of poll.
+class BrokerLink {
+public:
+    using Headers = std::vector<std::pair<std::string, std::string>>;
+
+    BrokerLink() = default;
+
+    // Non-copyable
+    BrokerLink(const BrokerLink&) = delete;
+    BrokerLink& operator=(const BrokerLink&) = delete;
+
+    // Connect, attach as token and map the rings the broker hands back
+    bool attach(const std::string& socketPath, const std::string& token, int timeoutMs);
+
+    // Sleep until the broker has something for us, wake() is called or
+    // timeoutMs passes. False once the broker has gone away or broken a ring.
+    bool poll(int timeoutMs);
+
+    // Any thread: make poll return now. Never blocks; calls before poll
+    // returns are folded into one.
+    void wake();
+
+    // Hand each queued record to onRecord(BrokerProtocol::Record, payload), in order
+    template<typename Callback>
+    size_t drain(Callback&& onRecord) {
+        size_t count = 0;
+        uint32_t tag;
+        std::string_view payload;
+        while (inbound_.front(tag, payload)) {
+            onRecord(static_cast<BrokerProtocol::Record>(tag), payload);
+            inbound_.pop();
+            ++count;
+        }
+        return count;
+    }
+
+    // Answer Up: a new generation with this connect's handshake headers. The
+    // upstream number is echoed so a Hello meant for an earlier upstream
+    // connection can be told apart.
+    bool sendHello(uint32_t generation, uint32_t upstream, const Headers& headers);
+
+    // Queue one message for the broker; false if the ring is full
+    bool push(uint32_t generation, std::string_view payload);
+
+private:
+    std::unique_ptr<LocalSocket> socket_;
+    std::unique_ptr<LocalSocket> wakeReader_;
+    std::unique_ptr<LocalSocket> wakeWriter_;
+    std::atomic<bool> wakePending_{ false };   // A Wake is on its way to wakeReader_
+    std::unique_ptr<SharedMemory> region_;
+    SharedRing inbound_;
+    SharedRing outbound_;
+    std::vector<std::pair<LocalSocket::Frame, std::string>> frames_;
+};
@@ -0,0 +1,391 @@
+#include "pch.h"
+#include "CarSampler.h"
+#include "logging.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <nlohmann/json.hpp>
+
+// x64 always has SSE2; 32-bit builds get it with /arch:SSE2 or -msse2
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIXMANS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+using namespace CarStreamFormat;
+using json = nlohmann::json;
+
+namespace {
+    constexpr float COLUMN_SCALES[COLUMN_COUNT] = {
+        CarSampler::POSITION_SCALE, CarSampler::POSITION_SCALE, CarSampler::POSITION_SCALE,
+        CarSampler::VELOCITY_SCALE, CarSampler::VELOCITY_SCALE, CarSampler::VELOCITY_SCALE,
+        CarSampler::BOOST_SCALE
+    };
+
+    constexpr const char* STREAM_EXTENSION = ".smcs";
+}
+
+CarSampler::CarSampler(IGameFacade& game, HookProfiler& profiler, std::filesystem::path directory, LobbySource lobby)
+    : game_(game), profiler_(profiler), directory_(std::move(directory)), lobby_(std::move(lobby)),
+    rings_(std::make_unique<std::array<Ring, MAX_CARS>>()) {
+    for (std::vector<float>& column : staging_) {
+        column.resize(BLOCK_TICKS);
+    }
+    stagingAtMs_.resize(BLOCK_TICKS);
+    quantized_.resize(BLOCK_TICKS / TICKS_PER_SAMPLE);
+    dtMs_.resize(BLOCK_TICKS / TICKS_PER_SAMPLE);
+}
+
+CarSampler::~CarSampler() {
+    stop();
+}
+
+void CarSampler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wakeup_.notify_one();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+void CarSampler::install() {
+    hook_ = profiler_.registerHook("CarSample");
+    game_.hookCarStates(profiler_, hook_,
+        [this] { return recording_; },
+        [this](const CarState& state) { onCarState(state); });
+    game_.hookEvent("Function TAGame.GameEvent_Soccar_TA.InitGame", [this](const std::string&) {
+        onMatchStarted();
+        });
+    game_.hookEvent("Function TAGame.GameEvent_Soccar_TA.EventMatchEnded", [this](const std::string&) {
+        finishMatch(true);
+        });
+    // Leaving early: the stream of a match that didn't finish isn't kept
+    game_.hookEvent("Function TAGame.GameEvent_Soccar_TA.Destroyed", [this](const std::string&) {
+        finishMatch(false);
+        });
+    worker_ = std::thread(&CarSampler::run, this);
+}
+
+void CarSampler::onCarState(const CarState& state) {
+    if (!recording_ || state.player == 0) {
+        return;
+    }
+
+    Ring* ring = nullptr;
+    for (size_t i = 0; i < carCount_; ++i) {
+        if ((*rings_)[i].player == state.player) {
+            ring = &(*rings_)[i];
+            break;
+        }
+    }
+    if (!ring) {
+        if (carCount_ == MAX_CARS) {
+            return;
+        }
+        ring = &(*rings_)[carCount_++];
+        ring->player = state.player;
+    }
+
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) >= RING_TICKS) {
+        ++ring->overruns;
+        return;
+    }
+    size_t index = static_cast<size_t>(head & (RING_TICKS - 1));
+    long long atMs = std::chrono::duration_cast<std::chrono::milliseconds>(game_.now() - matchStart_).count();
+    ring->atMs[index] = static_cast<uint32_t>(std::clamp<long long>(atMs, 0, UINT32_MAX));
+    ring->columns[X][index] = state.position[0];
+    ring->columns[Y][index] = state.position[1];
+    ring->columns[Z][index] = state.position[2];
+    ring->columns[VelocityX][index] = state.velocity[0];
+    ring->columns[VelocityY][index] = state.velocity[1];
+    ring->columns[VelocityZ][index] = state.velocity[2];
+    ring->columns[Boost][index] = state.boost;
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void CarSampler::onMatchStarted() {
+    // No end or teardown seen for the last one; let it go rather than wedge
+    finishMatch(false);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (state_ != State::Idle) {
+            LOG("Car sampler: still writing the last match, not sampling this one");
+            recording_ = false;
+            return;
+        }
+        // The worker is idle and leaves the rings alone until told otherwise
+        for (Ring& ring : *rings_) {
+            ring.head.store(0, std::memory_order_relaxed);
+            ring.tail.store(0, std::memory_order_relaxed);
+            ring.player = 0;
+            ring.overruns = 0;
+        }
+        state_ = State::Recording;
+    }
+    wakeup_.notify_one();
+
+    carCount_ = 0;
+    matchStart_ = game_.now();
+    recording_ = true;
+}
+
+void CarSampler::finishMatch(bool ended) {
+    if (!recording_) {
+        return;
+    }
+    recording_ = false;
+
+    uint64_t durationMs = static_cast<uint64_t>(std::max<long long>(0,
+        std::chrono::duration_cast<std::chrono::milliseconds>(game_.now() - matchStart_).count()));
+    std::string summary = ended ? buildSummary(durationMs) : std::string();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        summary_ = std::move(summary);
+        state_ = State::Finishing;
+    }
+    wakeup_.notify_one();
+}
+
+std::string CarSampler::buildSummary(uint64_t durationMs) {
+    MatchResult result;
+    if (!game_.readMatchResult(result) || !result.privateMatch) {
+        return std::string();
+    }
+    std::string lobbyName = lobby_();
+    if (lobbyName.empty()) {
+        return std::string();
+    }
+
+    json cars = json::array();
+    for (size_t i = 0; i < carCount_; ++i) {
+        const Ring& ring = (*rings_)[i];
+        json car = { { "id", "" }, { "name", "" }, { "team", -1 }, { "overruns", ring.overruns } };
+        for (const PlayerResult& player : result.players) {
+            if (player.player == ring.player) {
+                car["id"] = player.platformId;
+                car["name"] = player.name;
+                car["team"] = player.team;
+                break;
+            }
+        }
+        cars.push_back(std::move(car));
+    }
+
+    json summary;
+    summary["lobbyName"] = lobbyName;
+    summary["matchGuid"] = result.matchGuid;
+    summary["durationMs"] = durationMs;
+    summary["score"] = { result.teamScore[0], result.teamScore[1] };
+    summary["cars"] = std::move(cars);
+    return summary.dump();
+}
+
+void CarSampler::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wakeup_.wait_for(lock, std::chrono::milliseconds(SixMansConfig::CAR_SAMPLER_DRAIN_MS), [this] {
+            return stopping_ || state_ == State::Finishing;
+            });
+        State state = state_;
+        bool stopping = stopping_;
+        std::string summary = state == State::Finishing ? std::move(summary_) : std::string();
+        lock.unlock();
+
+        if (state != State::Idle) {
+            if (streamPath_.empty()) {
+                openStream();
+            }
+            drain();
+            // Unloading mid-match leaves no summary, so the stream isn't kept
+            if (state == State::Finishing || stopping) {
+                closeStream(summary);
+            }
+        }
+
+        lock.lock();
+        if (state == State::Finishing || stopping) {
+            state_ = State::Idle;
+        }
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+void CarSampler::openStream() {
+    std::error_code ec;
+    std::filesystem::create_directories(directory_, ec);
+
+    long long unixSeconds = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    streamPath_ = directory_ / ("match_" + std::to_string(unixSeconds) + STREAM_EXTENSION);
+    stream_.open(streamPath_, std::ios::binary | std::ios::trunc);
+    if (!stream_) {
+        LOG("Car sampler: can't write {}", streamPath_.string());
+        return;
+    }
+
+    FileHeader header{};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.ticksPerSample = TICKS_PER_SAMPLE;
+    header.positionScale = POSITION_SCALE;
+    header.velocityScale = VELOCITY_SCALE;
+    header.boostScale = BOOST_SCALE;
+    stream_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    bytesWritten_.fetch_add(sizeof(header), std::memory_order_relaxed);
+}
+
+void CarSampler::closeStream(const std::string& summary) {
+    if (!stream_.is_open()) {
+        // Failed to open: nothing to keep, but the rings still had to be drained
+        stream_.clear();
+        streamPath_.clear();
+        return;
+    }
+
+    if (!summary.empty()) {
+        SummaryHeader header{};
+        header.type = Summary;
+        header.length = static_cast<uint32_t>(summary.size());
+        stream_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        stream_.write(summary.data(), static_cast<std::streamsize>(summary.size()));
+        bytesWritten_.fetch_add(sizeof(header) + summary.size(), std::memory_order_relaxed);
+    }
+    stream_.close();
+    bool written = !stream_.fail();
+    stream_.clear();
+
+    std::filesystem::path path = std::move(streamPath_);
+    streamPath_.clear();
+
+    std::error_code ec;
+    if (summary.empty() || !written) {
+        std::filesystem::remove(path, ec);
+        return;
+    }
+    streamCount_.fetch_add(1, std::memory_order_relaxed);
+    LOG("Car sampler: wrote {} ({} KB)", path.filename().string(), std::filesystem::file_size(path, ec) / 1024);
+    pruneStreams();
+}
+
+void CarSampler::drain() {
+    for (size_t car = 0; car < MAX_CARS; ++car) {
+        Ring& ring = (*rings_)[car];
+        uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+        uint64_t head = ring.head.load(std::memory_order_acquire);
+
+        // Whole samples only; a partial one waits for the next pass, or is
+        // dropped at match end
+        size_t available = static_cast<size_t>(head - tail) / TICKS_PER_SAMPLE * TICKS_PER_SAMPLE;
+        while (available > 0) {
+            size_t ticks = std::min(available, BLOCK_TICKS);
+            size_t offset = static_cast<size_t>(tail & (RING_TICKS - 1));
+            size_t first = std::min(ticks, RING_TICKS - offset);
+
+            // A block can wrap around the end of the ring
+            std::memcpy(stagingAtMs_.data(), &ring.atMs[offset], first * sizeof(uint32_t));
+            std::memcpy(stagingAtMs_.data() + first, &ring.atMs[0], (ticks - first) * sizeof(uint32_t));
+            for (size_t column = 0; column < COLUMN_COUNT; ++column) {
+                std::memcpy(staging_[column].data(), &ring.columns[column][offset], first * sizeof(float));
+                std::memcpy(staging_[column].data() + first, &ring.columns[column][0], (ticks - first) * sizeof(float));
+            }
+            tail += ticks;
+            ring.tail.store(tail, std::memory_order_release);
+
+            writeBlock(car, ticks);
+            available -= ticks;
+        }
+    }
+}
+
+void CarSampler::writeBlock(size_t car, size_t ticks) {
+    if (!stream_.is_open()) {
+        return;
+    }
+
+    size_t samples = ticks / TICKS_PER_SAMPLE;
+    BlockHeader header{};
+    header.type = Block;
+    header.car = static_cast<uint8_t>(car);
+    header.count = static_cast<uint16_t>(samples);
+    header.startMs = stagingAtMs_[0];
+    stream_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // Each sample is stamped with the first tick it averages
+    uint32_t previousMs = stagingAtMs_[0];
+    for (size_t i = 0; i < samples; ++i) {
+        uint32_t atMs = stagingAtMs_[i * TICKS_PER_SAMPLE];
+        dtMs_[i] = static_cast<uint16_t>(std::min<uint32_t>(atMs - previousMs, UINT16_MAX));
+        previousMs = atMs;
+    }
+    stream_.write(reinterpret_cast<const char*>(dtMs_.data()), samples * sizeof(uint16_t));
+
+    for (size_t column = 0; column < COLUMN_COUNT; ++column) {
+        downsample(staging_[column].data(), samples, COLUMN_SCALES[column], quantized_.data());
+        stream_.write(reinterpret_cast<const char*>(quantized_.data()), samples * sizeof(int16_t));
+    }
+    bytesWritten_.fetch_add(sizeof(header) + samples * sizeof(uint16_t) * (1 + COLUMN_COUNT),
+        std::memory_order_relaxed);
+}
+
+void CarSampler::pruneStreams() {
+    // Names carry the start time with a fixed number of digits, so they sort by age
+    std::vector<std::filesystem::path> streams;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(directory_, ec)) {
+        if (entry.path().extension() == STREAM_EXTENSION) {
+            streams.push_back(entry.path());
+        }
+    }
+    if (streams.size() <= SixMansConfig::CAR_STREAM_KEEP_FILES) {
+        return;
+    }
+    std::sort(streams.begin(), streams.end());
+    for (size_t i = 0; i + SixMansConfig::CAR_STREAM_KEEP_FILES < streams.size(); ++i) {
+        std::filesystem::remove(streams[i], ec);
+    }
+}
+
+void CarSampler::downsample(const float* in, size_t samples, float scale, int16_t* out) {
+    static_assert(TICKS_PER_SAMPLE == 4, "downsample averages groups of four");
+    const float factor = scale / TICKS_PER_SAMPLE;
+    size_t i = 0;
+
+#ifdef SIXMANS_SSE2
+    // Eight samples (32 ticks) per pass: transpose four groups so each lane
+    // holds one group, add the rows, scale, clamp, convert and pack to int16
+    const __m128 multiplier = _mm_set1_ps(factor);
+    const __m128 low = _mm_set1_ps(-32768.0f);
+    const __m128 high = _mm_set1_ps(32767.0f);
+    auto fourSums = [&](const float* p) {
+        __m128 a = _mm_loadu_ps(p);
+        __m128 b = _mm_loadu_ps(p + 4);
+        __m128 c = _mm_loadu_ps(p + 8);
+        __m128 d = _mm_loadu_ps(p + 12);
+        _MM_TRANSPOSE4_PS(a, b, c, d);
+        __m128 sum = _mm_add_ps(_mm_add_ps(a, b), _mm_add_ps(c, d));
+        return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(sum, multiplier), low), high));
+    };
+    for (; i + 8 <= samples; i += 8) {
+        const float* p = in + i * TICKS_PER_SAMPLE;
+        __m128i packed = _mm_packs_epi32(fourSums(p), fourSums(p + 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+    }
+#endif
+
+    // Same operations in the same order, so the tail (or a non-SSE2 build)
+    // matches the vector path bit for bit; NaN ends up at the low end in both
+    for (; i < samples; ++i) {
+        const float* p = in + i * TICKS_PER_SAMPLE;
+        float value = ((p[0] + p[1]) + (p[2] + p[3])) * factor;
+        value = value > -32768.0f ? value : -32768.0f;
+        value = value < 32767.0f ? value : 32767.0f;
+        out[i] = static_cast<int16_t>(std::lrintf(value));
+    }
+}
@@ -0,0 +1,172 @@
+#pragma once
+#include "pch.h"
+#include "GameFacade.h"
+#include "HookProfiler.h"
+#include "Config.h"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Stream file layout.
+//
+// A FileHeader, then Block records as the worker drains the rings, then one
+// Summary record if the match ended normally. A file without a summary was cut
+// short by a crash and has nobody's name on its cars.
+namespace CarStreamFormat {
+    constexpr uint32_t MAGIC = 0x53434D53; // "SMCS"
+    constexpr uint32_t VERSION = 1;
+
+    // Quantized columns, in the order they follow a BlockHeader
+    enum Column : uint8_t { X, Y, Z, VelocityX, VelocityY, VelocityZ, Boost, COLUMN_COUNT };
+
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t ticksPerSample;    // Physics ticks averaged into each sample
+        float positionScale;        // Stored value = round(unreal units * scale)
+        float velocityScale;
+        float boostScale;
+        uint8_t reserved[8];
+    };
+    static_assert(sizeof(FileHeader) == 32, "FileHeader layout changed");
+
+    enum RecordType : uint8_t { Block = 1, Summary = 2 };
+
+    // A run of one car's samples. Followed by count uint16 dtMs (time since
+    // the previous sample in the block, 0 for the first), then count int16 for
+    // each Column in order.
+    struct BlockHeader {
+        uint8_t type;
+        uint8_t car;                // Index into the summary's cars
+        uint16_t count;
+        uint32_t startMs;           // Match time of the first sample
+    };
+    static_assert(sizeof(BlockHeader) == 8, "BlockHeader layout changed");
+
+    // Followed by length bytes of JSON: lobby, match GUID and who drove which car
+    struct SummaryHeader {
+        uint8_t type;
+        uint8_t reserved[3];
+        uint32_t length;
+    };
+    static_assert(sizeof(SummaryHeader) == 8, "SummaryHeader layout changed");
+}
+
+// Records where every car was during a 6mans match, for reviewing it
+// afterwards and settling disputes.
+//
+// The SetVehicleInput hook copies each car's position, velocity and boost into
+// that car's ring, one array per field: a slot lookup among at most MAX_CARS
+// handles, eight stores and a release, the same for every tick. Outside a
+// recorded match the facade doesn't read the car at all. The whole hook, game
+// reads included, is in the lobby's hook profile as "CarSample". A worker thread drains the rings a
+// block at a time, averages every TICKS_PER_SAMPLE ticks into one sample,
+// quantizes it to 16 bits and appends it to the match's stream file.
+//
+// A stream is kept only for a private match in a 6mans lobby that ran to the
+// end; the newest CAR_STREAM_KEEP_FILES are kept. Rings are reset only between
+// matches while the worker is idle, so the hook never waits on it.
+class CarSampler {
+public:
+    // Returns the 6mans lobby this client is in, empty if none
+    using LobbySource = std::function<std::string()>;
+
+    static constexpr size_t MAX_CARS = 8;
+    static constexpr size_t RING_TICKS = SixMansConfig::CAR_SAMPLER_RING_TICKS;
+    static constexpr size_t TICKS_PER_SAMPLE = 4;   // 120 Hz physics to 30 Hz samples
+    static constexpr size_t BLOCK_TICKS = 256;      // Drained and written at a time
+    static constexpr float POSITION_SCALE = 4.0f;   // Quarter units; the field fits in int16
+    static constexpr float VELOCITY_SCALE = 10.0f;  // Cars top out at 2300 uu/s
+    static constexpr float BOOST_SCALE = 1000.0f;
+
+    static_assert((RING_TICKS & (RING_TICKS - 1)) == 0, "CAR_SAMPLER_RING_TICKS must be a power of two");
+    static_assert(BLOCK_TICKS % TICKS_PER_SAMPLE == 0 && BLOCK_TICKS <= RING_TICKS, "Bad block size");
+
+    CarSampler(IGameFacade& game, HookProfiler& profiler, std::filesystem::path directory, LobbySource lobby);
+    ~CarSampler();
+
+    // Non-copyable
+    CarSampler(const CarSampler&) = delete;
+    CarSampler& operator=(const CarSampler&) = delete;
+
+    // Hook car states and match start/end, and start the worker. Call once.
+    void install();
+
+    // Stop the worker after it has finished a match that just ended. A match
+    // still being recorded is discarded. Called by the destructor.
+    void stop();
+
+    // out[i] = mean of in[4i .. 4i+3] * scale, rounded to nearest and saturated
+    // to int16. SSE2 when the build has it, scalar otherwise; both give the
+    // same result.
+    static void downsample(const float* in, size_t samples, float scale, int16_t* out);
+
+    size_t getStreamCount() const { return streamCount_.load(std::memory_order_relaxed); }
+    uint64_t getBytesWritten() const { return bytesWritten_.load(std::memory_order_relaxed); }
+
+private:
+    enum class State { Idle, Recording, Finishing };
+
+    // One car's ticks, column by column. head is the game thread's, tail the
+    // worker's; the rest is only touched by whoever owns the ticks in between.
+    struct Ring {
+        alignas(64) std::atomic<uint64_t> head{ 0 };
+        alignas(64) std::atomic<uint64_t> tail{ 0 };
+        alignas(64) uintptr_t player = 0;
+        uint64_t overruns = 0;                                      // Ticks dropped, ring full
+        std::array<uint32_t, RING_TICKS> atMs;                      // Since match start
+        std::array<std::array<float, RING_TICKS>, CarStreamFormat::COLUMN_COUNT> columns;
+    };
+
+    // Game thread
+    void onCarState(const CarState& state);
+    void onMatchStarted();
+    void finishMatch(bool ended);
+    std::string buildSummary(uint64_t durationMs);
+
+    // Worker thread
+    void run();
+    void openStream();
+    void closeStream(const std::string& summary);
+    void drain();
+    void writeBlock(size_t car, size_t ticks);
+    void pruneStreams();
+
+    IGameFacade& game_;
+    HookProfiler& profiler_;
+    std::filesystem::path directory_;
+    LobbySource lobby_;
+    size_t hook_ = 0;
+
+    std::unique_ptr<std::array<Ring, MAX_CARS>> rings_;
+    size_t carCount_ = 0;               // Rings handed out this match
+    bool recording_ = false;
+    IGameFacade::Clock::time_point matchStart_;
+
+    std::mutex mutex_;
+    std::condition_variable wakeup_;
+    State state_ = State::Idle;         // Guarded by mutex_
+    std::string summary_;               // Guarded by mutex_; empty to discard the stream
+    bool stopping_ = false;             // Guarded by mutex_
+    std::thread worker_;
+
+    // Worker only
+    std::ofstream stream_;
+    std::filesystem::path streamPath_;     // Set from open to close, even if the open failed
+    std::array<std::vector<float>, CarStreamFormat::COLUMN_COUNT> staging_;
+    std::vector<uint32_t> stagingAtMs_;
+    std::vector<int16_t> quantized_;
+    std::vector<uint16_t> dtMs_;
+
+    std::atomic<size_t> streamCount_{ 0 };
+    std::atomic<uint64_t> bytesWritten_{ 0 };
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+// Estimates the offset between the server's clock and ours from ping/pong
+// exchanges, NTP style. For one exchange:
+//   t0 = we sent the ping, t1 = the server received it,
+//   t2 = the server sent the pong, t3 = we received it
+//   rtt = (t3 - t0) - (t2 - t1), offset = ((t1 - t0) + (t2 - t3)) / 2
+// The offset is off by at most rtt / 2, so of the last WINDOW samples the one
+// with the smallest rtt wins (queueing delay only ever adds).
+//
+// Times are milliseconds since the Unix epoch. Samples come in on the network
+// thread; the estimate is read from any thread without locking.
+class ClockSync {
+public:
+    static constexpr size_t WINDOW = 8;
+
+    ClockSync() = default;
+
+    // Non-copyable
+    ClockSync(const ClockSync&) = delete;
+    ClockSync& operator=(const ClockSync&) = delete;
+
+    static double localNowMs() {
+        return std::chrono::duration<double, std::milli>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    void addSample(double t0, double t1, double t2, double t3) {
+        double rtt = (t3 - t0) - (t2 - t1);
+        if (rtt < 0.0) {
+            return; // Server time went backwards mid-exchange; nothing to learn
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        samples_[next_ % WINDOW] = Sample{ ((t1 - t0) + (t2 - t3)) / 2.0, rtt };
+        ++next_;
+
+        const Sample* best = &samples_[0];
+        for (size_t i = 1; i < std::min(next_, WINDOW); ++i) {
+            if (samples_[i].rttMs < best->rttMs) {
+                best = &samples_[i];
+            }
+        }
+        offsetMs_.store(best->offsetMs, std::memory_order_relaxed);
+        rttMs_.store(best->rttMs, std::memory_order_relaxed);
+        sampleCount_.fetch_add(1, std::memory_order_relaxed);
+        synced_.store(true, std::memory_order_release);
+    }
+
+    // New connection, maybe to another server: forget the old samples but keep
+    // serving the last estimate until a fresh one replaces it
+    void restart() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        next_ = 0;
+    }
+
+    bool isSynced() const { return synced_.load(std::memory_order_acquire); }
+
+    // Server clock minus ours, and the round trip of the sample it came from
+    double offsetMs() const { return offsetMs_.load(std::memory_order_relaxed); }
+    double rttMs() const { return rttMs_.load(std::memory_order_relaxed); }
+    size_t sampleCount() const { return sampleCount_.load(std::memory_order_relaxed); }
+
+    double serverNowMs() const { return localNowMs() + offsetMs(); }
+
+private:
+    struct Sample {
+        double offsetMs = 0.0;
+        double rttMs = 0.0;
+    };
+
+    std::mutex mutex_;
+    std::array<Sample, WINDOW> samples_{};
+    size_t next_ = 0;
+
+    std::atomic<bool> synced_{ false };
+    std::atomic<double> offsetMs_{ 0.0 };
+    std::atomic<double> rttMs_{ 0.0 };
+    std::atomic<size_t> sampleCount_{ 0 };
+};
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace SixMansConfig {
     // WebSocket Configuration
@@ -14,10 +16,113 @@ namespace SixMansConfig {
     constexpr int RECONNECT_DELAY_MS = 5000;
     constexpr int PING_INTERVAL_MS = 60000;
     constexpr int MAX_QUEUE_SIZE = 100;
+    constexpr int MESSAGES_PER_TICK = 5; // Dispatch budget per game tick
+
+    // Endpoint selection
+    constexpr int ENDPOINT_PROBE_TIMEOUT_MS = 2000;
+    constexpr int ENDPOINT_RERANK_INTERVAL_MS = 300000;
+    constexpr int MAX_CONNECT_FAILURES_BEFORE_FAILOVER = 2;
+    constexpr bool DEFAULT_HOT_STANDBY = false;
+
+    // Lobby join state machine. Success/failure are taken from these game
+    // events; a join that produces neither within the timeout counts as failed.
+    constexpr const char* JOIN_SUCCESS_EVENT = "Function GameEvent_Soccar_TA.WaitingForPlayers.BeginState";
+    constexpr const char* JOIN_FAILURE_EVENT = "Function TAGame.GFxShell_TA.ShowErrorMessage";
+    constexpr float JOIN_ATTEMPT_TIMEOUT_S = 10.0f;
+    constexpr float JOIN_RETRY_DELAYS_S[] = { 0.25f, 0.5f, 1.0f, 2.0f }; // One entry per retry
+
+    // Correlated requests (NetworkManager::sendRequest). Replies echo the
+    // request's "requestId"; anything not answered in time completes as a timeout.
+    constexpr size_t MAX_PENDING_REQUESTS = 64;
+    constexpr int REQUEST_SWEEP_INTERVAL_MS = 100;
+    constexpr int AUTH_TIMEOUT_MS = 5000;
+
+    // Auth in the upgrade request's headers. A server that hasn't answered
+    // within this long of the upgrade request is taken not to support it.
+    constexpr bool HANDSHAKE_AUTH = true;
+    constexpr int HANDSHAKE_AUTH_TIMEOUT_MS = 1500;
+
+    // Connection broker (tools/SixMansBroker): how long an instance waits for
+    // the broker to answer its attach, and the size of each shared ring
+    constexpr int BROKER_ATTACH_TIMEOUT_MS = 2000;
+    constexpr uint32_t BROKER_RING_BYTES = 1 << 20;
+
+    // Live queue view: how long to wait for the snapshot after asking for a
+    // resync (on connect, or after a gap in queue_delta sequence numbers)
+    constexpr int QUEUE_RESYNC_TIMEOUT_MS = 5000;
+
+    // Session resume: cumulative acks for processed server messages go out
+    // every SESSION_ACK_EVERY messages, and at least this often while behind
+    constexpr int SESSION_ACK_INTERVAL_MS = 1000;
+    constexpr uint64_t SESSION_ACK_EVERY = 32;
+
+    // Server clock estimate: CLOCK_SYNC_BURST pings spaced by the burst spacing
+    // after each connect, then one per interval
+    constexpr int CLOCK_SYNC_BURST = 4;
+    constexpr int CLOCK_SYNC_BURST_SPACING_MS = 1000;
+    constexpr int CLOCK_SYNC_INTERVAL_MS = 30000;
+    constexpr int CLOCK_SYNC_TIMEOUT_MS = 5000;
+
+    // Stat events kept per match for the match report; later ones are only counted
+    constexpr size_t MATCH_TELEMETRY_MAX_EVENTS = 512;
+
+    // Car state sampler: each car's physics ticks go into a ring of this many
+    // (a power of two; 2048 is ~17 s at 120 Hz) that a worker drains every
+    // interval into a stream file per match. Only the newest files are kept.
+    constexpr size_t CAR_SAMPLER_RING_TICKS = 2048;
+    constexpr int CAR_SAMPLER_DRAIN_MS = 250;
+    constexpr const char* CAR_STREAM_DIR = "car_streams";
+    constexpr size_t CAR_STREAM_KEEP_FILES = 20;
+
+    // lobby_prepare payloads are discarded if no matching "go" arrives in time
+    constexpr int PREPARED_LOBBY_TTL_S = 600;
+
+    // Flight recorder ring (slots * slot size bytes on disk). Frames longer than
+    // a slot are truncated; the original length is still recorded.
+    constexpr const char* FLIGHT_RECORDER_FILE = "flight_recorder.bin";
+    constexpr uint32_t FLIGHT_RECORDER_SLOTS = 4096;
+    constexpr uint32_t FLIGHT_RECORDER_SLOT_SIZE = 1024;
+
+    // Outbound spool: reports wait in a memory-mapped file (slots * slot size
+    // bytes) until the server acknowledges them, and go out after each auth, a
+    // batch per pass. Messages longer than a slot can't be spooled; a match
+    // report with a full event log is the largest. A server that hasn't
+    // acknowledged a report within the ack timeout is taken not to support it.
+    constexpr const char* OUTBOUND_SPOOL_FILE = "outbound_spool.bin";
+    constexpr uint32_t OUTBOUND_SPOOL_SLOTS = 256;
+    constexpr uint32_t OUTBOUND_SPOOL_SLOT_SIZE = 8192;
+    constexpr size_t OUTBOUND_SPOOL_FLUSH_BATCH = 16;
+    constexpr int OUTBOUND_SPOOL_ACK_TIMEOUT_MS = 10000;
 
     // Build full WebSocket URL
     inline std::string buildWebSocketUrl() {
         std::string protocol = DEFAULT_WS_USE_SSL ? "wss://" : "ws://";
         return protocol + DEFAULT_WS_HOST + ":" + std::to_string(DEFAULT_WS_PORT) + DEFAULT_WS_PATH;
     }
-}
+
+    // Parse a comma/semicolon/whitespace separated endpoint list (e.g. from the
+    // serverEndpoints cvar). Falls back to the compiled-in endpoint when empty.
+    inline std::vector<std::string> parseEndpointList(const std::string& list) {
+        std::vector<std::string> endpoints;
+        std::string current;
+        for (char c : list) {
+            if (c == ',' || c == ';' || c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+                if (!current.empty()) {
+                    endpoints.push_back(current);
+                    current.clear();
+                }
+            }
+            else {
+                current += c;
+            }
+        }
+        if (!current.empty()) {
+            endpoints.push_back(current);
+        }
+
+        if (endpoints.empty()) {
+            endpoints.push_back(buildWebSocketUrl());
+        }
+        return endpoints;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "pch.h"
+#include "EndpointProber.h"
+#include "WebSocketClient.h"
+#include "logging.h"
+#include <libwebsockets.h>
+#include <algorithm>
+#include <chrono>
+#include <future>
+
+namespace {
+    struct ProbeState {
+        bool done = false;
+        bool established = false;
+    };
+
+    int probeCallback(struct lws* wsi, enum lws_callback_reasons reason, void*, void*, size_t) {
+        ProbeState* state = static_cast<ProbeState*>(lws_get_opaque_user_data(wsi));
+        if (!state) {
+            return 0;
+        }
+
+        switch (reason) {
+        case LWS_CALLBACK_CLIENT_ESTABLISHED:
+            state->established = true;
+            state->done = true;
+            return -1; // Handshake is all we wanted, close straight away
+
+        case LWS_CALLBACK_CLIENT_CONNECTION_ERROR:
+        case LWS_CALLBACK_CLIENT_CLOSED:
+            state->done = true;
+            break;
+
+        default:
+            break;
+        }
+        return 0;
+    }
+}
+
+EndpointProbeResult EndpointProber::probe(const std::string& url, int timeoutMs) {
+    EndpointProbeResult result;
+    result.url = url;
+
+    std::string host;
+    std::string path;
+    int port = 443;
+    bool useSSL = false;
+    if (!WebSocketClient::parseUrl(url, host, port, path, useSSL)) {
+        LOG("Endpoint probe skipped, invalid URL: {}", url);
+        return result;
+    }
+
+    struct lws_protocols protocols[2] = {
+        { "sixmans-protocol", probeCallback, 0, 0, 0, nullptr, 0 },
+        { nullptr, nullptr, 0, 0, 0, nullptr, 0 }
+    };
+
+    struct lws_context_creation_info info = {};
+    info.port = CONTEXT_PORT_NO_LISTEN;
+    info.protocols = protocols;
+    info.gid = -1;
+    info.uid = -1;
+    if (useSSL) {
+        info.options = LWS_SERVER_OPTION_DO_SSL_GLOBAL_INIT;
+    }
+
+    struct lws_context* context = lws_create_context(&info);
+    if (!context) {
+        LOG("Endpoint probe failed to create context for {}", url);
+        return result;
+    }
+
+    ProbeState state;
+    struct lws_client_connect_info connectInfo = {};
+    connectInfo.context = context;
+    connectInfo.address = host.c_str();
+    connectInfo.port = port;
+    connectInfo.path = path.c_str();
+    connectInfo.host = host.c_str();
+    connectInfo.origin = host.c_str();
+    connectInfo.protocol = protocols[0].name;
+    connectInfo.opaque_user_data = &state;
+    if (useSSL) {
+        connectInfo.ssl_connection = LCCSCF_USE_SSL;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+    auto deadline = startTime + std::chrono::milliseconds(timeoutMs);
+
+    if (lws_client_connect_via_info(&connectInfo)) {
+        while (!state.done && std::chrono::steady_clock::now() < deadline) {
+            lws_service(context, 10);
+        }
+    }
+
+    if (state.established) {
+        result.healthy = true;
+        result.rttMs = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startTime).count());
+    }
+
+    lws_context_destroy(context);
+    return result;
+}
+
+std::vector<EndpointProbeResult> EndpointProber::probeAll(const std::vector<std::string>& urls, int timeoutMs) {
+    std::vector<std::future<EndpointProbeResult>> pending;
+    pending.reserve(urls.size());
+    for (const auto& url : urls) {
+        pending.push_back(std::async(std::launch::async, &EndpointProber::probe, url, timeoutMs));
+    }
+
+    std::vector<EndpointProbeResult> results;
+    results.reserve(urls.size());
+    for (auto& future : pending) {
+        results.push_back(future.get());
+    }
+
+    for (const auto& result : results) {
+        if (result.healthy) {
+            LOG("Endpoint {} healthy, handshake {}ms", result.url, result.rttMs);
+        }
+        else {
+            LOG("Endpoint {} unreachable", result.url);
+        }
+    }
+    return results;
+}
+
+std::vector<std::string> EndpointProber::rank(const std::vector<EndpointProbeResult>& results) {
+    std::vector<EndpointProbeResult> sorted = results;
+    std::stable_sort(sorted.begin(), sorted.end(), [](const EndpointProbeResult& a, const EndpointProbeResult& b) {
+        if (a.healthy != b.healthy) {
+            return a.healthy;
+        }
+        return a.healthy && a.rttMs < b.rttMs;
+    });
+
+    std::vector<std::string> ranked;
+    ranked.reserve(sorted.size());
+    for (const auto& result : sorted) {
+        ranked.push_back(result.url);
+    }
+    return ranked;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include <vector>
+
+struct EndpointProbeResult {
+    std::string url;
+    bool healthy = false;
+    int rttMs = -1; // Time to complete the WebSocket upgrade, -1 if it failed
+};
+
+// Measures how quickly each endpoint completes a WebSocket handshake.
+// Every probe uses its own short-lived lws context and closes the connection as
+// soon as it is established, so nothing is authenticated or subscribed.
+class EndpointProber {
+public:
+    // Probe all endpoints in parallel and return the results in input order.
+    // Blocks for at most roughly timeoutMs.
+    static std::vector<EndpointProbeResult> probeAll(const std::vector<std::string>& urls, int timeoutMs);
+
+    // Order endpoints by health, then RTT. Unhealthy endpoints are kept at the
+    // end (in their original order) so they can still be used for failover.
+    static std::vector<std::string> rank(const std::vector<EndpointProbeResult>& results);
+
+private:
+    static EndpointProbeResult probe(const std::string& url, int timeoutMs);
+};
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// Define SIXMANS_USE_SIMDJSON (and add simdjson to the include/link paths) to
+// enable the On-Demand fast path. Without it every frame goes through nlohmann.
+#ifdef SIXMANS_USE_SIMDJSON
+#include <simdjson.h>
+#endif
+
+using json = nlohmann::json;
+
+// Decoder for inbound WebSocket frames.
+//
+// For the message types the client actually acts on (lobby_action, auth_response,
+// ping) only the fields it reads are pulled out of the frame in a single pass and
+// everything else is skipped without being materialised. Unknown types, malformed
+// frames and anything the fast path can't represent fall back to json::parse, so
+// callers always get the same json they would have gotten before.
+//
+// One instance per connection: it owns reusable scratch buffers and is not
+// thread-safe.
+class FastJsonParser {
+public:
+    FastJsonParser() = default;
+
+    // Non-copyable
+    FastJsonParser(const FastJsonParser&) = delete;
+    FastJsonParser& operator=(const FastJsonParser&) = delete;
+
+    // Parse a frame. Throws json::parse_error exactly like json::parse when the
+    // frame is not valid JSON.
+    json parse(const char* data, size_t len) {
+#ifdef SIXMANS_USE_SIMDJSON
+        json result;
+        if (tryFastParse(data, len, result)) {
+            ++fastPathHits_;
+            return result;
+        }
+#endif
+        ++fallbackHits_;
+        return json::parse(data, data + len);
+    }
+
+    json parse(std::string_view frame) {
+        return parse(frame.data(), frame.size());
+    }
+
+    size_t fastPathHits() const { return fastPathHits_; }
+    size_t fallbackHits() const { return fallbackHits_; }
+
+    // True if the fast path only extracts a subset of fields for this type
+    static bool isFastPathType(std::string_view type) {
+        return type == "lobby_action" || type == "auth_response" || type == "ping";
+    }
+
+private:
+#ifdef SIXMANS_USE_SIMDJSON
+    bool tryFastParse(const char* data, size_t len, json& out) {
+        // simdjson reads up to SIMDJSON_PADDING bytes past the end of the input.
+        // The lws rx buffer gives no such guarantee, so copy into a padded scratch
+        // buffer that is reused across frames (no allocation once it has grown).
+        if (padded_.size() < len + simdjson::SIMDJSON_PADDING) {
+            padded_.resize(len + simdjson::SIMDJSON_PADDING);
+        }
+        memcpy(padded_.data(), data, len);
+
+        simdjson::ondemand::document doc;
+        if (parser_.iterate(padded_.data(), len, padded_.size()).get(doc)) {
+            return false;
+        }
+
+        simdjson::ondemand::object object;
+        if (doc.get_object().get(object)) {
+            return false;
+        }
+
+        out = json::object();
+        bool hasType = false;
+
+        // Single pass over the object; fields we don't care about are skipped
+        for (auto field : object) {
+            std::string_view key;
+            if (field.unescaped_key().get(key)) {
+                return false;
+            }
+
+            simdjson::ondemand::value value;
+            if (field.value().get(value)) {
+                return false;
+            }
+
+            if (key == "type") {
+                std::string_view type;
+                if (value.get_string().get(type) || !isFastPathType(type)) {
+                    return false; // Unknown or non-string type, let nlohmann handle it
+                }
+                out["type"] = std::string(type);
+                hasType = true;
+            }
+            else if (key == "action" || key == "lobbyName" || key == "password" || key == "error"
+                || key == "prepareId" || key == "sessionId") {
+                std::string_view str;
+                if (value.get_string().get(str)) {
+                    return false;
+                }
+                out[std::string(key)] = std::string(str);
+            }
+            else if (key == "success" || key == "resumed") {
+                bool flag;
+                if (value.get_bool().get(flag)) {
+                    return false;
+                }
+                out[std::string(key)] = flag;
+            }
+            else if (key == "requestId" || key == "sessionSeq") {
+                // Correlation id / session sequence number; anything but an
+                // unsigned integer falls back
+                uint64_t number;
+                if (value.get_uint64().get(number)) {
+                    return false;
+                }
+                out[std::string(key)] = number;
+            }
+            else if (key == "deadline") {
+                // Server epoch milliseconds; integral or not, kept as a number
+                double number;
+                if (value.get_double().get(number)) {
+                    return false;
+                }
+                out["deadline"] = number;
+            }
+            else if (key == "queue") {
+                // Live queue sent along with an auth_response: once per connect,
+                // so not worth a fast path of its own
+                return false;
+            }
+            else if (key == "timestamp") {
+                // Echoed back verbatim in pongs, so keep whatever type the server sent
+                std::string_view raw = value.raw_json_token();
+                out["timestamp"] = json::parse(raw.begin(), raw.end(), nullptr, false);
+                if (out["timestamp"].is_discarded()) {
+                    return false;
+                }
+            }
+        }
+
+        // Make sure the whole document was consumed (trailing garbage = invalid frame)
+        return hasType && doc.at_end();
+    }
+
+    simdjson::ondemand::parser parser_;
+    std::vector<char> padded_;
+#endif
+
+    size_t fastPathHits_ = 0;
+    size_t fallbackHits_ = 0;
+};
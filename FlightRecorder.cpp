@@ -0,0 +1,319 @@
+#include "pch.h"
+#include "FlightRecorder.h"
+#include "logging.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace FlightRecorderFormat;
+
+namespace {
+    uint64_t steadyNowNs() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // True if the file at path looks like a ring with at least one record in it
+    bool hasRecording(const std::filesystem::path& path) {
+        std::ifstream file(path, std::ios::binary);
+        FileHeader header{};
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            return false;
+        }
+        return header.magic == MAGIC && header.version == VERSION && header.nextIndex > 0;
+    }
+
+    enum RedactPhase : uint8_t { Scan, AfterKey, AfterColon, Value, ValueEscape };
+
+    constexpr char TOKEN_KEY[] = "\"token\"";
+    constexpr char PASSWORD_KEY[] = "\"password\"";
+
+    // Bytes of key matched once c follows the first match bytes. Keys have no
+    // quotes inside, so a quote that breaks a match starts the next one.
+    uint8_t advanceMatch(const char* key, size_t keyLength, uint8_t match, char c) {
+        if (match < keyLength && c == key[match]) {
+            return match + 1;
+        }
+        return c == '"' ? 1 : 0;
+    }
+
+    bool isJsonSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    // Copy the first stored of length bytes to out, writing the string value of
+    // any "token" or "password" key as '*'. All length bytes advance the state,
+    // so the next fragment picks up where this one was cut.
+    void copyRedacted(uint8_t* out, const char* in, size_t length, size_t stored, FlightRecorder::Redaction& state) {
+        size_t i = 0;
+        while (i < length) {
+            // Outside a value with no key half-matched, nothing changes before the next quote
+            if (state.phase == Scan && state.tokenMatch == 0 && state.passwordMatch == 0) {
+                const void* quote = std::memchr(in + i, '"', length - i);
+                size_t next = quote ? static_cast<size_t>(static_cast<const char*>(quote) - in) : length;
+                if (i < stored) {
+                    std::memcpy(out + i, in + i, (std::min)(next, stored) - i);
+                }
+                i = next;
+                if (i == length) {
+                    break;
+                }
+            }
+
+            char c = in[i];
+            char written = c;
+            switch (state.phase) {
+            case AfterKey:
+                if (c == ':') {
+                    state.phase = AfterColon;
+                }
+                else if (!isJsonSpace(c)) {
+                    state.phase = Scan;
+                }
+                break;
+            case AfterColon:
+                if (c == '"') {
+                    state.phase = Value;
+                }
+                else if (!isJsonSpace(c)) {
+                    state.phase = Scan; // Not a string; nothing to hide
+                }
+                break;
+            case Value:
+                if (c == '"') {
+                    state.phase = Scan;
+                }
+                else {
+                    state.phase = c == '\\' ? ValueEscape : Value;
+                    written = '*';
+                }
+                break;
+            case ValueEscape:
+                state.phase = Value;
+                written = '*';
+                break;
+            default:
+                break;
+            }
+
+            if (state.phase == Scan) {
+                state.tokenMatch = advanceMatch(TOKEN_KEY, sizeof(TOKEN_KEY) - 1, state.tokenMatch, c);
+                state.passwordMatch = advanceMatch(PASSWORD_KEY, sizeof(PASSWORD_KEY) - 1, state.passwordMatch, c);
+                if (state.tokenMatch == sizeof(TOKEN_KEY) - 1 || state.passwordMatch == sizeof(PASSWORD_KEY) - 1) {
+                    state.phase = AfterKey;
+                    state.tokenMatch = 0;
+                    state.passwordMatch = 0;
+                }
+            }
+
+            if (i < stored) {
+                out[i] = static_cast<uint8_t>(written);
+            }
+            ++i;
+        }
+    }
+}
+
+FlightRecorder& FlightRecorder::instance() {
+    static FlightRecorder recorder;
+    return recorder;
+}
+
+FlightRecorder::~FlightRecorder() {
+    close();
+}
+
+bool FlightRecorder::open(const std::filesystem::path& path, uint32_t slotCount, uint32_t slotSize) {
+    if (isOpen()) {
+        return true;
+    }
+    if (slotCount == 0 || slotSize <= sizeof(SlotHeader)) {
+        LOG("Flight recorder: invalid geometry {}x{}", slotCount, slotSize);
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    // Keep the last session's recording; it's the one you want after a crash
+    if (hasRecording(path)) {
+        std::filesystem::path previous = path;
+        previous += ".prev";
+        std::filesystem::rename(path, previous, ec);
+        if (ec) {
+            LOG("Flight recorder: could not keep previous recording: {}", ec.message());
+        }
+    }
+
+    size_t size = sizeof(FileHeader) + static_cast<size_t>(slotCount) * slotSize;
+    uint8_t* base = mapFile(path, size);
+    if (!base) {
+        LOG("Flight recorder: failed to map {}", path.string());
+        return false;
+    }
+
+    std::memset(base, 0, size);
+
+    FileHeader* header = reinterpret_cast<FileHeader*>(base);
+    header->magic = MAGIC;
+    header->version = VERSION;
+    header->slotCount = slotCount;
+    header->slotSize = slotSize;
+    header->steadyAtOpenNs = steadyNowNs();
+    header->systemAtOpenNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    header->nextIndex = 0;
+
+    slotCount_ = slotCount;
+    slotSize_ = slotSize;
+    path_ = path;
+    mapping_.store(base, std::memory_order_release);
+
+    LOG("Flight recorder: {} slots of {} bytes in {}", slotCount, slotSize, path.string());
+    return true;
+}
+
+void FlightRecorder::close() {
+    if (!isOpen()) {
+        return;
+    }
+    unmapFile();
+}
+
+void FlightRecorder::record(Direction direction, uint32_t epoch, const void* data, size_t length, uint8_t flags,
+    Redaction* redaction) {
+    uint8_t* base = mapping_.load(std::memory_order_acquire);
+    if (!base) {
+        return;
+    }
+
+    FileHeader* header = reinterpret_cast<FileHeader*>(base);
+    uint64_t index = std::atomic_ref<uint64_t>(header->nextIndex).fetch_add(1, std::memory_order_relaxed);
+
+    uint8_t* slot = base + sizeof(FileHeader) + (index % slotCount_) * slotSize_;
+    SlotHeader* slotHeader = reinterpret_cast<SlotHeader*>(slot);
+
+    // Mark the slot incomplete before touching it, so a crash mid-copy leaves
+    // it unreadable rather than half old, half new
+    std::atomic_ref<uint64_t> seq(slotHeader->seq);
+    seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    size_t capacity = slotSize_ - sizeof(SlotHeader);
+    size_t stored = (std::min)(length, capacity);
+    if (stored < length) {
+        flags |= FLAG_TRUNCATED;
+    }
+
+    slotHeader->timestampNs = steadyNowNs();
+    slotHeader->epoch = epoch;
+    slotHeader->direction = static_cast<uint8_t>(direction);
+    slotHeader->flags = flags;
+    slotHeader->length = static_cast<uint32_t>((std::min<size_t>)(length, UINT32_MAX));
+    slotHeader->stored = static_cast<uint32_t>(stored);
+    if (direction == Direction::Inbound || direction == Direction::Outbound) {
+        Redaction standalone;
+        copyRedacted(slot + sizeof(SlotHeader), static_cast<const char*>(data), length, stored,
+            redaction ? *redaction : standalone);
+    }
+    else if (stored > 0) {
+        std::memcpy(slot + sizeof(SlotHeader), data, stored);
+    }
+
+    seq.store(index + 1, std::memory_order_release);
+}
+
+#ifdef _WIN32
+
+uint8_t* FlightRecorder::mapFile(const std::filesystem::path& path, size_t size) {
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+        nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+
+    ULARGE_INTEGER mappingSize;
+    mappingSize.QuadPart = size;
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE,
+        mappingSize.HighPart, mappingSize.LowPart, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    fileHandle_ = file;
+    mappingHandle_ = mapping;
+    mappingSize_ = size;
+    return static_cast<uint8_t*>(view);
+}
+
+void FlightRecorder::unmapFile() {
+    uint8_t* base = mapping_.exchange(nullptr, std::memory_order_acq_rel);
+    if (base) {
+        FlushViewOfFile(base, mappingSize_);
+        UnmapViewOfFile(base);
+    }
+    if (mappingHandle_) {
+        CloseHandle(mappingHandle_);
+        mappingHandle_ = nullptr;
+    }
+    if (fileHandle_) {
+        CloseHandle(fileHandle_);
+        fileHandle_ = nullptr;
+    }
+    mappingSize_ = 0;
+}
+
+#else
+
+uint8_t* FlightRecorder::mapFile(const std::filesystem::path& path, size_t size) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return nullptr;
+    }
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (view == MAP_FAILED) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    fd_ = fd;
+    mappingSize_ = size;
+    return static_cast<uint8_t*>(view);
+}
+
+void FlightRecorder::unmapFile() {
+    uint8_t* base = mapping_.exchange(nullptr, std::memory_order_acq_rel);
+    if (base) {
+        msync(base, mappingSize_, MS_ASYNC);
+        munmap(base, mappingSize_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    mappingSize_ = 0;
+}
+
+#endif
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+// On-disk layout, shared with tools/FlightRecorderDump.cpp.
+//
+// The file is a FileHeader followed by slotCount fixed-size slots. Slot i holds
+// record number n where n % slotCount == i; its seq field is n + 1 once the
+// record is complete and 0 while it is being written (or was never written).
+namespace FlightRecorderFormat {
+    constexpr uint32_t MAGIC = 0x52464D53; // "SMFR"
+    constexpr uint32_t VERSION = 1;
+
+    enum class Direction : uint8_t {
+        Inbound = 0,
+        Outbound = 1,
+        Connected = 2,      // Payload is the endpoint URL
+        Disconnected = 3    // Payload is the reason, if any
+    };
+
+    enum Flags : uint8_t {
+        FLAG_FINAL_FRAGMENT = 1 << 0,   // Last (or only) fragment of a message
+        FLAG_TRUNCATED = 1 << 1         // Payload longer than the slot; only the start was kept
+    };
+
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t slotCount;
+        uint32_t slotSize;          // Bytes per slot, SlotHeader included
+        uint64_t steadyAtOpenNs;    // steady_clock and system_clock read together at open,
+        int64_t systemAtOpenNs;     // so slot timestamps can be shown as wall-clock time
+        uint64_t nextIndex;         // Next record number; advanced atomically by writers
+        uint8_t reserved[24];
+    };
+    static_assert(sizeof(FileHeader) == 64, "FileHeader layout changed");
+
+    struct SlotHeader {
+        uint64_t seq;               // Record number + 1, or 0 if empty/incomplete
+        uint64_t timestampNs;       // steady_clock
+        uint32_t epoch;             // Connection epoch, unique per established connection
+        uint8_t direction;          // Direction
+        uint8_t flags;              // Flags
+        uint16_t reserved;
+        uint32_t length;            // Original payload length
+        uint32_t stored;            // Bytes actually stored after the header
+    };
+    static_assert(sizeof(SlotHeader) == 32, "SlotHeader layout changed");
+}
+
+// Always-on recorder of raw WebSocket frames.
+//
+// Records go into a fixed-size ring in a memory-mapped file, so whatever was
+// written is still on disk if the game crashes. record() claims a slot with a
+// single atomic increment and copies the payload with credentials masked; it
+// never blocks or allocates, so it is safe to call from the lws service thread.
+// Decode the file with tools/FlightRecorderDump.
+class FlightRecorder {
+public:
+    using Direction = FlightRecorderFormat::Direction;
+
+    static FlightRecorder& instance();
+
+    // Map the ring file, creating or resizing it as needed. A previous valid
+    // recording is kept next to it as <name>.prev so the one from a crashed
+    // session survives the next launch.
+    bool open(const std::filesystem::path& path, uint32_t slotCount, uint32_t slotSize);
+
+    // Unmap the file. Only call once nothing can be inside record() any more.
+    void close();
+
+    bool isOpen() const {
+        return mapping_.load(std::memory_order_acquire) != nullptr;
+    }
+
+    // Epoch for a newly established connection (process-wide, starts at 1)
+    uint32_t nextEpoch() {
+        return epoch_.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    // Where a scan for credentials left off at the end of a record. The string
+    // values of "token" and "password" keys are written as '*' (same length),
+    // so the file never holds the auth token or a lobby password. Keep one per
+    // connection for fragments that continue each other, and reset it with
+    // the connection.
+    struct Redaction {
+        uint8_t phase = 0;
+        uint8_t tokenMatch = 0;     // Bytes of "token" (quotes included) seen so far
+        uint8_t passwordMatch = 0;
+    };
+
+    // Append one record; silently does nothing when the recorder isn't open.
+    // Without a redaction the record is scanned on its own.
+    void record(Direction direction, uint32_t epoch, const void* data, size_t length, uint8_t flags = 0,
+        Redaction* redaction = nullptr);
+
+    void record(Direction direction, uint32_t epoch, const std::string& text) {
+        record(direction, epoch, text.data(), text.size(), FlightRecorderFormat::FLAG_FINAL_FRAGMENT);
+    }
+
+    const std::filesystem::path& path() const {
+        return path_;
+    }
+
+private:
+    FlightRecorder() = default;
+    ~FlightRecorder();
+
+    // Non-copyable
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+    // Create the file at the given size and map it; the view isn't published yet
+    uint8_t* mapFile(const std::filesystem::path& path, size_t size);
+    void unmapFile();
+
+    std::atomic<uint8_t*> mapping_{ nullptr };
+    size_t mappingSize_ = 0;
+    uint32_t slotCount_ = 0;
+    uint32_t slotSize_ = 0;
+    std::filesystem::path path_;
+    std::atomic<uint32_t> epoch_{ 0 };
+
+#ifdef _WIN32
+    void* fileHandle_ = nullptr;
+    void* mappingHandle_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
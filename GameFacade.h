@@ -0,0 +1,140 @@
+#pragma once
+
+#include "HookProfiler.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// A private match to create, without BakkesMod types so lobby logic can run headless
+struct PrivateMatchRequest {
+    std::string serverName;
+    std::string password;
+    std::string mapName;
+    std::string region = "USE"; // USE, USW, EU, OCE, SAM, ME, ASC, ASM, JPN, SAF
+};
+
+// A private match with the game's settings already built from its request, so
+// creating it is a single call. Made by IGameFacade::prepareMatch; what else
+// is inside is up to the facade that made it.
+class PreparedMatch {
+public:
+    explicit PreparedMatch(PrivateMatchRequest request) : request_(std::move(request)) {}
+    virtual ~PreparedMatch() = default;
+
+    // Non-copyable
+    PreparedMatch(const PreparedMatch&) = delete;
+    PreparedMatch& operator=(const PreparedMatch&) = delete;
+
+    const PrivateMatchRequest& request() const { return request_; }
+
+private:
+    PrivateMatchRequest request_;
+};
+
+// Stat ticker events match telemetry keeps; the game has more, they're ignored
+enum class StatKind : uint8_t {
+    Goal,
+    Assist,
+    Save,
+    EpicSave,
+    Shot,
+    Demolition
+};
+
+struct StatEvent {
+    StatKind kind;
+    uintptr_t player;   // Opaque handle, stable for the match; 0 if unknown
+    int team;           // 0 blue, 1 orange, -1 unknown
+};
+
+// One car's physics state for one tick
+struct CarState {
+    uintptr_t player;   // Same handle StatEvent uses; 0 if the car has no owner yet
+    float position[3];  // Unreal units
+    float velocity[3];  // Unreal units per second
+    float boost;        // 0 to 1
+};
+
+// End-of-match scoreboard
+struct PlayerResult {
+    uintptr_t player = 0;       // Same handle StatEvent uses
+    std::string name;
+    std::string platformId;     // e.g. "Steam|76561198000000000|0"
+    int team = -1;
+    int score = 0;
+    int goals = 0;
+    int assists = 0;
+    int saves = 0;
+    int shots = 0;
+    int demolitions = 0;
+};
+
+struct MatchResult {
+    std::string matchGuid;
+    bool privateMatch = false;
+    int teamScore[2] = { 0, 0 };
+    std::vector<PlayerResult> players;  // Spectators left out
+};
+
+// The part of the game the dispatch and lobby code uses.
+//
+// BakkesGameFacade forwards to GameWrapper and MatchmakingWrapper inside the
+// game; tools/SimulatedGame.h implements it with a scripted engine so the same
+// code can run on Linux with reproducible ticks and hook events.
+class IGameFacade {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Callback = std::function<void()>;
+    using HookCallback = std::function<void(const std::string& eventName)>;
+
+    virtual ~IGameFacade() = default;
+
+    // Clock for latency and TTL bookkeeping: steady_clock in the game, virtual
+    // time in the simulator. Safe to call from any thread.
+    virtual Clock::time_point now() const = 0;
+
+    // Run on the game thread; safe to call from any thread
+    virtual void execute(Callback callback) = 0;
+
+    // Run on the game thread after a delay
+    virtual void setTimeout(Callback callback, float seconds) = 0;
+
+    virtual void hookEvent(const std::string& eventName, HookCallback callback) = 0;
+
+    virtual bool isInOnlineGame() const = 0;
+
+    // True once the game has loaded far enough to act on lobby messages.
+    // Hooks can fire before that, e.g. during the startup movies.
+    virtual bool isGameReady() const = 0;
+
+    // Called on the game thread for every stat ticker event of a kind in
+    // StatKind. Runs during gameplay, so implementations don't allocate per event.
+    using StatCallback = std::function<void(const StatEvent& event)>;
+    virtual void hookStatEvents(StatCallback callback) = 0;
+
+    // Called on the game thread for every car on every physics tick
+    // (Car_TA.SetVehicleInput), the hottest path the plugin has. Implementations
+    // read a few fields and don't allocate; callbacks should do no more. The
+    // fields are only read while wanted returns true, and every call, reads
+    // included, is timed into the profiler's hook.
+    using CarStateFilter = std::function<bool()>;
+    using CarStateCallback = std::function<void(const CarState& state)>;
+    virtual void hookCarStates(HookProfiler& profiler, size_t hook, CarStateFilter wanted,
+        CarStateCallback callback) = 0;
+
+    // Scoreboard of the online match in progress (or just ended); false if
+    // there is none. Allocates, so call it at match end rather than per tick.
+    virtual bool readMatchResult(MatchResult& result) const = 0;
+
+    // Parse and build everything createPrivateMatch needs, ahead of time.
+    // Safe to call from any thread.
+    virtual std::unique_ptr<PreparedMatch> prepareMatch(const PrivateMatchRequest& request) = 0;
+
+    // Both return false when matchmaking isn't available right now. The match
+    // must come from this facade's prepareMatch.
+    virtual bool joinPrivateMatch(const std::string& lobbyName, const std::string& password) = 0;
+    virtual bool createPrivateMatch(const PreparedMatch& match) = 0;
+};
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Per-hook call counts and cost histograms for the game hooks.
+//
+// Costs go into power-of-two nanosecond buckets (bucket i holds [2^i, 2^(i+1)) ns),
+// so recording is a couple of relaxed atomic adds and never allocates. Hooks are
+// registered once in onLoad; recording from the game thread while the render
+// thread reads the numbers is fine.
+class HookProfiler {
+public:
+    static constexpr size_t MAX_HOOKS = 8;
+    static constexpr size_t BUCKETS = 32;
+
+    using Clock = std::chrono::steady_clock;
+
+    HookProfiler() {
+        reset();
+    }
+
+    // Non-copyable
+    HookProfiler(const HookProfiler&) = delete;
+    HookProfiler& operator=(const HookProfiler&) = delete;
+
+    // Register a hook by display name. Call before recording starts.
+    size_t registerHook(const char* name) {
+        if (hookCount_ >= MAX_HOOKS) {
+            return MAX_HOOKS - 1; // Fold extras into the last slot rather than crash
+        }
+        hooks_[hookCount_].name = name;
+        return hookCount_++;
+    }
+
+    void record(size_t hook, uint64_t nanos) {
+        HookStats& stats = hooks_[hook];
+        stats.calls.fetch_add(1, std::memory_order_relaxed);
+        stats.totalNanos.fetch_add(nanos, std::memory_order_relaxed);
+        stats.buckets[bucketFor(nanos)].fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t max = stats.maxNanos.load(std::memory_order_relaxed);
+        while (nanos > max && !stats.maxNanos.compare_exchange_weak(max, nanos, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Count a rendered frame; used to express hook cost as a share of frame time
+    void recordFrame() {
+        frames_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Times a hook body for as long as it is in scope
+    class Scope {
+    public:
+        Scope(HookProfiler& profiler, size_t hook)
+            : profiler_(profiler), hook_(hook), start_(Clock::now()) {}
+        ~Scope() {
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_).count();
+            profiler_.record(hook_, static_cast<uint64_t>(elapsed));
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        HookProfiler& profiler_;
+        size_t hook_;
+        Clock::time_point start_;
+    };
+
+    void reset() {
+        for (auto& stats : hooks_) {
+            stats.calls.store(0, std::memory_order_relaxed);
+            stats.totalNanos.store(0, std::memory_order_relaxed);
+            stats.maxNanos.store(0, std::memory_order_relaxed);
+            for (auto& bucket : stats.buckets) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+        frames_.store(0, std::memory_order_relaxed);
+        windowStartNanos_.store(nowNanos(), std::memory_order_relaxed);
+    }
+
+    // Human-readable report, one line per entry. Allocates; call it from a
+    // notifier or at match end, not per frame.
+    std::vector<std::string> report() const {
+        std::vector<std::string> lines;
+        uint64_t windowNanos = nowNanos() - windowStartNanos_.load(std::memory_order_relaxed);
+        uint64_t frames = frames_.load(std::memory_order_relaxed);
+        uint64_t pluginNanos = 0;
+
+        for (size_t i = 0; i < hookCount_; ++i) {
+            const HookStats& stats = hooks_[i];
+            uint64_t calls = stats.calls.load(std::memory_order_relaxed);
+            uint64_t total = stats.totalNanos.load(std::memory_order_relaxed);
+            pluginNanos += total;
+            if (calls == 0) {
+                lines.push_back(std::string(stats.name) + ": no calls");
+                continue;
+            }
+
+            std::string line = std::string(stats.name)
+                + ": calls=" + std::to_string(calls)
+                + " avg=" + std::to_string(total / calls) + "ns"
+                + " p50<" + std::to_string(percentileUpperBound(stats, calls, 50)) + "ns"
+                + " p99<" + std::to_string(percentileUpperBound(stats, calls, 99)) + "ns"
+                + " max=" + std::to_string(stats.maxNanos.load(std::memory_order_relaxed)) + "ns";
+            lines.push_back(line);
+        }
+
+        if (windowNanos > 0) {
+            double share = 100.0 * static_cast<double>(pluginNanos) / static_cast<double>(windowNanos);
+            std::string summary = "Plugin hooks: " + std::to_string(pluginNanos / 1000) + "us over "
+                + std::to_string(windowNanos / 1000000) + "ms (" + std::to_string(share) + "% of wall time)";
+            if (frames > 0) {
+                summary += ", " + std::to_string(pluginNanos / frames) + "ns per frame, avg frame "
+                    + std::to_string(windowNanos / frames / 1000) + "us";
+            }
+            lines.push_back(summary);
+        }
+        return lines;
+    }
+
+private:
+    struct HookStats {
+        const char* name = "";
+        std::atomic<uint64_t> calls;
+        std::atomic<uint64_t> totalNanos;
+        std::atomic<uint64_t> maxNanos;
+        std::array<std::atomic<uint64_t>, BUCKETS> buckets;
+    };
+
+    static size_t bucketFor(uint64_t nanos) {
+        size_t bucket = 0;
+        while (nanos > 1 && bucket < BUCKETS - 1) {
+            nanos >>= 1;
+            ++bucket;
+        }
+        return bucket;
+    }
+
+    // Upper bound of the bucket containing the given percentile
+    static uint64_t percentileUpperBound(const HookStats& stats, uint64_t calls, int percentile) {
+        uint64_t target = (calls * percentile + 99) / 100;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += stats.buckets[i].load(std::memory_order_relaxed);
+            if (seen >= target) {
+                return uint64_t{ 1 } << (i + 1);
+            }
+        }
+        return uint64_t{ 1 } << BUCKETS;
+    }
+
+    static uint64_t nowNanos() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now().time_since_epoch()).count());
+    }
+
+    std::array<HookStats, MAX_HOOKS> hooks_;
+    size_t hookCount_ = 0;
+    std::atomic<uint64_t> frames_;
+    std::atomic<uint64_t> windowStartNanos_;
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// One version of the live 6mans queue as the server described it:
+// {"status": "waiting" | "picking" | "in_match", "players": [{"id", "name"}],
+//  "teams": {"blue": [names], "orange": [names]}}. Unknown fields are kept.
+struct LiveQueueState {
+    uint64_t seq = 0;
+    bool synced = false;    // False before the first snapshot and from a gap until the resync lands
+    json document = json::object();
+};
+
+// Client-side copy of the live queue, built from a sequenced queue_snapshot and
+// kept current with queue_delta messages carrying RFC 6902 patches.
+//
+// Each applied message publishes a new immutable LiveQueueState, so readers on
+// any thread just load a pointer. The published state doubles as the working
+// document: a delta is patched onto the current one and the result becomes the
+// next snapshot, so nothing is copied twice. Writers are serialised; they are
+// the network thread(s) and injectMessage, never the game thread.
+class LiveQueue {
+public:
+    enum class Result {
+        Applied,
+        Stale,          // Older than what we have (duplicate or reordered), ignored
+        NeedsResync,    // Gap in seq, bad patch, or no snapshot yet
+    };
+
+    LiveQueue()
+        : current_(std::make_shared<const LiveQueueState>()) {}
+
+    // Non-copyable
+    LiveQueue(const LiveQueue&) = delete;
+    LiveQueue& operator=(const LiveQueue&) = delete;
+
+    std::shared_ptr<const LiveQueueState> load() const {
+        return current_.load(std::memory_order_acquire);
+    }
+
+    Result applySnapshot(uint64_t seq, const json& state) {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        staleFromDisconnect_ = false;
+        std::shared_ptr<const LiveQueueState> current = load();
+        if (current->synced && seq < current->seq) {
+            return Result::Stale;
+        }
+        publish(seq, true, state);
+        return Result::Applied;
+    }
+
+    Result applyDelta(uint64_t seq, const json& patch) {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        std::shared_ptr<const LiveQueueState> current = load();
+        if (!current->synced) {
+            return Result::NeedsResync;
+        }
+        if (seq <= current->seq) {
+            return Result::Stale;
+        }
+        if (seq != current->seq + 1) {
+            staleFromDisconnect_ = false;
+            publish(current->seq, false, current->document); // Keep showing it, flagged as behind
+            return Result::NeedsResync;
+        }
+
+        try {
+            publish(seq, true, current->document.patch(patch));
+        }
+        catch (const json::exception&) {
+            staleFromDisconnect_ = false;
+            publish(current->seq, false, current->document);
+            return Result::NeedsResync;
+        }
+        return Result::Applied;
+    }
+
+    // The session resumed: the server replays every delta we missed, so the
+    // stale copy is current again as of its seq
+    void resume() {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        std::shared_ptr<const LiveQueueState> current = load();
+        if (staleFromDisconnect_) {
+            staleFromDisconnect_ = false;
+            publish(current->seq, true, current->document);
+        }
+    }
+
+    // The link went away; whatever we have is no longer being kept current
+    void markStale() {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        std::shared_ptr<const LiveQueueState> current = load();
+        if (current->synced) {
+            staleFromDisconnect_ = true;
+            publish(current->seq, false, current->document);
+        }
+    }
+
+private:
+    void publish(uint64_t seq, bool synced, json document) {
+        auto next = std::make_shared<LiveQueueState>();
+        next->seq = seq;
+        next->synced = synced;
+        next->document = std::move(document);
+        current_.store(std::move(next), std::memory_order_release);
+    }
+
+    std::mutex writeMutex_;
+    bool staleFromDisconnect_ = false;  // Only then can resume() trust the copy
+    std::atomic<std::shared_ptr<const LiveQueueState>> current_;
+};
@@ -0,0 +1,469 @@
+#include "pch.h"
+#include "LobbyController.h"
+#include "Config.h"
+#include "logging.h"
+#include "AsyncLog.h"
+#include "Metrics.h"
+#include <cstring>
+#include <iterator>
+
+namespace {
+    constexpr const char* MAP_POOL[] = {
+        "Stadium_Day_P",       // DFH Stadium (Day)
+        "Stadium_Foggy_P",     // DFH Stadium (Stormy)
+        "Stadium_P",           // DFH Stadium (Night)
+        "EuroStadium_P",       // MannField (Day)
+        "EuroStadium_Night_P", // Mannfield (Night)
+        "EuroStadium_Rainy_P", // Mannfield (Stormy)
+        "UtopiaStadium_P",     // Utopia Coliseum (Day)
+        "UtopiaStadium_Dusk_P",// Utopia Coliseum (Dusk)
+        "cs_p",                // Champions Field (Night)
+        "cs_day_p",            // Champions Field (Day)
+        "Park_P",              // Beckwith Park (Day)
+        "Park_Night_P",        // Beckwith Park (Night)
+        "Park_Rainy_P"         // Beckwith Park (Stormy)
+    };
+}
+
+LobbyController::LobbyController(IGameFacade& game, std::shared_ptr<SettingsSnapshot> settings, NetworkSource network)
+    : game_(game), settings_(std::move(settings)), network_(std::move(network)) {
+    // Seed once here rather than per lobby
+    mapRng_.seed(std::random_device{}());
+}
+
+void LobbyController::install() {
+    // Join result events drive the join state machine
+    game_.hookEvent(SixMansConfig::JOIN_SUCCESS_EVENT, [this](const std::string&) {
+        onJoinSucceeded();
+        });
+    game_.hookEvent(SixMansConfig::JOIN_FAILURE_EVENT, [this](const std::string&) {
+        onJoinFailed("game reported an error");
+        });
+
+    // Hook the game tick event to process network messages
+    size_t initGameHook = hookProfiler_.registerHook("InitGame");
+    game_.hookEvent("Function TAGame.GameEvent_Soccar_TA.InitGame", [this, initGameHook](const std::string&) {
+        hookProfiler_.reset(); // Profile each match on its own
+        HookProfiler::Scope scope(hookProfiler_, initGameHook);
+        onMatchStarted();
+        dispatch();
+        });
+
+    // Also hook car spawn to ensure we're processing messages during gameplay
+    size_t vehicleInputHook = hookProfiler_.registerHook("SetVehicleInput");
+    game_.hookEvent("Function TAGame.Car_TA.SetVehicleInput", [this, vehicleInputHook](const std::string&) {
+        HookProfiler::Scope scope(hookProfiler_, vehicleInputHook);
+        dispatch();
+        });
+
+    // Frame counter so hook cost can be expressed per frame
+    game_.hookEvent("Function Engine.GameViewportClient.Tick", [this](const std::string&) {
+        hookProfiler_.recordFrame();
+        });
+
+    game_.hookEvent("Function TAGame.GameEvent_Soccar_TA.EventMatchEnded", [this](const std::string&) {
+        logHookProfile();
+        });
+
+    // Match reports read the lobby name at match end, before this fires
+    game_.hookEvent("Function TAGame.GameEvent_Soccar_TA.Destroyed", [this](const std::string&) {
+        onMatchDestroyed();
+        });
+}
+
+void LobbyController::logHookProfile() {
+    for (const std::string& line : hookProfiler_.report()) {
+        LOG("[profile] {}", line);
+    }
+}
+
+double LobbyController::takeMeanDispatchLatencyMs() {
+    double mean = dispatchLatencySamples_ > 0 ? dispatchLatencySumMs_ / dispatchLatencySamples_ : 0.0;
+    dispatchLatencySumMs_ = 0.0;
+    dispatchLatencySamples_ = 0;
+    return mean;
+}
+
+void LobbyController::dispatch() {
+    NetworkManager* network = network_();
+    if (!network) {
+        return;
+    }
+
+    // The network comes up while the game is still loading. Until the game is
+    // ready, messages wait in the network queue; deadlines still apply to them.
+    if (!gameReady_) {
+        if (!game_.isGameReady()) {
+            return;
+        }
+        gameReady_ = true;
+        LOG("Game ready, {} buffered message(s) to dispatch", network->getQueueSize());
+    }
+
+    // Process a few messages per tick to avoid blocking the game thread
+    for (int i = 0; i < SixMansConfig::MESSAGES_PER_TICK; ++i) {
+        auto messageOpt = network->getNextMessage();
+        if (!messageOpt.has_value()) {
+            break; // No more messages
+        }
+
+        try {
+            // A backlog (a long load screen, a hitch) can outlast the server's
+            // deadline; better to skip the action than act on a stale one
+            Clock::time_point now = game_.now();
+            if (now >= messageOpt->deadline) {
+                ++expiredDropCount_;
+                Metrics::instance().droppedStale.add();
+                ASYNC_LOG(LogLevel::Info, "Dropping {} message, deadline passed {} ms ago while queued",
+                    messageOpt->message.value("type", ""),
+                    std::chrono::duration_cast<std::chrono::milliseconds>(now - messageOpt->deadline).count());
+                continue;
+            }
+
+            // The message was already parsed on the network thread, hand it over as-is
+            // instead of dumping and re-parsing it here.
+            Clock::duration queueWait = now - messageOpt->receivedAt;
+            dispatchLatencySumMs_ += std::chrono::duration<double, std::milli>(queueWait).count();
+            ++dispatchLatencySamples_;
+            Metrics::instance().dispatchLatency.observe(queueWait);
+
+            handleLobbyMessage(*messageOpt);
+
+            if (dispatchObserver_) {
+                dispatchObserver_(*messageOpt, queueWait);
+            }
+        }
+        catch (const std::exception& e) {
+            ASYNC_LOG(LogLevel::Error, "Error processing message in dispatcher: {}", e.what());
+        }
+    }
+}
+
+void LobbyController::handleLobbyMessage(const InboundMessage& inbound) {
+    const json& messageJson = inbound.message;
+
+    // Log what arrived, never the body: it carries lobby passwords
+    ASYNC_LOG(LogLevel::Debug, "Processing {} message (action: {})",
+        messageJson.value("type", ""), messageJson.value("action", "-"));
+
+    try {
+        // Handle different message types
+        if (messageJson.contains("type")) {
+            std::string messageType = messageJson["type"];
+
+            if (messageType == "lobby_action" && messageJson.contains("action")) {
+                std::string action = messageJson["action"];
+
+                if (action == "join") {
+                    // Check if auto-join is enabled
+                    if (settings_->load()->autoJoin) {
+                        // Extract lobby details if they exist in the message
+                        if (messageJson.contains("lobbyName") && messageJson.contains("password")) {
+                            std::string lobbyName = messageJson["lobbyName"];
+                            std::string password = messageJson["password"];
+
+                            // Join the lobby with the provided details
+                            ASYNC_LOG(LogLevel::Info, "Auto-joining lobby: {}", lobbyName);
+                            startJoin(lobbyName, password, inbound.receivedAt);
+                        }
+                        else {
+                            ASYNC_LOG(LogLevel::Warn, "Received join action but missing lobby details");
+                        }
+                    }
+                }
+                else if (action == "create") {
+                    // Check if auto-create is enabled
+                    if (settings_->load()->autoCreate) {
+                        ASYNC_LOG(LogLevel::Info, "Auto-creating lobby");
+                        createLobby();
+                    }
+                }
+                else if (action == "go") {
+                    runPreparedLobby(messageJson["prepareId"].get<std::string>(), inbound.receivedAt);
+                }
+            }
+            else if (messageType == "lobby_prepare") {
+                prepareLobby(messageJson);
+            }
+            else if (messageType == "auth_response") {
+                bool success = messageJson.value("success", false);
+                if (success) {
+                    LOG("Server authentication successful");
+                }
+                else {
+                    LOG("Server authentication failed: {}", messageJson.value("error", "Unknown error"));
+                }
+            }
+        }
+    }
+    catch (const json::exception& e) {
+        ASYNC_LOG(LogLevel::Error, "Failed to parse message as JSON: {}", e.what());
+    }
+    catch (const std::exception& e) {
+        ASYNC_LOG(LogLevel::Error, "Error processing message: {}", e.what());
+    }
+}
+
+void LobbyController::requestCreate() {
+    std::weak_ptr<bool> alive = alive_;
+    game_.execute([this, alive] {
+        if (alive.expired()) {
+            return;
+        }
+        createLobby();
+        });
+}
+
+void LobbyController::createLobby() {
+    std::string randomMap = pickRandomMap();
+    LOG("Selected map: " + randomMap);
+
+    PrivateMatchRequest request;
+    request.serverName = "smtty";
+    request.password = "secure123";
+    request.mapName = randomMap;
+    createPrivateMatch(*game_.prepareMatch(request));
+}
+
+std::string LobbyController::pickRandomMap() {
+    std::uniform_int_distribution<size_t> distr(0, std::size(MAP_POOL) - 1);
+    return MAP_POOL[distr(mapRng_)];
+}
+
+void LobbyController::createPrivateMatch(const PreparedMatch& match) {
+    const PrivateMatchRequest& request = match.request();
+    // Ensure the game is not already in an online match
+    if (game_.isInOnlineGame()) {
+        LOG("Already in an online match, cannot create a private match.");
+        report("create_failed", request.serverName, "already in an online match");
+        return;
+    }
+    if (game_.createPrivateMatch(match)) {
+        // Bound to the next online match; whatever is torn down before that isn't it
+        lobbyName_ = request.serverName;
+        inLobbyMatch_ = false;
+        report("created", request.serverName);
+    }
+    else {
+        report("create_failed", request.serverName, "matchmaking unavailable");
+    }
+}
+
+void LobbyController::prepareLobby(const json& messageJson) {
+    // Do all parsing and settings construction now so "go" only has to fire
+    PreparedLobby prepared;
+    prepared.id = messageJson["prepareId"];
+    prepared.create = messageJson["action"] == "create";
+    prepared.lobbyName = messageJson["lobbyName"];
+    prepared.password = messageJson["password"];
+    prepared.preparedAt = game_.now();
+
+    if (prepared.create) {
+        PrivateMatchRequest request;
+        request.serverName = prepared.lobbyName;
+        request.password = prepared.password;
+        request.mapName = messageJson.value("map", "");
+        if (request.mapName.empty()) {
+            request.mapName = pickRandomMap();
+        }
+        request.region = messageJson.value("region", "USE");
+        prepared.match = game_.prepareMatch(request);
+    }
+
+    LOG("Prepared {} for lobby {} ({})", prepared.create ? "create" : "join", prepared.lobbyName, prepared.id);
+    preparedLobby_ = std::move(prepared);
+}
+
+void LobbyController::runPreparedLobby(const std::string& prepareId, Clock::time_point receivedAt) {
+    if (!preparedLobby_ || preparedLobby_->id != prepareId) {
+        LOG("go for unknown lobby preparation {}", prepareId);
+        return;
+    }
+
+    PreparedLobby prepared = std::move(*preparedLobby_);
+    preparedLobby_.reset();
+
+    if (receivedAt - prepared.preparedAt > std::chrono::seconds(SixMansConfig::PREPARED_LOBBY_TTL_S)) {
+        LOG("Lobby preparation {} expired", prepareId);
+        return;
+    }
+
+    if (prepared.create) {
+        if (settings_->load()->autoCreate) {
+            // Already on the game thread, no execute hop needed
+            createPrivateMatch(*prepared.match);
+        }
+    }
+    else if (settings_->load()->autoJoin) {
+        startJoin(prepared.lobbyName, prepared.password, receivedAt);
+    }
+}
+
+void LobbyController::requestJoin(const std::string& lobbyName, const std::string& password) {
+    Clock::time_point requestedAt = game_.now();
+    std::weak_ptr<bool> alive = alive_;
+    game_.execute([this, alive, lobbyName, password, requestedAt] {
+        if (alive.expired()) {
+            return;
+        }
+        startJoin(lobbyName, password, requestedAt);
+        });
+}
+
+void LobbyController::requestRetryJoin() {
+    std::weak_ptr<bool> alive = alive_;
+    game_.execute([this, alive] {
+        if (alive.expired()) {
+            return;
+        }
+        if (joinRequest_.lobbyName.empty()) {
+            LOG("No lobby to join yet, wait for the server to send one.");
+            return;
+        }
+        startJoin(joinRequest_.lobbyName, joinRequest_.password, game_.now());
+        });
+}
+
+void LobbyController::startJoin(const std::string& lobbyName, const std::string& password,
+    Clock::time_point receivedAt) {
+    bool inFlight = joinState_ == JoinState::Joining || joinState_ == JoinState::Retrying;
+    if (inFlight && joinRequest_.lobbyName == lobbyName && joinRequest_.password == password) {
+        LOG("Already joining {}, ignoring duplicate request.", lobbyName);
+        return;
+    }
+
+    // A new lobby supersedes whatever was in flight; its timers see the new
+    // generation and drop out
+    joinRequest_.lobbyName = lobbyName;
+    joinRequest_.password = password;
+    joinRequest_.receivedAt = receivedAt;
+    joinRequest_.attempt = 0;
+    ++joinRequest_.generation;
+
+    attemptJoin(joinRequest_.generation);
+}
+
+void LobbyController::attemptJoin(unsigned generation) {
+    if (generation != joinRequest_.generation) {
+        return; // Superseded by a newer request
+    }
+
+    if (game_.isInOnlineGame()) {
+        LOG("Already in an online match, not joining {}.", joinRequest_.lobbyName);
+        joinState_ = JoinState::Failed;
+        report("join_failed", joinRequest_.lobbyName, "already in an online match");
+        return;
+    }
+
+    joinState_ = JoinState::Joining;
+    int attempt = joinRequest_.attempt;
+    if (!game_.joinPrivateMatch(joinRequest_.lobbyName, joinRequest_.password)) {
+        onJoinFailed("MatchmakingWrapper unavailable");
+        return;
+    }
+    LOG("Attempting to join private match: {} (attempt {})", joinRequest_.lobbyName, attempt + 1);
+
+    // Neither event fired in time: treat it as a failure so the schedule moves on
+    std::weak_ptr<bool> alive = alive_;
+    game_.setTimeout([this, alive, generation, attempt] {
+        if (alive.expired()) {
+            return;
+        }
+        if (generation != joinRequest_.generation || attempt != joinRequest_.attempt
+            || joinState_ != JoinState::Joining) {
+            return;
+        }
+        if (game_.isInOnlineGame()) {
+            onJoinSucceeded(); // Joined, we just missed the event
+        }
+        else {
+            onJoinFailed("timed out");
+        }
+        }, SixMansConfig::JOIN_ATTEMPT_TIMEOUT_S);
+}
+
+void LobbyController::onJoinSucceeded() {
+    if (joinState_ != JoinState::Joining) {
+        return;
+    }
+
+    joinState_ = JoinState::InLobby;
+    lobbyName_ = joinRequest_.lobbyName;
+    inLobbyMatch_ = true; // Already in its match
+    lastJoinLatencyMs_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+        game_.now() - joinRequest_.receivedAt).count();
+    LOG("Joined {} after {} attempt(s), {}ms from message receipt to in-lobby",
+        joinRequest_.lobbyName, joinRequest_.attempt + 1, lastJoinLatencyMs_);
+    report("joined", joinRequest_.lobbyName);
+}
+
+void LobbyController::onJoinFailed(const char* reason) {
+    if (joinState_ != JoinState::Joining) {
+        return;
+    }
+
+    constexpr int maxRetries = static_cast<int>(std::size(SixMansConfig::JOIN_RETRY_DELAYS_S));
+    if (joinRequest_.attempt >= maxRetries) {
+        joinState_ = JoinState::Failed;
+        LOG("Giving up on {} after {} attempts ({})", joinRequest_.lobbyName, joinRequest_.attempt + 1, reason);
+        report("join_failed", joinRequest_.lobbyName, reason);
+        return;
+    }
+
+    float delay = SixMansConfig::JOIN_RETRY_DELAYS_S[joinRequest_.attempt];
+    ++joinRequest_.attempt;
+    joinState_ = JoinState::Retrying;
+    LOG("Join attempt for {} failed ({}), retrying in {}s", joinRequest_.lobbyName, reason, delay);
+
+    unsigned generation = joinRequest_.generation;
+    std::weak_ptr<bool> alive = alive_;
+    game_.setTimeout([this, alive, generation] {
+        if (alive.expired()) {
+            return;
+        }
+        attemptJoin(generation);
+        }, delay);
+}
+
+void LobbyController::onMatchStarted() {
+    if (!lobbyName_.empty() && game_.isInOnlineGame()) {
+        inLobbyMatch_ = true;
+    }
+}
+
+void LobbyController::onMatchDestroyed() {
+    if (!inLobbyMatch_) {
+        return;
+    }
+    LOG("Left the match of {}", lobbyName_);
+    lobbyName_.clear();
+    inLobbyMatch_ = false;
+    if (joinState_ == JoinState::InLobby) {
+        joinState_ = JoinState::Idle;
+    }
+}
+
+void LobbyController::report(const char* event, const std::string& lobbyName, const char* reason) {
+    // Never the password; the server knows which lobby it sent
+    json status;
+    status["type"] = "lobby_status";
+    status["event"] = event;
+    status["lobbyName"] = lobbyName;
+    if (reason) {
+        status["reason"] = reason;
+    }
+    if (std::strcmp(event, "joined") == 0) {
+        status["attempts"] = joinRequest_.attempt + 1;
+        status["latencyMs"] = lastJoinLatencyMs_;
+    }
+
+    NetworkManager* network = network_();
+    if (network) {
+        network->sendReliable(status);
+        return;
+    }
+    // The next manager flushes the spool after its first accepted auth
+    if (!spool_ || !spool_->append(status.dump())) {
+        ASYNC_LOG(LogLevel::Warn, "No network or spool for the {} report for {}, dropping it", event, lobbyName);
+    }
+}
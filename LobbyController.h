@@ -0,0 +1,148 @@
+#pragma once
+#include "pch.h"
+#include "GameFacade.h"
+#include "HookProfiler.h"
+#include "NetworkManager.h"
+#include "PluginSettings.h"
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+enum class JoinState {
+    Idle,
+    Joining,    // JoinPrivateMatch issued, waiting for the game to report back
+    Retrying,   // Last attempt failed, next one is scheduled
+    InLobby,
+    Failed      // Retry schedule exhausted
+};
+
+// Game-thread side of the plugin: drains the network queue on game hooks and
+// runs lobby creation and the join state machine.
+//
+// Talks to the game only through IGameFacade, so it runs unchanged against
+// the simulated engine in tools/. Everything except the request* methods must
+// be called on the game thread.
+class LobbyController {
+public:
+    using Clock = IGameFacade::Clock;
+
+    // Returns the network manager to drain, or null while there is none
+    using NetworkSource = std::function<NetworkManager*()>;
+
+    // Called after each dispatched message with how long it sat in the queue
+    using DispatchObserver = std::function<void(const InboundMessage& inbound, Clock::duration queueWait)>;
+
+    LobbyController(IGameFacade& game, std::shared_ptr<SettingsSnapshot> settings, NetworkSource network);
+
+    // Non-copyable
+    LobbyController(const LobbyController&) = delete;
+    LobbyController& operator=(const LobbyController&) = delete;
+
+    // Where reports go while there is no network manager (not started yet, or
+    // restarting); one that exists spools them itself. Set before install().
+    void setOutboundSpool(std::shared_ptr<OutboundSpool> spool) { spool_ = std::move(spool); }
+
+    // Hook the dispatch, join result and profiling events. Call once.
+    void install();
+
+    // Drop the join timers and game-thread hops still pending; they can't be
+    // cancelled and would otherwise outlive the plugin. Call on unload.
+    void shutdown() { alive_.reset(); }
+
+    // Any thread: hop to the game thread and create/join
+    void requestCreate();
+    void requestJoin(const std::string& lobbyName, const std::string& password);
+    void requestRetryJoin(); // Retry the last lobby the server sent
+
+    // Process queued network messages; the tick hooks call this
+    void dispatch();
+
+    // Whether dispatch has seen the game ready; messages are held until then
+    bool isGameReady() const { return gameReady_; }
+
+    // Lobby this client joined or created, empty once it has left that
+    // lobby's match (or before it ever was in one)
+    const std::string& getLobbyName() const { return lobbyName_; }
+
+    JoinState getJoinState() const { return joinState_; }
+    long long getLastJoinLatencyMs() const { return lastJoinLatencyMs_; }
+
+    // Mean queue wait of the messages dispatched since the last call, 0 if none
+    double takeMeanDispatchLatencyMs();
+
+    // Messages whose server deadline passed while they waited in the queue
+    size_t getExpiredDropCount() const { return expiredDropCount_; }
+
+    void setDispatchObserver(DispatchObserver observer) { dispatchObserver_ = std::move(observer); }
+
+    // Write the hook profile to the log
+    void logHookProfile();
+
+    HookProfiler& profiler() { return hookProfiler_; }
+
+private:
+    void handleLobbyMessage(const InboundMessage& inbound);
+    void createLobby();
+
+    // Lobby staged by lobby_prepare, fired by a later lobby_action "go"
+    struct PreparedLobby {
+        std::string id;
+        bool create = false;
+        std::string lobbyName;
+        std::string password;
+        std::unique_ptr<PreparedMatch> match; // Set when create is
+        Clock::time_point preparedAt;
+    };
+
+    void prepareLobby(const json& messageJson);
+    void runPreparedLobby(const std::string& prepareId, Clock::time_point receivedAt);
+    std::string pickRandomMap();
+    void createPrivateMatch(const PreparedMatch& match);
+
+    // Lobby join state machine
+    struct JoinRequest {
+        std::string lobbyName;
+        std::string password;
+        Clock::time_point receivedAt;
+        int attempt = 0;
+        unsigned generation = 0; // Bumped per request so stale timers can tell they're stale
+    };
+
+    void startJoin(const std::string& lobbyName, const std::string& password, Clock::time_point receivedAt);
+    void attemptJoin(unsigned generation);
+    void onJoinSucceeded();
+    void onJoinFailed(const char* reason);
+    void onMatchStarted();
+    void onMatchDestroyed();
+
+    // Tell the server how a lobby action went; spooled if the link is down
+    void report(const char* event, const std::string& lobbyName, const char* reason = nullptr);
+
+    IGameFacade& game_;
+    std::shared_ptr<SettingsSnapshot> settings_;
+    NetworkSource network_;
+    std::shared_ptr<OutboundSpool> spool_;
+    std::shared_ptr<bool> alive_ = std::make_shared<bool>(true); // Expires on shutdown, for deferred callbacks
+    bool gameReady_ = false;
+
+    std::optional<PreparedLobby> preparedLobby_;
+    std::mt19937 mapRng_;
+
+    JoinRequest joinRequest_;
+    std::string lobbyName_;
+    bool inLobbyMatch_ = false; // The match of lobbyName_ has started; leaving it clears both
+    JoinState joinState_ = JoinState::Idle;
+    long long lastJoinLatencyMs_ = -1;
+
+    double dispatchLatencySumMs_ = 0.0;
+    int dispatchLatencySamples_ = 0;
+    size_t expiredDropCount_ = 0;
+    DispatchObserver dispatchObserver_;
+
+    // Cost of our game hooks, reset at match start and reported at match end
+    HookProfiler hookProfiler_;
+};
@@ -0,0 +1,181 @@
+#include "pch.h"
+#include "MatchTelemetry.h"
+#include "NetworkManager.h"
+#include "OutboundSpool.h"
+#include "logging.h"
+#include "AsyncLog.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+    // Indexed by StatKind
+    constexpr const char* STAT_KIND_NAMES[] = { "goal", "assist", "save", "epic_save", "shot", "demolition" };
+    static_assert(std::size(STAT_KIND_NAMES) == static_cast<size_t>(StatKind::Demolition) + 1,
+        "STAT_KIND_NAMES out of step with StatKind");
+}
+
+MatchTelemetry::MatchTelemetry(IGameFacade& game, NetworkSource network, LobbySource lobby)
+    : game_(game), network_(std::move(network)), lobby_(std::move(lobby)),
+    recording_(std::make_unique<Columns>()), encoding_(std::make_unique<Columns>()) {}
+
+MatchTelemetry::~MatchTelemetry() {
+    alive_.reset();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+void MatchTelemetry::install() {
+    game_.hookEvent("Function TAGame.GameEvent_Soccar_TA.InitGame", [this](const std::string&) {
+        onMatchStarted();
+        });
+    game_.hookEvent("Function TAGame.GameEvent_Soccar_TA.EventMatchEnded", [this](const std::string&) {
+        onMatchEnded();
+        });
+    game_.hookStatEvents([this](const StatEvent& event) {
+        onStatEvent(event);
+        });
+}
+
+void MatchTelemetry::onMatchStarted() {
+    recording_->clear(game_.now());
+    inMatch_ = true;
+}
+
+void MatchTelemetry::onStatEvent(const StatEvent& event) {
+    if (!inMatch_) {
+        return;
+    }
+    Columns& columns = *recording_;
+    if (columns.count >= MAX_EVENTS) {
+        ++columns.overflow;
+        return;
+    }
+
+    uint8_t player = NO_PLAYER;
+    if (event.player != 0) {
+        for (size_t i = 0; i < columns.playerCount; ++i) {
+            if (columns.players[i] == event.player) {
+                player = static_cast<uint8_t>(i);
+                break;
+            }
+        }
+        if (player == NO_PLAYER && columns.playerCount < MAX_PLAYERS) {
+            player = static_cast<uint8_t>(columns.playerCount);
+            columns.players[columns.playerCount++] = event.player;
+        }
+    }
+
+    long long atMs = std::chrono::duration_cast<std::chrono::milliseconds>(game_.now() - columns.startedAt).count();
+    size_t index = columns.count++;
+    columns.atMs[index] = static_cast<uint32_t>(std::clamp<long long>(atMs, 0, UINT32_MAX));
+    columns.kind[index] = static_cast<uint8_t>(event.kind);
+    columns.player[index] = player;
+}
+
+void MatchTelemetry::onMatchEnded() {
+    if (!inMatch_) {
+        return;
+    }
+    inMatch_ = false;
+    recording_->endedAt = game_.now();
+
+    MatchResult result;
+    if (!game_.readMatchResult(result) || !result.privateMatch) {
+        return;
+    }
+    std::string lobbyName = lobby_();
+    if (lobbyName.empty()) {
+        ASYNC_LOG(LogLevel::Debug, "Private match ended outside a 6mans lobby, not reporting it");
+        return;
+    }
+
+    // The previous report was encoded minutes ago; this only waits if it somehow wasn't
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    std::swap(recording_, encoding_);
+
+    LOG("Match in {} ended {}-{}, reporting {} event(s)", lobbyName, result.teamScore[0], result.teamScore[1],
+        encoding_->count);
+    std::weak_ptr<bool> alive = alive_;
+    worker_ = std::thread([this, alive, result = std::move(result), lobbyName]() {
+        std::string payload = encode(*encoding_, result, lobbyName).dump();
+
+        // The network manager belongs to the game thread; handing it a finished
+        // string there is all that's left. That can happen after we're gone.
+        game_.execute([this, alive, payload = std::move(payload)]() {
+            if (alive.expired()) {
+                return;
+            }
+            NetworkManager* network = network_();
+            bool queued = network ? network->sendReliableText(payload) : spool_ && spool_->append(payload);
+            if (queued) {
+                ++reportCount_;
+            }
+            else if (!network) {
+                LOG("No network or spool for the match report, dropping it");
+            }
+            });
+        });
+}
+
+json MatchTelemetry::encode(const Columns& columns, const MatchResult& result, const std::string& lobbyName) {
+    json report;
+    report["type"] = "match_report";
+    report["lobbyName"] = lobbyName;
+    report["matchGuid"] = result.matchGuid;
+    report["durationMs"] = std::chrono::duration_cast<std::chrono::milliseconds>(
+        columns.endedAt - columns.startedAt).count();
+    report["score"] = { result.teamScore[0], result.teamScore[1] };
+
+    json players = json::array();
+    for (const PlayerResult& player : result.players) {
+        players.push_back({
+            { "id", player.platformId },
+            { "name", player.name },
+            { "team", player.team },
+            { "score", player.score },
+            { "goals", player.goals },
+            { "assists", player.assists },
+            { "saves", player.saves },
+            { "shots", player.shots },
+            { "demolitions", player.demolitions }
+            });
+    }
+    report["players"] = std::move(players);
+
+    // Column player slots to scoreboard rows; someone who left has none
+    std::array<int, MAX_PLAYERS> row;
+    row.fill(-1);
+    for (size_t i = 0; i < columns.playerCount; ++i) {
+        for (size_t j = 0; j < result.players.size(); ++j) {
+            if (result.players[j].player == columns.players[i]) {
+                row[i] = static_cast<int>(j);
+                break;
+            }
+        }
+    }
+
+    json dt = json::array();
+    json kind = json::array();
+    json player = json::array();
+    uint32_t previousMs = 0;
+    for (size_t i = 0; i < columns.count; ++i) {
+        dt.push_back(columns.atMs[i] - previousMs);
+        previousMs = columns.atMs[i];
+        kind.push_back(columns.kind[i]);
+        player.push_back(columns.player[i] == NO_PLAYER ? -1 : row[columns.player[i]]);
+    }
+
+    json events;
+    events["kinds"] = STAT_KIND_NAMES;
+    events["dt"] = std::move(dt);
+    events["kind"] = std::move(kind);
+    events["player"] = std::move(player);
+    if (columns.overflow > 0) {
+        events["dropped"] = columns.overflow;
+    }
+    report["events"] = std::move(events);
+    return report;
+}
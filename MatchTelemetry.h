@@ -0,0 +1,100 @@
+#pragma once
+#include "pch.h"
+#include "GameFacade.h"
+#include "Config.h"
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <nlohmann/json.hpp>
+
+class NetworkManager;
+class OutboundSpool;
+
+using json = nlohmann::json;
+
+// Reports how 6mans matches went, so results don't have to be typed in.
+//
+// During a match every stat event (goal, assist, save, shot, demolition) is
+// appended to preallocated columns: no allocation, a few stores per event. At
+// match end the columns are swapped for the spare set and, with the
+// scoreboard, handed to a worker thread that encodes one match_report. The
+// report goes out through NetworkManager::sendReliableText, so it waits in
+// the outbound spool if the link is down, or if there is no manager at all.
+//
+// Only private matches in a lobby the plugin joined or created are reported.
+// Everything except the destructor runs on the game thread.
+class MatchTelemetry {
+public:
+    using Clock = IGameFacade::Clock;
+
+    // Returns the network manager to report to, or null while there is none
+    using NetworkSource = std::function<NetworkManager*()>;
+
+    // Returns the 6mans lobby this client is in, empty if none
+    using LobbySource = std::function<std::string()>;
+
+    static constexpr size_t MAX_EVENTS = SixMansConfig::MATCH_TELEMETRY_MAX_EVENTS;
+    static constexpr size_t MAX_PLAYERS = 8;
+    static constexpr uint8_t NO_PLAYER = 0xFF;
+
+    // One match's events, column by column
+    struct Columns {
+        std::array<uint32_t, MAX_EVENTS> atMs;          // Since match start
+        std::array<uint8_t, MAX_EVENTS> kind;           // StatKind
+        std::array<uint8_t, MAX_EVENTS> player;         // Index into players, NO_PLAYER if unknown
+        size_t count = 0;
+        size_t overflow = 0;                            // Events past MAX_EVENTS, only counted
+
+        std::array<uintptr_t, MAX_PLAYERS> players;     // Handles in order of first event
+        size_t playerCount = 0;
+
+        Clock::time_point startedAt;
+        Clock::time_point endedAt;
+
+        void clear(Clock::time_point now) {
+            count = 0;
+            overflow = 0;
+            playerCount = 0;
+            startedAt = now;
+        }
+    };
+
+    MatchTelemetry(IGameFacade& game, NetworkSource network, LobbySource lobby);
+    ~MatchTelemetry();
+
+    // Non-copyable
+    MatchTelemetry(const MatchTelemetry&) = delete;
+    MatchTelemetry& operator=(const MatchTelemetry&) = delete;
+
+    // Where reports go while there is no network manager. Set before install().
+    void setOutboundSpool(std::shared_ptr<OutboundSpool> spool) { spool_ = std::move(spool); }
+
+    // Hook match start, match end and stat events. Call once.
+    void install();
+
+    // The report for one match. Events are columns too: time deltas, kind
+    // indexes into "kinds" and player indexes into "players" (-1 if unknown).
+    static json encode(const Columns& columns, const MatchResult& result, const std::string& lobbyName);
+
+    size_t getReportCount() const { return reportCount_; }
+
+private:
+    void onMatchStarted();
+    void onStatEvent(const StatEvent& event);
+    void onMatchEnded();
+
+    IGameFacade& game_;
+    NetworkSource network_;
+    LobbySource lobby_;
+    std::shared_ptr<OutboundSpool> spool_;
+
+    std::unique_ptr<Columns> recording_;    // Filled during the match
+    std::unique_ptr<Columns> encoding_;     // Owned by the worker while it runs
+    std::thread worker_;
+    std::shared_ptr<bool> alive_ = std::make_shared<bool>(true); // Expires in the destructor, for the worker's game_.execute
+    bool inMatch_ = false;
+    size_t reportCount_ = 0;
+};
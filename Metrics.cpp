@@ -0,0 +1,98 @@
+#include "pch.h"
+#include "Metrics.h"
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+
+namespace {
+    void appendHeader(std::string& out, const char* name, const char* help, const char* type) {
+        out += "# HELP ";
+        out += name;
+        out += ' ';
+        out += help;
+        out += "\n# TYPE ";
+        out += name;
+        out += ' ';
+        out += type;
+        out += '\n';
+    }
+
+    void appendSample(std::string& out, const char* name, const char* suffix, const char* labels, const char* value) {
+        out += name;
+        out += suffix;
+        if (labels && *labels) {
+            out += '{';
+            out += labels;
+            out += '}';
+        }
+        out += ' ';
+        out += value;
+        out += '\n';
+    }
+
+    // Counters with the same name are one family: the header goes out once,
+    // with the first one's help
+    void appendCounters(std::string& out, std::initializer_list<const Counter*> counters) {
+        const char* family = nullptr;
+        for (const Counter* counter : counters) {
+            if (!family || std::strcmp(family, counter->name()) != 0) {
+                family = counter->name();
+                appendHeader(out, family, counter->help(), "counter");
+            }
+            appendSample(out, counter->name(), "", counter->labels(), std::to_string(counter->value()).c_str());
+        }
+    }
+
+    void appendGauge(std::string& out, const Gauge& gauge) {
+        appendHeader(out, gauge.name(), gauge.help(), "gauge");
+        appendSample(out, gauge.name(), "", nullptr, std::to_string(gauge.value()).c_str());
+    }
+
+    void appendHistogram(std::string& out, const Histogram& histogram) {
+        std::array<uint64_t, Histogram::BUCKETS + 1> buckets;
+        uint64_t sumMicros;
+        histogram.snapshot(buckets, sumMicros);
+
+        appendHeader(out, histogram.name(), histogram.help(), "histogram");
+        char label[32];
+        char value[32];
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < Histogram::BUCKETS; ++i) {
+            cumulative += buckets[i];
+            std::snprintf(label, sizeof(label), "le=\"%.6f\"", static_cast<double>(uint64_t{ 1 } << i) / 1e6);
+            std::snprintf(value, sizeof(value), "%llu", static_cast<unsigned long long>(cumulative));
+            appendSample(out, histogram.name(), "_bucket", label, value);
+        }
+        cumulative += buckets[Histogram::BUCKETS];
+        std::snprintf(value, sizeof(value), "%llu", static_cast<unsigned long long>(cumulative));
+        appendSample(out, histogram.name(), "_bucket", "le=\"+Inf\"", value);
+
+        std::snprintf(label, sizeof(label), "%.6f", static_cast<double>(sumMicros) / 1e6);
+        appendSample(out, histogram.name(), "_sum", nullptr, label);
+        appendSample(out, histogram.name(), "_count", nullptr, value);
+    }
+}
+
+Metrics& Metrics::instance() {
+    static Metrics metrics;
+    return metrics;
+}
+
+std::string Metrics::render() const {
+    std::string out;
+    out.reserve(8192);
+    appendCounters(out, { &framesReceived });
+    appendCounters(out, { &framesSent });
+    appendCounters(out, { &bytesReceived });
+    appendCounters(out, { &bytesSent });
+    appendCounters(out, { &parseErrors });
+    appendCounters(out, { &reconnects });
+    appendCounters(out, { &connectFailures });
+    appendGauge(out, connected);
+    appendCounters(out, { &droppedInvalid, &droppedDuplicate, &droppedFiltered, &droppedExpired,
+        &droppedQueueFull, &droppedStale });
+    appendGauge(out, queueDepth);
+    appendHistogram(out, rtt);
+    appendHistogram(out, dispatchLatency);
+    return out;
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Process-wide runtime metrics for load tests and test rigs, rendered in the
+// Prometheus text format and served by MetricsServer when that's turned on.
+//
+// Counters and histograms are split into SHARDS cache-line-sized slots. Each
+// thread adds to the slot it was given on first use (round-robin), so the lws
+// threads, the sweep thread and the game thread don't contend for one cache
+// line. Updates are relaxed atomic adds and never allocate; a scrape sums the
+// shards. Gauges are a single atomic, since only the last value counts.
+namespace MetricsShards {
+    constexpr size_t SHARDS = 8;
+
+    // This thread's shard
+    inline size_t index() {
+        static std::atomic<size_t> next{ 0 };
+        thread_local size_t shard = next.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+        return shard;
+    }
+}
+
+class Counter {
+public:
+    // labels is the inside of the braces, e.g. reason="queue_full"; counters
+    // sharing a name are rendered as one metric family
+    Counter(const char* name, const char* help, const char* labels = nullptr)
+        : name_(name), help_(help), labels_(labels) {}
+
+    // Non-copyable
+    Counter(const Counter&) = delete;
+    Counter& operator=(const Counter&) = delete;
+
+    void add(uint64_t n = 1) {
+        shards_[MetricsShards::index()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t value() const {
+        uint64_t total = 0;
+        for (const Shard& shard : shards_) {
+            total += shard.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    const char* name() const { return name_; }
+    const char* help() const { return help_; }
+    const char* labels() const { return labels_; }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{ 0 };
+    };
+
+    const char* name_;
+    const char* help_;
+    const char* labels_;
+    std::array<Shard, MetricsShards::SHARDS> shards_;
+};
+
+class Gauge {
+public:
+    Gauge(const char* name, const char* help) : name_(name), help_(help) {}
+
+    // Non-copyable
+    Gauge(const Gauge&) = delete;
+    Gauge& operator=(const Gauge&) = delete;
+
+    void set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+    const char* name() const { return name_; }
+    const char* help() const { return help_; }
+
+private:
+    const char* name_;
+    const char* help_;
+    std::atomic<int64_t> value_{ 0 };
+};
+
+// Durations in power-of-two microsecond buckets, like HookProfiler's:
+// bucket i counts values up to 2^i us, so the top one is about 8 s and
+// anything longer only counts toward +Inf. Rendered in seconds.
+class Histogram {
+public:
+    static constexpr size_t BUCKETS = 24;
+
+    Histogram(const char* name, const char* help) : name_(name), help_(help) {}
+
+    // Non-copyable
+    Histogram(const Histogram&) = delete;
+    Histogram& operator=(const Histogram&) = delete;
+
+    void observeMicros(uint64_t micros) {
+        Shard& shard = shards_[MetricsShards::index()];
+        shard.buckets[bucketFor(micros)].fetch_add(1, std::memory_order_relaxed);
+        shard.sumMicros.fetch_add(micros, std::memory_order_relaxed);
+    }
+
+    template <typename Rep, typename Period>
+    void observe(std::chrono::duration<Rep, Period> duration) {
+        long long micros = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+        observeMicros(micros > 0 ? static_cast<uint64_t>(micros) : 0);
+    }
+
+    // Per-bucket counts (the last is past the top bucket) and the sum, over all shards
+    void snapshot(std::array<uint64_t, BUCKETS + 1>& buckets, uint64_t& sumMicros) const {
+        buckets.fill(0);
+        sumMicros = 0;
+        for (const Shard& shard : shards_) {
+            for (size_t i = 0; i <= BUCKETS; ++i) {
+                buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+            }
+            sumMicros += shard.sumMicros.load(std::memory_order_relaxed);
+        }
+    }
+
+    const char* name() const { return name_; }
+    const char* help() const { return help_; }
+
+private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<uint64_t>, BUCKETS + 1> buckets{};
+        std::atomic<uint64_t> sumMicros{ 0 };
+    };
+
+    static size_t bucketFor(uint64_t micros) {
+        size_t bucket = 0;
+        while (bucket < BUCKETS && (uint64_t{ 1 } << bucket) < micros) {
+            ++bucket;
+        }
+        return bucket;
+    }
+
+    const char* name_;
+    const char* help_;
+    std::array<Shard, MetricsShards::SHARDS> shards_;
+};
+
+// Everything that's exported. Code that has something to count uses the
+// member directly: Metrics::instance().framesReceived.add().
+class Metrics {
+public:
+    static Metrics& instance();
+
+    // Non-copyable
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    // WebSocket traffic, all links (active, standby, broker)
+    Counter framesReceived{ "sixmans_frames_received_total", "WebSocket messages received" };
+    Counter framesSent{ "sixmans_frames_sent_total", "WebSocket messages sent" };
+    Counter bytesReceived{ "sixmans_received_bytes_total", "WebSocket payload bytes received" };
+    Counter bytesSent{ "sixmans_sent_bytes_total", "WebSocket payload bytes sent" };
+    Counter parseErrors{ "sixmans_parse_errors_total", "Received messages that were not valid JSON" };
+    Counter reconnects{ "sixmans_reconnects_total", "Connections established after a link's first" };
+    Counter connectFailures{ "sixmans_connect_failures_total", "Connection attempts that failed" };
+    Gauge connected{ "sixmans_connected", "1 while the active link is up" };
+
+    // Messages that never reached a handler, by why
+    Counter droppedInvalid{ "sixmans_messages_dropped_total", "Messages dropped before dispatch", "reason=\"invalid\"" };
+    Counter droppedDuplicate{ "sixmans_messages_dropped_total", "", "reason=\"duplicate\"" };
+    Counter droppedFiltered{ "sixmans_messages_dropped_total", "", "reason=\"filtered\"" };
+    Counter droppedExpired{ "sixmans_messages_dropped_total", "", "reason=\"expired\"" };
+    Counter droppedQueueFull{ "sixmans_messages_dropped_total", "", "reason=\"queue_full\"" };
+    Counter droppedStale{ "sixmans_messages_dropped_total", "", "reason=\"expired_in_queue\"" };
+
+    Gauge queueDepth{ "sixmans_queue_depth", "Messages waiting for the game thread" };
+    Histogram rtt{ "sixmans_rtt_seconds", "Round trip of clock sync pings" };
+    Histogram dispatchLatency{ "sixmans_dispatch_latency_seconds", "Time from receipt to dispatch on the game thread" };
+
+    // All of the above in the Prometheus text exposition format (0.0.4). Allocates.
+    std::string render() const;
+
+private:
+    Metrics() = default;
+};
@@ -0,0 +1,135 @@
+#include "pch.h"
+#include "MetricsServer.h"
+#include "Metrics.h"
+#include "logging.h"
+#include <cstring>
+
+namespace {
+    constexpr const char* CONTENT_TYPE = "text/plain; version=0.0.4; charset=utf-8";
+}
+
+MetricsServer::MetricsServer()
+    : context_(nullptr), running_(false), port_(0) {
+    protocols_[0] = {
+        "http",
+        MetricsServer::httpCallback,
+        sizeof(HttpSession),
+        0,
+        0, nullptr, 0
+    };
+    protocols_[1] = { nullptr, nullptr, 0, 0, 0, nullptr, 0 }; // null terminator
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+bool MetricsServer::start(int port) {
+    if (running_.load()) {
+        return false;
+    }
+
+    // Created here rather than on the service thread so a port that can't be
+    // bound is reported to the caller
+    struct lws_context_creation_info info = {};
+    info.port = port;
+    info.iface = "127.0.0.1";
+    info.protocols = protocols_;
+    info.gid = -1;
+    info.uid = -1;
+    context_ = lws_create_context(&info);
+    if (!context_) {
+        LOG("Metrics: can't listen on 127.0.0.1:{}", port);
+        return false;
+    }
+
+    port_ = port;
+    running_.store(true);
+    serviceThread_ = std::make_unique<std::thread>(&MetricsServer::run, this);
+    LOG("Metrics: serving http://127.0.0.1:{}/metrics", port);
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    lws_cancel_service(context_);
+    if (serviceThread_ && serviceThread_->joinable()) {
+        serviceThread_->join();
+    }
+    serviceThread_.reset();
+    lws_context_destroy(context_);
+    context_ = nullptr;
+    LOG("Metrics: stopped");
+}
+
+bool MetricsServer::isRunning() const {
+    return running_.load();
+}
+
+void MetricsServer::run() {
+    while (running_.load()) {
+        lws_service(context_, 100);
+    }
+}
+
+int MetricsServer::httpCallback(struct lws* wsi, enum lws_callback_reasons reason,
+    void* user, void* in, size_t len) {
+    HttpSession* session = static_cast<HttpSession*>(user);
+
+    switch (reason) {
+    case LWS_CALLBACK_HTTP: {
+        const char* uri = static_cast<const char*>(in);
+        if (!uri || std::strcmp(uri, "/metrics") != 0) {
+            if (lws_return_http_status(wsi, HTTP_STATUS_NOT_FOUND, nullptr)) {
+                return -1;
+            }
+            return lws_http_transaction_completed(wsi) ? -1 : 0;
+        }
+
+        // Rendered now, written when the socket can take it
+        delete session->body;
+        session->body = new std::string(LWS_PRE, '\0');
+        session->body->append(Metrics::instance().render());
+
+        unsigned char headers[LWS_PRE + 256];
+        unsigned char* start = headers + LWS_PRE;
+        unsigned char* cursor = start;
+        unsigned char* end = headers + sizeof(headers) - 1;
+        if (lws_add_http_common_headers(wsi, HTTP_STATUS_OK, CONTENT_TYPE,
+                session->body->size() - LWS_PRE, &cursor, end)
+            || lws_finalize_write_http_header(wsi, start, &cursor, end)) {
+            return 1;
+        }
+        lws_callback_on_writable(wsi);
+        return 0;
+    }
+
+    case LWS_CALLBACK_HTTP_WRITEABLE: {
+        if (!session || !session->body) {
+            break;
+        }
+        // lws keeps whatever the socket doesn't take and sends it first
+        std::unique_ptr<std::string> body(session->body);
+        session->body = nullptr;
+        if (lws_write(wsi, reinterpret_cast<unsigned char*>(body->data()) + LWS_PRE, body->size() - LWS_PRE,
+            LWS_WRITE_HTTP_FINAL) < 0) {
+            return -1;
+        }
+        return lws_http_transaction_completed(wsi) ? -1 : 0;
+    }
+
+    case LWS_CALLBACK_CLOSED_HTTP:
+        if (session) {
+            delete session->body;
+            session->body = nullptr;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    return lws_callback_http_dummy(wsi, reason, user, in, len);
+}
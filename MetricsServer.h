@@ -0,0 +1,44 @@
+#pragma once
+#include "pch.h"
+#include <atomic>
+#include <libwebsockets.h>
+#include <memory>
+#include <string>
+#include <thread>
+
+// Serves Metrics::render() at http://127.0.0.1:<port>/metrics, for load tests
+// and rigs to scrape. Uses its own lws context and service thread, so a slow
+// scraper never holds up the game's connection. Binds the loopback interface
+// only; anything other than /metrics gets a 404.
+class MetricsServer {
+public:
+    MetricsServer();
+    ~MetricsServer();
+
+    // Non-copyable
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // Listen on the port. False if it can't be bound (e.g. already in use).
+    bool start(int port);
+    void stop();
+
+    bool isRunning() const;
+    int getPort() const { return port_; }
+
+private:
+    // Per-request state lws allocates (zeroed) for us
+    struct HttpSession {
+        std::string* body;  // LWS_PRE bytes of headroom, then the response
+    };
+
+    static int httpCallback(struct lws* wsi, enum lws_callback_reasons reason,
+        void* user, void* in, size_t len);
+    void run();
+
+    struct lws_context* context_;
+    struct lws_protocols protocols_[2]; // null-terminated
+    std::unique_ptr<std::thread> serviceThread_;
+    std::atomic<bool> running_;
+    int port_;
+};
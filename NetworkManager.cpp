@@ -1,17 +1,78 @@
 #include "pch.h"
 #include "NetworkManager.h"
+#include "Metrics.h"
 #include "Config.h"
 #include "logging.h"
+#include "AsyncLog.h"
 #include <mutex>
 #include <thread>
 #include <queue>
 #include <optional>
+#include <chrono>
+#include <algorithm>
+
+namespace {
+    // Reply fields are server-controlled; json::value throws on the wrong type
+    bool boolField(const json& message, const char* key) {
+        auto it = message.find(key);
+        return it != message.end() && it->is_boolean() && it->get<bool>();
+    }
+
+    std::string stringField(const json& message, const char* key, const char* fallback) {
+        auto it = message.find(key);
+        return it != message.end() && it->is_string() ? it->get<std::string>() : fallback;
+    }
+
+    // Spooled reports are serialised JSON objects; the record number goes in
+    // front so the server can acknowledge it (and spot a repeat) without the
+    // payload being parsed and dumped again
+    std::string withSpoolSeq(uint64_t record, std::string_view payload) {
+        if (payload.size() < 2 || payload.front() != '{') {
+            return std::string(payload);
+        }
+        std::string frame = "{\"spoolSeq\":" + std::to_string(record);
+        if (payload[1] != '}') {
+            frame += ',';
+        }
+        frame.append(payload.substr(1));
+        return frame;
+    }
+}
 
 NetworkManager::NetworkManager()
     : messageQueue_(SixMansConfig::MAX_QUEUE_SIZE),
     running_(false),
-    connected_(false) {
+    connected_(false),
+    hotStandbyEnabled_(SixMansConfig::DEFAULT_HOT_STANDBY),
+    lastPromotionMicros_(-1),
+    promotionCount_(0),
+    authState_(AuthState::None),
+    standbyAuthState_(AuthState::None),
+    handshakeAuth_(SixMansConfig::HANDSHAKE_AUTH),
+    primaryHandshakeAuthId_(0),
+    standbyHandshakeAuthId_(0),
+    upgradeSentAt_(0),
+    firstMessagePending_(false),
+    lastTimeToFirstMessageMicros_(-1),
+    firstAuthenticatedAt_(0),
+    queueResyncPending_(false),
+    queueResyncCount_(0),
+    duplicateCount_(0),
+    clockSyncBurst_(0),
+    clockSyncPending_(false),
+    expiredCount_(0),
+    spoolAcks_(true),
+    spoolLastSent_(0),
+    spoolAckDueAt_(0),
+    filteredCount_(0),
+    subscriptionMask_(~0u),
+    receivedCount_(0),
+    invalidCount_(0),
+    droppedCount_(0),
+    stateVersion_(0),
+    lastRttMs_(-1) {
     wsClient_ = std::make_unique<WebSocketClient>();
+    activeClient_.store(wsClient_.get());
 }
 
 NetworkManager::~NetworkManager() {
@@ -19,32 +80,99 @@ NetworkManager::~NetworkManager() {
 }
 
 bool NetworkManager::start(const std::string& url, const std::string& token) {
+    return start(std::vector<std::string>{ url }, token);
+}
+
+bool NetworkManager::start(const std::vector<std::string>& urls, const std::string& token) {
     if (running_.load()) {
         LOG("NetworkManager already running");
         return false;
     }
 
-    currentUrl_ = url;
-    currentToken_ = token;
+    if (urls.empty()) {
+        LOG("NetworkManager started without endpoints");
+        return false;
+    }
+
+    // A connection broker stands alone: it picks and fails over between the
+    // real endpoints itself, and routes one attachment per account
+    auto broker = std::find_if(urls.begin(), urls.end(), BrokerProtocol::isBrokerUrl);
+    bool viaBroker = broker != urls.end();
+
+    // Rank candidates by handshake RTT before the first connect. A single
+    // endpoint has nothing to choose from, so skip the extra handshake.
+    endpoints_ = viaBroker ? std::vector<std::string>{ *broker } : urls;
+    std::vector<std::string> ranked = endpoints_;
+    if (endpoints_.size() > 1) {
+        auto results = EndpointProber::probeAll(endpoints_, SixMansConfig::ENDPOINT_PROBE_TIMEOUT_MS);
+        ranked = EndpointProber::rank(results);
+        applyProbeResults(results);
+    }
+
+    currentUrl_ = ranked.front();
+    {
+        std::lock_guard<std::mutex> lock(tokenMutex_);
+        currentToken_ = token;
+    }
+    authState_.store(AuthState::None);
+    standbyAuthState_.store(AuthState::None);
+    firstAuthenticatedAt_.store(0);
     running_.store(true);
+    sweepThread_ = std::make_unique<std::thread>(&NetworkManager::sweepLoop, this);
 
-    // Set up callbacks
-    auto messageCallback = [this](const json& message) {
-        this->onMessageReceived(message);
-        };
+    // Set up callbacks. Each client tags its events so we can tell the active
+    // link from the standby one.
+    auto startClient = [this, &token](WebSocketClient* client, const std::vector<std::string>& urls) {
+        auto messageCallback = [this, client](const json& message) {
+            this->onClientMessage(client, message);
+            };
+
+        auto connectionCallback = [this, client](bool connected) {
+            this->onConnectionChanged(client, connected);
+            };
 
-    auto connectionCallback = [this](bool connected) {
-        this->onConnectionChanged(connected);
+        client->setThreadTuning(networkTuning_);
+        client->setHandshakeHeaderProvider([this, client]() {
+            return handshakeHeaders(client);
+            });
+        return client->start(urls, token, messageCallback, connectionCallback);
         };
 
     // Start WebSocket client
-    bool started = wsClient_->start(url, token, messageCallback, connectionCallback);
+    activeClient_.store(wsClient_.get());
+    bool started = startClient(wsClient_.get(), ranked);
     if (!started) {
         LOG("Failed to start WebSocket client");
         running_.store(false);
+        {
+            std::lock_guard<std::mutex> lock(sweepMutex_);
+        }
+        sweepCondition_.notify_all();
+        sweepThread_->join();
+        sweepThread_.reset();
         return false;
     }
 
+    // The standby prefers the second-best endpoint so one server going away
+    // doesn't take both links with it
+    if (hotStandbyEnabled_ && viaBroker) {
+        LOG("Hot standby is the broker's business; not opening a second link");
+    }
+    else if (hotStandbyEnabled_) {
+        std::vector<std::string> standbyOrder = ranked;
+        std::rotate(standbyOrder.begin(), standbyOrder.begin() + 1, standbyOrder.end());
+
+        standbyClient_ = std::make_unique<WebSocketClient>();
+        if (!startClient(standbyClient_.get(), standbyOrder)) {
+            LOG("Failed to start hot standby connection, continuing without it");
+            standbyClient_.reset();
+        }
+    }
+
+    if (endpoints_.size() > 1) {
+        rerankThread_ = std::make_unique<std::thread>(&NetworkManager::rerankLoop, this);
+    }
+
     LOG("NetworkManager started successfully");
     return true;
 }
@@ -57,65 +185,771 @@ void NetworkManager::stop() {
     LOG("Stopping NetworkManager");
     running_.store(false);
     connected_.store(false);
+    Metrics::instance().connected.set(0);
 
-    // Stop WebSocket client
+    // Stop the re-ranking thread
+    {
+        std::lock_guard<std::mutex> lock(rerankMutex_); // Don't let the wakeup slip past a waiter
+    }
+    rerankCondition_.notify_all();
+    if (rerankThread_ && rerankThread_->joinable()) {
+        rerankThread_->join();
+    }
+    rerankThread_.reset();
+
+    {
+        std::lock_guard<std::mutex> lock(sweepMutex_);
+    }
+    sweepCondition_.notify_all();
+    if (sweepThread_ && sweepThread_->joinable()) {
+        sweepThread_->join();
+    }
+    sweepThread_.reset();
+
+    // Stop WebSocket clients
     if (wsClient_) {
         wsClient_->stop();
     }
+    if (standbyClient_) {
+        standbyClient_->stop();
+    }
+    activeClient_.store(wsClient_.get());
+
+    // No replies can arrive any more; don't leave anyone waiting for the timeout
+    pending_.failAll(RequestResult::Status::Cancelled);
+
+    // Whatever is still queued was never processed; a later resume replays it
+    stoppedResumeState_ = session_.resumeState();
 
     // Clear any pending messages
     messageQueue_.clear();
+    session_.clearQueued();
+    Metrics::instance().queueDepth.set(0);
 
     LOG("NetworkManager stopped");
 }
 
 bool NetworkManager::isConnected() const {
-    return connected_.load() && wsClient_ && wsClient_->isConnected();
+    WebSocketClient* active = activeClient_.load();
+    return connected_.load() && active && active->isConnected();
 }
 
-std::optional<json> NetworkManager::getNextMessage() {
-    if (!running_.load()) {
+std::optional<InboundMessage> NetworkManager::getNextMessage() {
+    // Called on every game hook; check the lock-free count before anything else.
+    // No running_ check: stop() clears the queue, and injected frames are
+    // consumed without the manager ever being started.
+    if (messageQueue_.approxSize() == 0) {
         return std::nullopt;
     }
 
-    return messageQueue_.tryPop();
+    std::optional<InboundMessage> inbound = messageQueue_.tryPop();
+    Metrics::instance().queueDepth.set(static_cast<int64_t>(messageQueue_.approxSize()));
+    if (inbound && inbound->sessionSeq != 0) {
+        session_.consumed(inbound->sessionSeq);
+    }
+    return inbound;
 }
 
 bool NetworkManager::sendMessage(const json& message) {
     if (!isConnected()) {
-        LOG("Cannot send message: NetworkManager not connected");
+        ASYNC_LOG(LogLevel::Warn, "Cannot send message: NetworkManager not connected");
+        return false;
+    }
+
+    return activeClient_.load()->sendMessage(message);
+}
+
+bool NetworkManager::sendReliable(const json& message) {
+    if (!spool_) {
+        return sendMessage(message);
+    }
+    return sendReliableText(message.dump());
+}
+
+bool NetworkManager::sendReliableText(std::string payload) {
+    if (!spool_) {
+        if (!isConnected()) {
+            ASYNC_LOG(LogLevel::Warn, "Cannot send message: NetworkManager not connected");
+            return false;
+        }
+        return activeClient_.load()->sendText(std::move(payload));
+    }
+
+    // Spooled even with the link up: a frame the connection drops before the
+    // server acknowledges it is only recoverable from there. Behind anything
+    // already spooled, so order is kept.
+    bool linkUp = isConnected() && authState_.load() == AuthState::Accepted;
+    if (spool_->append(payload)) {
+        if (linkUp) {
+            {
+                std::lock_guard<std::mutex> lock(sweepMutex_);
+                sweepKick_ = true;
+            }
+            sweepCondition_.notify_one();
+        }
+        else {
+            ASYNC_LOG(LogLevel::Info, "Spooled a {} byte message until the server can take it", payload.size());
+        }
+        return true;
+    }
+
+    size_t size = payload.size();
+    if (linkUp && activeClient_.load()->sendText(std::move(payload))) {
+        ASYNC_LOG(LogLevel::Warn, "Outbound spool can't take a {} byte message, sent it unspooled", size);
+        return true;
+    }
+    ASYNC_LOG(LogLevel::Warn, "Outbound spool can't take a {} byte message, dropping it", size);
+    return false;
+}
+
+void NetworkManager::setOutboundSpool(std::shared_ptr<OutboundSpool> spool) {
+    spool_ = std::move(spool);
+}
+
+size_t NetworkManager::getSpooledCount() const {
+    return spool_ ? spool_->pending() : 0;
+}
+
+void NetworkManager::flushSpool() {
+    if (!spool_ || !isConnected() || authState_.load() != AuthState::Accepted || spool_->pending() == 0) {
+        return;
+    }
+
+    // Connected and authenticated the whole time, yet nothing came back: a
+    // server without spool_ack. From here on a report counts as delivered
+    // once it is handed to the connection, like before acks existed.
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::rep dueAt = spoolAckDueAt_.load();
+    if (dueAt != 0 && now.time_since_epoch().count() >= dueAt) {
+        if (spoolAcks_.exchange(false)) {
+            LOG("Server doesn't acknowledge spooled reports, no longer waiting for it to");
+        }
+        spool_->acknowledge(spoolLastSent_.load());
+        spoolAckDueAt_.store(0);
+    }
+
+    WebSocketClient* active = activeClient_.load();
+    uint64_t lastSent = 0;
+    size_t sent = spool_->flush(SixMansConfig::OUTBOUND_SPOOL_FLUSH_BATCH,
+        [active, &lastSent](uint64_t record, std::string_view payload) {
+            if (!active->sendText(withSpoolSeq(record, payload))) {
+                return false;
+            }
+            lastSent = record;
+            return true;
+        });
+    if (sent == 0) {
+        return;
+    }
+    spoolLastSent_.store(lastSent);
+    if (!spoolAcks_.load()) {
+        spool_->acknowledge(lastSent);
+    }
+    else {
+        // Timed from the oldest report in flight; each ack restarts it
+        std::chrono::steady_clock::rep idle = 0;
+        spoolAckDueAt_.compare_exchange_strong(idle,
+            (now + std::chrono::milliseconds(SixMansConfig::OUTBOUND_SPOOL_ACK_TIMEOUT_MS)).time_since_epoch().count());
+    }
+    size_t left = spool_->unsent();
+    ASYNC_LOG(LogLevel::Info, "Flushed {} spooled message(s), {} left", sent, left);
+
+    // A full batch went out; come straight back for the next one
+    if (left > 0 && sent == SixMansConfig::OUTBOUND_SPOOL_FLUSH_BATCH) {
+        std::lock_guard<std::mutex> lock(sweepMutex_);
+        sweepKick_ = true;
+    }
+}
+
+void NetworkManager::rewindSpool() {
+    // Whatever went out on the last connection without an ack may not have
+    // arrived; the new one sends it again, oldest first
+    if (spool_) {
+        spool_->rewind();
+        spoolAckDueAt_.store(0);
+    }
+}
+
+void NetworkManager::onSpoolAck(uint64_t record) {
+    if (!spool_ || spool_->acknowledge(record) == 0) {
+        return;
+    }
+    // The server is keeping up; time what's still in flight from here
+    std::chrono::steady_clock::rep dueAt = 0;
+    if (spool_->pending() > spool_->unsent()) {
+        dueAt = (std::chrono::steady_clock::now()
+            + std::chrono::milliseconds(SixMansConfig::OUTBOUND_SPOOL_ACK_TIMEOUT_MS)).time_since_epoch().count();
+    }
+    spoolAckDueAt_.store(dueAt);
+}
+
+bool NetworkManager::sendRequest(json message, std::chrono::milliseconds timeout, ResponseCallback onResult) {
+    return sendRequestOn(activeClient_.load(), std::move(message), timeout, std::move(onResult));
+}
+
+std::future<RequestResult> NetworkManager::sendRequest(json message, std::chrono::milliseconds timeout) {
+    auto promise = std::make_shared<std::promise<RequestResult>>();
+    std::future<RequestResult> future = promise->get_future();
+    sendRequestOn(activeClient_.load(), std::move(message), timeout, [promise](RequestResult result) {
+        promise->set_value(std::move(result));
+        });
+    return future;
+}
+
+bool NetworkManager::sendRequestOn(WebSocketClient* client, json message, std::chrono::milliseconds timeout,
+    ResponseCallback onResult) {
+    if (!running_.load() || !client || !client->isConnected()) {
+        ASYNC_LOG(LogLevel::Warn, "Cannot send request: not connected");
+        onResult(RequestResult{ RequestResult::Status::SendFailed, json() });
+        return false;
+    }
+
+    uint64_t requestId = pending_.add(std::chrono::steady_clock::now() + timeout, std::move(onResult));
+    if (requestId == 0) {
+        ASYNC_LOG(LogLevel::Warn, "Cannot send request: {} already waiting for replies",
+            SixMansConfig::MAX_PENDING_REQUESTS);
+        onResult(RequestResult{ RequestResult::Status::SendFailed, json() });
         return false;
     }
 
-    return wsClient_->sendMessage(message);
+    message["requestId"] = requestId;
+    if (!client->sendMessage(message)) {
+        pending_.fail(requestId, RequestResult::Status::SendFailed);
+        return false;
+    }
+
+    // Wake the sweep thread so it switches to the short timeout interval
+    {
+        std::lock_guard<std::mutex> lock(sweepMutex_);
+        sweepKick_ = true;
+    }
+    sweepCondition_.notify_one();
+    return true;
+}
+
+bool NetworkManager::completeReply(const json& message) {
+    // Cheap enough for every frame: nothing in flight is the common case
+    if (pending_.size() == 0 || !message.is_object()) {
+        return false;
+    }
+    auto it = message.find("requestId");
+    if (it == message.end() || !it->is_number_unsigned()) {
+        return false;
+    }
+    // Late replies (already timed out) fall through to the normal path. The
+    // callbacks run here on the lws thread, so a malformed reply stops here.
+    try {
+        return pending_.complete(it->get<uint64_t>(), message);
+    }
+    catch (const json::exception& e) {
+        ASYNC_LOG(LogLevel::Warn, "Malformed reply to request {}: {}", it->get<uint64_t>(), e.what());
+        return true;
+    }
+}
+
+void NetworkManager::sweepLoop() {
+    helperTuning_.applyToCurrentThread("sweep");
+
+    std::unique_lock<std::mutex> lock(sweepMutex_);
+    while (running_.load()) {
+        // Check often while requests are waiting for a timeout, otherwise only
+        // as often as a pending ack might need flushing
+        int intervalMs = pending_.size() > 0
+            ? SixMansConfig::REQUEST_SWEEP_INTERVAL_MS : SixMansConfig::SESSION_ACK_INTERVAL_MS;
+        sweepCondition_.wait_for(lock, std::chrono::milliseconds(intervalMs),
+            [this] { return !running_.load() || sweepKick_; });
+        sweepKick_ = false;
+
+        // Callbacks run without the lock so they can issue new requests
+        lock.unlock();
+        auto now = std::chrono::steady_clock::now();
+        pending_.expire(now);
+        flushAck(false);
+        syncClock(now);
+        flushSpool();
+        lock.lock();
+    }
+}
+
+void NetworkManager::flushAck(bool force) {
+    if (!isConnected()) {
+        return;
+    }
+    std::optional<uint64_t> ack = session_.takeAck(std::chrono::steady_clock::now(),
+        std::chrono::milliseconds(SixMansConfig::SESSION_ACK_INTERVAL_MS), SixMansConfig::SESSION_ACK_EVERY, force);
+    if (ack) {
+        json ackMessage;
+        ackMessage["type"] = "ack";
+        ackMessage["sessionSeq"] = *ack;
+        sendMessage(ackMessage);
+    }
+}
+
+void NetworkManager::syncClock(std::chrono::steady_clock::time_point now) {
+    if (!isConnected() || clockSyncPending_.load()) {
+        return;
+    }
+    bool burst = clockSyncBurst_.load() > 0;
+    auto interval = std::chrono::milliseconds(burst
+        ? SixMansConfig::CLOCK_SYNC_BURST_SPACING_MS : SixMansConfig::CLOCK_SYNC_INTERVAL_MS);
+    if (now - lastClockSync_ < interval) {
+        return;
+    }
+    lastClockSync_ = now;
+    if (burst) {
+        clockSyncBurst_.fetch_sub(1);
+    }
+
+    // t3 is taken from the steady clock so a wall clock step mid-exchange
+    // can't produce a bogus round trip
+    double t0 = ClockSync::localNowMs();
+    auto sentAt = std::chrono::steady_clock::now();
+    json ping;
+    ping["type"] = "ping";
+    ping["timestamp"] = static_cast<long long>(t0);
+    clockSyncPending_.store(true);
+    sendRequest(std::move(ping), std::chrono::milliseconds(SixMansConfig::CLOCK_SYNC_TIMEOUT_MS),
+        [this, t0, sentAt](RequestResult result) {
+            // The pong echoes our requestId and adds when the server got the
+            // ping and when it answered, both in its epoch milliseconds
+            if (result.ok() && result.response.contains("receivedAt") && result.response["receivedAt"].is_number()
+                && result.response.contains("sentAt") && result.response["sentAt"].is_number()) {
+                double t3 = t0 + std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sentAt).count();
+                clock_.addSample(t0, result.response["receivedAt"].get<double>(),
+                    result.response["sentAt"].get<double>(), t3);
+                Metrics::instance().rtt.observe(std::chrono::steady_clock::now() - sentAt);
+                ASYNC_LOG(LogLevel::Debug, "Clock offset {:.1f} ms, rtt {:.1f} ms",
+                    clock_.offsetMs(), clock_.rttMs());
+            }
+            clockSyncPending_.store(false);
+        });
+}
+
+bool NetworkManager::isClockSynced() const {
+    return clock_.isSynced();
+}
+
+double NetworkManager::getClockOffsetMs() const {
+    return clock_.offsetMs();
+}
+
+double NetworkManager::getClockRttMs() const {
+    return clock_.rttMs();
+}
+
+size_t NetworkManager::getExpiredCount() const {
+    return expiredCount_.load(std::memory_order_relaxed);
+}
+
+bool NetworkManager::stampDeadline(InboundMessage& inbound) const {
+    auto it = inbound.message.find("deadline");
+    if (it == inbound.message.end() || !clock_.isSynced()) {
+        return true; // Can't judge it without knowing the server's time
+    }
+    if (!it->is_number()) {
+        return true; // validateMessage rejects these; don't rely on running after it
+    }
+
+    double remainingMs = it->get<double>() - clock_.serverNowMs();
+    if (remainingMs <= 0.0) {
+        return false;
+    }
+    inbound.deadline = inbound.receivedAt + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double, std::milli>(remainingMs));
+    return true;
+}
+
+SessionResumeState NetworkManager::getResumeState() const {
+    return running_.load() ? session_.resumeState() : stoppedResumeState_;
+}
+
+void NetworkManager::setResumeState(const SessionResumeState& state) {
+    if (running_.load()) {
+        LOG("Resume state must be set before start");
+        return;
+    }
+    session_.reset(state.sessionId, state.lastSeq);
+}
+
+size_t NetworkManager::getDuplicateCount() const {
+    return duplicateCount_.load(std::memory_order_relaxed);
+}
+
+WebSocketClient::HandshakeHeaders NetworkManager::handshakeHeaders(WebSocketClient* client) {
+    bool active = client == activeClient_.load();
+    if (active) {
+        upgradeSentAt_.store(std::chrono::steady_clock::now().time_since_epoch().count());
+        firstMessagePending_.store(true);
+    }
+
+    WebSocketClient::HandshakeHeaders headers;
+    if (!handshakeAuth_.load()) {
+        return headers;
+    }
+
+    // The server's auth_response echoes this id, so it completes like any
+    // other request. A previous attempt that never connected is dropped.
+    cancelHandshakeAuth(client);
+    auto assignedId = std::make_shared<std::atomic<uint64_t>>(0);
+    uint64_t id = pending_.add(
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(SixMansConfig::HANDSHAKE_AUTH_TIMEOUT_MS),
+        [this, client, assignedId](RequestResult result) { onHandshakeAuthResult(client, assignedId->load(), result); });
+    if (id == 0) {
+        return headers; // Table full; authenticate() sends a frame once connected
+    }
+    assignedId->store(id);
+    handshakeAuthId(client).store(id);
+
+    {
+        std::lock_guard<std::mutex> lock(tokenMutex_);
+        headers.emplace_back("Authorization", "Bearer " + currentToken_);
+    }
+    headers.emplace_back("X-SixMans-Request-Id", std::to_string(id));
+    if (active) {
+        SessionResumeState resume = session_.resumeState();
+        if (!resume.sessionId.empty()) {
+            headers.emplace_back("X-SixMans-Resume", resume.sessionId + ":" + std::to_string(resume.lastSeq));
+        }
+    }
+    return headers;
+}
+
+void NetworkManager::onHandshakeAuthResult(WebSocketClient* client, uint64_t id, const RequestResult& result) {
+    // Only clear our own id; a newer connect attempt may have replaced it
+    handshakeAuthId(client).compare_exchange_strong(id, 0);
+    if (result.ok()) {
+        onAuthResult(client, result);
+    }
+    else if (result.status == RequestResult::Status::Timeout && client->isConnected()) {
+        // Connected but no answer: the server doesn't read the headers
+        LOG("Server ignored handshake authentication, sending an auth message instead");
+        handshakeAuth_.store(false);
+        authenticate(client);
+    }
+    // Otherwise the connect failed or was superseded; nothing to report
+}
+
+std::atomic<uint64_t>& NetworkManager::handshakeAuthId(WebSocketClient* client) {
+    return client == wsClient_.get() ? primaryHandshakeAuthId_ : standbyHandshakeAuthId_;
+}
+
+std::atomic<NetworkManager::AuthState>& NetworkManager::authStateOf(WebSocketClient* client) {
+    return client == activeClient_.load() ? authState_ : standbyAuthState_;
+}
+
+void NetworkManager::cancelHandshakeAuth(WebSocketClient* client) {
+    if (uint64_t id = handshakeAuthId(client).exchange(0)) {
+        pending_.fail(id, RequestResult::Status::Cancelled);
+    }
+}
+
+void NetworkManager::noteFirstMessage() {
+    if (firstMessagePending_.exchange(false)) {
+        auto sentAt = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(upgradeSentAt_.load()));
+        lastTimeToFirstMessageMicros_.store(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - sentAt).count());
+        stateVersion_.fetch_add(1, std::memory_order_release);
+    }
+}
+
+long long NetworkManager::getLastTimeToFirstMessageMicros() const {
+    return lastTimeToFirstMessageMicros_.load();
+}
+
+std::chrono::steady_clock::time_point NetworkManager::getFirstAuthenticatedAt() const {
+    std::chrono::steady_clock::rep at = firstAuthenticatedAt_.load();
+    return at != 0 ? std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(at))
+        : std::chrono::steady_clock::time_point();
+}
+
+void NetworkManager::authenticate(WebSocketClient* client) {
+    // Already on its way in the upgrade request
+    if (handshakeAuthId(client).load() != 0) {
+        authStateOf(client).store(AuthState::Pending);
+        stateVersion_.fetch_add(1, std::memory_order_release);
+        return;
+    }
+
+    json authMessage;
+    authMessage["type"] = "auth";
+    {
+        std::lock_guard<std::mutex> lock(tokenMutex_);
+        authMessage["token"] = currentToken_;
+    }
+
+    // Only the active link carries the session; the standby gets its own
+    if (client == activeClient_.load()) {
+        SessionResumeState resume = session_.resumeState();
+        if (!resume.sessionId.empty()) {
+            authMessage["resume"] = { { "sessionId", resume.sessionId }, { "lastSeq", resume.lastSeq } };
+        }
+    }
+
+    authStateOf(client).store(AuthState::Pending);
+    stateVersion_.fetch_add(1, std::memory_order_release);
+    sendRequestOn(client, std::move(authMessage), std::chrono::milliseconds(SixMansConfig::AUTH_TIMEOUT_MS),
+        [this, client](RequestResult result) { onAuthResult(client, result); });
+}
+
+void NetworkManager::onAuthResult(WebSocketClient* client, const RequestResult& result) {
+    bool active = client == activeClient_.load();
+    std::atomic<AuthState>& authState = active ? authState_ : standbyAuthState_;
+    switch (result.status) {
+    case RequestResult::Status::Ok:
+        if (boolField(result.response, "success")) {
+            if (active) {
+                rewindSpool(); // Before Accepted lets the sweep thread flush on this link
+            }
+            authState.store(AuthState::Accepted);
+            std::chrono::steady_clock::rep notYet = 0;
+            firstAuthenticatedAt_.compare_exchange_strong(notYet,
+                std::chrono::steady_clock::now().time_since_epoch().count());
+            if (active && getSpooledCount() > 0) {
+                // Reports spooled while the link was down, or sent on the last
+                // one without an ack, go out from the sweep thread
+                {
+                    std::lock_guard<std::mutex> lock(sweepMutex_);
+                    sweepKick_ = true;
+                }
+                sweepCondition_.notify_one();
+            }
+            std::string sessionId = stringField(result.response, "sessionId", "");
+            if (!active) {
+                std::lock_guard<std::mutex> lock(tokenMutex_);
+                standbySessionId_ = sessionId;
+            }
+            else if (boolField(result.response, "resumed")) {
+                // The server replays what we missed right after this reply, so
+                // the queue view carries on from where it was
+                LOG("Authentication successful, session resumed");
+                liveQueue_.resume();
+                noteFirstMessage();
+                break;
+            }
+            else {
+                session_.reset(sessionId);
+                // Servers may send the queue along with the reply, which saves
+                // asking for it
+                auto queue = result.response.find("queue");
+                if (queue != result.response.end() && queue->is_object()
+                    && queue->contains("seq") && (*queue)["seq"].is_number_unsigned()
+                    && queue->contains("state") && (*queue)["state"].is_object()) {
+                    liveQueue_.applySnapshot((*queue)["seq"].get<uint64_t>(), (*queue)["state"]);
+                    noteFirstMessage();
+                }
+                else {
+                    requestQueueResync();
+                }
+            }
+            LOG("Authentication successful");
+        }
+        else {
+            authState.store(AuthState::Rejected);
+            LOG("Authentication failed: {}", stringField(result.response, "error", "Unknown error"));
+        }
+        break;
+    case RequestResult::Status::Timeout:
+        authState.store(AuthState::TimedOut);
+        LOG("No authentication response within {} ms", SixMansConfig::AUTH_TIMEOUT_MS);
+        if (active) {
+            requestQueueResync(); // Older servers may not answer auth at all
+        }
+        break;
+    default:
+        // Connection went away first; the next connect asks again
+        authState.store(AuthState::None);
+        break;
+    }
+    stateVersion_.fetch_add(1, std::memory_order_release);
+}
+
+void NetworkManager::applyQueueMessage(const json& message) {
+    uint64_t seq = message["seq"].get<uint64_t>();
+    LiveQueue::Result result = message["type"] == "queue_snapshot"
+        ? liveQueue_.applySnapshot(seq, message["state"])
+        : liveQueue_.applyDelta(seq, message["patch"]);
+
+    if (result == LiveQueue::Result::NeedsResync) {
+        ASYNC_LOG(LogLevel::Info, "Live queue out of sync at seq {}, requesting a snapshot", seq);
+        requestQueueResync();
+    }
+    else if (result == LiveQueue::Result::Applied && message["type"] == "queue_snapshot") {
+        noteFirstMessage();
+    }
+}
+
+void NetworkManager::requestQueueResync() {
+    // One in flight at a time; deltas arriving meanwhile are dropped by LiveQueue.
+    // Without a connection there is nobody to ask; the next connect resyncs.
+    if (!isConnected() || queueResyncPending_.exchange(true)) {
+        return;
+    }
+
+    json resync;
+    resync["type"] = "queue_resync";
+    resync["lastSeq"] = liveQueue_.load()->seq;
+    sendRequest(std::move(resync), std::chrono::milliseconds(SixMansConfig::QUEUE_RESYNC_TIMEOUT_MS),
+        [this](RequestResult result) {
+            // The reply is a queue_snapshot carrying our requestId
+            if (result.ok() && validateMessage(result.response)
+                && result.response.value("type", "") == "queue_snapshot") {
+                applyQueueMessage(result.response);
+            }
+            queueResyncPending_.store(false);
+        });
+    queueResyncCount_.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::shared_ptr<const LiveQueueState> NetworkManager::getQueueState() const {
+    return liveQueue_.load();
+}
+
+size_t NetworkManager::getQueueResyncCount() const {
+    return queueResyncCount_.load(std::memory_order_relaxed);
+}
+
+NetworkManager::AuthState NetworkManager::getAuthState() const {
+    return authState_.load();
+}
+
+bool NetworkManager::reauthenticate(const std::string& token) {
+    if (!isConnected()) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(tokenMutex_);
+        currentToken_ = token;
+    }
+    WebSocketClient* active = activeClient_.load();
+    cancelHandshakeAuth(active);
+    authenticate(active);
+    if (WebSocketClient* standby = getStandbyClient(); standby && standby->isConnected()) {
+        cancelHandshakeAuth(standby);
+        authenticate(standby);
+    }
+    return true;
 }
 
 size_t NetworkManager::getQueueSize() const {
-    return messageQueue_.size();
+    return messageQueue_.approxSize();
 }
 
 void NetworkManager::clearQueue() {
     messageQueue_.clear();
+    session_.clearQueued();
+    Metrics::instance().queueDepth.set(0);
+}
+
+void NetworkManager::onClientMessage(WebSocketClient* source, const json& message) {
+    if (source == activeClient_.load()) {
+        onMessageReceived(message);
+        return;
+    }
+
+    // The standby link stays idle: keep it alive and answer its own requests,
+    // but never let it feed the game
+    if (completeReply(message)) {
+        return;
+    }
+    if (!message.is_object()) {
+        return;
+    }
+    auto type = message.find("type");
+    if (type != message.end() && type->is_string() && *type == "ping") {
+        json pongResponse;
+        pongResponse["type"] = "pong";
+        if (message.contains("timestamp")) {
+            pongResponse["timestamp"] = message["timestamp"];
+        }
+        source->sendMessage(pongResponse);
+    }
 }
 
 void NetworkManager::onMessageReceived(const json& message) {
     if (!running_.load()) {
         return;
     }
+    ingestMessage(message, std::chrono::steady_clock::now());
+}
+
+void NetworkManager::injectMessage(const json& message, std::chrono::steady_clock::time_point receivedAt) {
+    ingestMessage(message, receivedAt);
+}
+
+void NetworkManager::ingestMessage(const json& message, std::chrono::steady_clock::time_point receivedAt) {
+    receivedCount_.fetch_add(1, std::memory_order_relaxed);
+
+    // Replies to sendRequest go straight to their caller
+    if (completeReply(message)) {
+        return;
+    }
+
+    // Drop anything a session replay delivers a second time
+    uint64_t sessionSeq = 0;
+    if (message.is_object()) {
+        auto it = message.find("sessionSeq");
+        if (it != message.end() && it->is_number_unsigned()) {
+            sessionSeq = it->get<uint64_t>();
+            if (!session_.accept(sessionSeq)) {
+                duplicateCount_.fetch_add(1, std::memory_order_relaxed);
+                Metrics::instance().droppedDuplicate.add();
+                ASYNC_LOG(LogLevel::Debug, "Dropping duplicate message {}", sessionSeq);
+                return;
+            }
+        }
+    }
 
     // Validate the message
     if (!validateMessage(message)) {
-        LOG("Received invalid message format");
+        invalidCount_.fetch_add(1, std::memory_order_relaxed);
+        Metrics::instance().droppedInvalid.add();
+        ASYNC_LOG(LogLevel::Warn, "Received invalid message format");
         return;
     }
 
     // Process the message
-    processMessage(message);
+    processMessage(message, receivedAt, sessionSeq);
+
+    if (sessionSeq != 0) {
+        flushAck(false);
+    }
 }
 
-void NetworkManager::onConnectionChanged(bool connected) {
+void NetworkManager::onConnectionChanged(WebSocketClient* source, bool connected) {
+    stateVersion_.fetch_add(1, std::memory_order_release);
+    if (!connected) {
+        cancelHandshakeAuth(source);
+    }
+    WebSocketClient* active = activeClient_.load();
+    if (source != active) {
+        if (!connected) {
+            standbyAuthState_.store(AuthState::None);
+            LOG("Hot standby disconnected, reconnecting in the background");
+            return;
+        }
+
+        // If the primary is already down there is no reason to wait for it
+        if (!active->isConnected() && running_.load() && promoteStandby(active, source)) {
+            return;
+        }
+        LOG("Hot standby connected to {}", source->getCurrentEndpoint());
+        authenticate(source);
+        sendSubscription(source);
+        announceRole(source, "standby");
+        return;
+    }
+
+    if (!connected && running_.load() && promoteStandby(source, getStandbyClient())) {
+        // The old primary keeps reconnecting on its own and becomes the new standby
+        return;
+    }
+
+    // Reports only go out on an authenticated link. Set before connected_, so
+    // nothing sees the new connection as usable before its auth is on the way.
+    authState_.store(connected ? AuthState::Pending : AuthState::None);
     bool wasConnected = connected_.load();
     connected_.store(connected);
+    Metrics::instance().connected.set(connected ? 1 : 0);
 
     if (connected && !wasConnected) {
         LOG("NetworkManager connected to server");
@@ -123,41 +957,101 @@ void NetworkManager::onConnectionChanged(bool connected) {
     else if (!connected && wasConnected) {
         LOG("NetworkManager disconnected from server");
     }
+
+    if (connected) {
+        // The queue view is resynced once auth says whether the session resumed
+        authenticate(source);
+        sendSubscription(source);
+        clock_.restart();
+        clockSyncBurst_.store(SixMansConfig::CLOCK_SYNC_BURST);
+    }
+    else {
+        liveQueue_.markStale();
+    }
 }
 
 bool NetworkManager::validateMessage(const json& message) {
     // Basic validation - ensure message has required fields
     if (!message.is_object()) {
-        LOG("Message is not a JSON object");
+        ASYNC_LOG(LogLevel::Warn, "Message is not a JSON object");
         return false;
     }
 
     // Check for required fields
     if (!message.contains("type")) {
-        LOG("Message missing 'type' field");
+        ASYNC_LOG(LogLevel::Warn, "Message missing 'type' field");
         return false;
     }
 
     std::string messageType = message["type"];
 
+    if (message.contains("deadline") && !message["deadline"].is_number()) {
+        ASYNC_LOG(LogLevel::Warn, "{} message has a non-numeric 'deadline'", messageType);
+        return false;
+    }
+
     // Validate based on message type
-    if (messageType == "lobby_action") {
+    if (messageType == "spool_ack") {
+        if (!message.contains("spoolSeq") || !message["spoolSeq"].is_number_unsigned()) {
+            ASYNC_LOG(LogLevel::Warn, "spool_ack missing 'spoolSeq'");
+            return false;
+        }
+    }
+    else if (messageType == "lobby_action") {
         if (!message.contains("action")) {
-            LOG("lobby_action message missing 'action' field");
+            ASYNC_LOG(LogLevel::Warn, "lobby_action message missing 'action' field");
             return false;
         }
 
         std::string action = message["action"];
         if (action == "join") {
             if (!message.contains("lobbyName") || !message.contains("password")) {
-                LOG("join action missing required fields (lobbyName, password)");
+                ASYNC_LOG(LogLevel::Warn, "join action missing required fields (lobbyName, password)");
+                return false;
+            }
+        }
+        else if (action == "go") {
+            if (!message.contains("prepareId") || !message["prepareId"].is_string()) {
+                ASYNC_LOG(LogLevel::Warn, "go action missing 'prepareId' field");
                 return false;
             }
         }
     }
+    else if (messageType == "lobby_prepare") {
+        if (!message.contains("prepareId") || !message.contains("action")
+            || !message.contains("lobbyName") || !message.contains("password")) {
+            ASYNC_LOG(LogLevel::Warn, "lobby_prepare missing required fields (prepareId, action, lobbyName, password)");
+            return false;
+        }
+        if (!message["prepareId"].is_string() || !message["action"].is_string()
+            || !message["lobbyName"].is_string() || !message["password"].is_string()) {
+            ASYNC_LOG(LogLevel::Warn, "lobby_prepare fields must be strings");
+            return false;
+        }
+        // Anything else would be run as a join when "go" arrives
+        const std::string& action = message["action"].get_ref<const std::string&>();
+        if (action != "create" && action != "join") {
+            ASYNC_LOG(LogLevel::Warn, "lobby_prepare has unknown action '{}'", action);
+            return false;
+        }
+    }
     else if (messageType == "auth_response") {
         if (!message.contains("success")) {
-            LOG("auth_response message missing 'success' field");
+            ASYNC_LOG(LogLevel::Warn, "auth_response message missing 'success' field");
+            return false;
+        }
+    }
+    else if (messageType == "queue_snapshot") {
+        if (!message.contains("seq") || !message["seq"].is_number_unsigned()
+            || !message.contains("state") || !message["state"].is_object()) {
+            ASYNC_LOG(LogLevel::Warn, "queue_snapshot missing 'seq' or 'state'");
+            return false;
+        }
+    }
+    else if (messageType == "queue_delta") {
+        if (!message.contains("seq") || !message["seq"].is_number_unsigned()
+            || !message.contains("patch") || !message["patch"].is_array()) {
+            ASYNC_LOG(LogLevel::Warn, "queue_delta missing 'seq' or 'patch'");
             return false;
         }
     }
@@ -166,14 +1060,15 @@ bool NetworkManager::validateMessage(const json& message) {
         return true;
     }
     else {
-        LOG("Unknown message type: {}", messageType);
+        ASYNC_LOG(LogLevel::Warn, "Unknown message type: {}", messageType);
         // Don't reject unknown message types, just log them
     }
 
     return true;
 }
 
-void NetworkManager::processMessage(const json& message) {
+void NetworkManager::processMessage(const json& message, std::chrono::steady_clock::time_point receivedAt,
+    uint64_t sessionSeq) {
     // Handle special message types that don't need to go to the game thread
     std::string messageType = message["type"];
 
@@ -188,6 +1083,18 @@ void NetworkManager::processMessage(const json& message) {
         return;
     }
 
+    // The server has our spooled reports up to this one
+    if (messageType == "spool_ack") {
+        onSpoolAck(message["spoolSeq"].get<uint64_t>());
+        return;
+    }
+
+    // Queue state lives here, not on the game thread
+    if (messageType == "queue_snapshot" || messageType == "queue_delta") {
+        applyQueueMessage(message);
+        return;
+    }
+
     if (messageType == "auth_response") {
         bool success = message["success"];
         if (success) {
@@ -196,14 +1103,299 @@ void NetworkManager::processMessage(const json& message) {
         else {
             LOG("Authentication failed: {}", message.value("error", "Unknown error"));
         }
-        // Auth responses can still be queued for the game thread to handle
+        // Only unsolicited ones get here (replies to our auth request are
+        // completed in completeReply); still queued for the game thread
     }
 
-    // Queue the message for the game thread
-    if (!messageQueue_.push(message)) {
-        LOG("Message queue full, dropping message");
+    // Don't spend a queue slot and a dispatch on something the game thread would ignore
+    if (!isWantedBySettings(messageType, message)) {
+        filteredCount_.fetch_add(1, std::memory_order_relaxed);
+        Metrics::instance().droppedFiltered.add();
+        ASYNC_LOG(LogLevel::Debug, "Dropping {} message, disabled in settings", messageType);
+        return;
+    }
+
+    // Acting on it late is worse than not acting, e.g. joining a lobby that
+    // filled while we were disconnected
+    InboundMessage inbound{ message, receivedAt, sessionSeq };
+    if (!stampDeadline(inbound)) {
+        expiredCount_.fetch_add(1, std::memory_order_relaxed);
+        Metrics::instance().droppedExpired.add();
+        ASYNC_LOG(LogLevel::Info, "Dropping {} message, its deadline passed before it arrived", messageType);
+        return;
+    }
+
+    enqueueForGame(std::move(inbound), messageType);
+}
+
+void NetworkManager::enqueueForGame(InboundMessage inbound, const std::string& messageType) {
+    // Registered before the push so the game thread can't consume it first;
+    // a message that doesn't fit is dropped for good and counts as handled
+    uint64_t sessionSeq = inbound.sessionSeq;
+    if (sessionSeq != 0) {
+        session_.queued(sessionSeq);
+    }
+
+    if (!messageQueue_.push(std::move(inbound))) {
+        if (sessionSeq != 0) {
+            session_.unqueued(sessionSeq);
+        }
+        droppedCount_.fetch_add(1, std::memory_order_relaxed);
+        Metrics::instance().droppedQueueFull.add();
+        ASYNC_LOG(LogLevel::Warn, "Message queue full, dropping message");
     }
     else {
-        DEBUGLOG("Queued message for game thread: {}", message.dump());
+        Metrics::instance().queueDepth.set(static_cast<int64_t>(messageQueue_.approxSize()));
+        ASYNC_LOG(LogLevel::Debug, "Queued {} message for game thread", messageType);
+        noteFirstMessage();
+    }
+}
+
+std::string NetworkManager::getCurrentEndpoint() const {
+    WebSocketClient* active = activeClient_.load();
+    return active ? active->getCurrentEndpoint() : currentUrl_;
+}
+
+int NetworkManager::getLastRttMs() const {
+    return lastRttMs_.load();
+}
+
+void NetworkManager::rerankLoop() {
+    helperTuning_.applyToCurrentThread("rerank");
+
+    while (running_.load()) {
+        {
+            std::unique_lock<std::mutex> lock(rerankMutex_);
+            rerankCondition_.wait_for(lock, std::chrono::milliseconds(SixMansConfig::ENDPOINT_RERANK_INTERVAL_MS),
+                [this] { return !running_.load(); });
+        }
+        if (!running_.load()) {
+            break;
+        }
+
+        auto results = EndpointProber::probeAll(endpoints_, SixMansConfig::ENDPOINT_PROBE_TIMEOUT_MS);
+        if (!running_.load()) {
+            break;
+        }
+
+        // The new order is used from the next (re)connect on; a healthy
+        // connection is not torn down just because another endpoint got faster.
+        std::vector<std::string> ranked = EndpointProber::rank(results);
+        activeClient_.load()->setEndpoints(ranked);
+        if (WebSocketClient* standby = getStandbyClient()) {
+            std::rotate(ranked.begin(), ranked.begin() + 1, ranked.end());
+            standby->setEndpoints(ranked);
+        }
+        applyProbeResults(results);
+    }
+}
+
+void NetworkManager::applyProbeResults(const std::vector<EndpointProbeResult>& results) {
+    // Before the client starts, the endpoint we are about to use is the top-ranked one
+    std::string current = running_.load() ? getCurrentEndpoint() : EndpointProber::rank(results).front();
+    for (const auto& result : results) {
+        if (result.url == current) {
+            lastRttMs_.store(result.rttMs);
+            break;
+        }
+    }
+}
+
+void NetworkManager::setHotStandbyEnabled(bool enabled) {
+    if (running_.load()) {
+        LOG("Hot standby setting takes effect on the next start");
+    }
+    hotStandbyEnabled_ = enabled;
+}
+
+void NetworkManager::setThreadTuning(const ThreadTuning& network, const ThreadTuning& helper) {
+    if (running_.load()) {
+        LOG("Thread tuning must be set before start");
+        return;
+    }
+    networkTuning_ = network;
+    helperTuning_ = helper;
+}
+
+bool NetworkManager::isStandbyConnected() const {
+    WebSocketClient* standby = getStandbyClient();
+    return standby && standby->isConnected();
+}
+
+long long NetworkManager::getLastPromotionMicros() const {
+    return lastPromotionMicros_.load();
+}
+
+int NetworkManager::getPromotionCount() const {
+    return promotionCount_.load();
+}
+
+WebSocketClient* NetworkManager::getStandbyClient() const {
+    if (!standbyClient_) {
+        return nullptr;
+    }
+    WebSocketClient* active = activeClient_.load();
+    return active == wsClient_.get() ? standbyClient_.get() : wsClient_.get();
+}
+
+bool NetworkManager::promoteStandby(WebSocketClient* failed, WebSocketClient* standby) {
+    auto detectedAt = std::chrono::steady_clock::now();
+    if (!standby || !standby->isConnected()) {
+        return false;
+    }
+
+    // Only one side can win if both links change state at the same time
+    if (!activeClient_.compare_exchange_strong(failed, standby)) {
+        return false;
+    }
+
+    // Tell the server to route lobby traffic here from now on
+    announceRole(standby, "primary");
+
+    long long micros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - detectedAt).count();
+    lastPromotionMicros_.store(micros);
+    promotionCount_.fetch_add(1);
+    rewindSpool();
+    authState_.store(standbyAuthState_.exchange(AuthState::None));
+    connected_.store(true);
+    Metrics::instance().connected.set(1);
+    stateVersion_.fetch_add(1, std::memory_order_release);
+
+    // The standby has its own session and saw no queue deltas while idle
+    {
+        std::lock_guard<std::mutex> lock(tokenMutex_);
+        session_.reset(standbySessionId_);
     }
+    requestQueueResync();
+    clock_.restart();
+    clockSyncBurst_.store(SixMansConfig::CLOCK_SYNC_BURST);
+
+    LOG("Hot standby promoted to primary in {}us ({})", micros, standby->getCurrentEndpoint());
+    return true;
+}
+
+void NetworkManager::announceRole(WebSocketClient* client, const char* role) {
+    json roleMessage;
+    roleMessage["type"] = "session_role";
+    roleMessage["role"] = role;
+    client->sendMessage(roleMessage);
+}
+
+void NetworkManager::setSettingsSource(std::shared_ptr<SettingsSnapshot> settings) {
+    settings_ = std::move(settings);
+}
+
+size_t NetworkManager::getFilteredCount() const {
+    return filteredCount_.load(std::memory_order_relaxed);
+}
+
+bool NetworkManager::isWantedBySettings(const std::string& messageType, const json& message) const {
+    if (!settings_ || (messageType != "lobby_action" && messageType != "lobby_prepare")) {
+        return true;
+    }
+
+    std::shared_ptr<const PluginSettings> settings = settings_->load();
+    if (!settings->pluginEnabled) {
+        return false;
+    }
+
+    const std::string action = message["action"];
+    if (action == "join") {
+        return settings->autoJoin;
+    }
+    if (action == "create") {
+        return settings->autoCreate;
+    }
+    if (action == "go") {
+        // Which kind of lobby it fires was decided by the prepare; only drop it
+        // when neither could run
+        return settings->autoJoin || settings->autoCreate;
+    }
+    return true;
+}
+
+namespace {
+    constexpr unsigned SUBSCRIBE_JOIN = 1;
+    constexpr unsigned SUBSCRIBE_CREATE = 2;
+    constexpr unsigned SUBSCRIBE_QUEUE = 4;
+
+    // Mirrors isWantedBySettings; no settings means everything
+    unsigned subscriptionMask(const PluginSettings* settings) {
+        if (!settings) {
+            return SUBSCRIBE_JOIN | SUBSCRIBE_CREATE | SUBSCRIBE_QUEUE;
+        }
+        if (!settings->pluginEnabled) {
+            return 0;
+        }
+        return SUBSCRIBE_QUEUE | (settings->autoJoin ? SUBSCRIBE_JOIN : 0)
+            | (settings->autoCreate ? SUBSCRIBE_CREATE : 0);
+    }
+}
+
+json NetworkManager::buildSubscription(const PluginSettings* settings) {
+    unsigned mask = subscriptionMask(settings);
+
+    json types = json::array({ "ping", "auth_response" });
+    json actions = json::array();
+    if (mask & SUBSCRIBE_QUEUE) {
+        types.push_back("queue_snapshot");
+        types.push_back("queue_delta");
+    }
+    if (mask & (SUBSCRIBE_JOIN | SUBSCRIBE_CREATE)) {
+        types.push_back("lobby_action");
+        types.push_back("lobby_prepare");
+        if (mask & SUBSCRIBE_JOIN) {
+            actions.push_back("join");
+        }
+        if (mask & SUBSCRIBE_CREATE) {
+            actions.push_back("create");
+        }
+        actions.push_back("go");
+    }
+
+    json subscription;
+    subscription["type"] = "subscribe";
+    subscription["types"] = std::move(types);
+    subscription["actions"] = std::move(actions);
+    return subscription;
+}
+
+void NetworkManager::sendSubscription(WebSocketClient* client) {
+    std::shared_ptr<const PluginSettings> settings = settings_ ? settings_->load() : nullptr;
+    subscriptionMask_.store(subscriptionMask(settings.get()));
+    client->sendMessage(buildSubscription(settings.get()));
+}
+
+void NetworkManager::updateSubscription() {
+    // Most cvar changes (token, endpoints, ...) don't touch the subscription
+    std::shared_ptr<const PluginSettings> settings = settings_ ? settings_->load() : nullptr;
+    unsigned mask = subscriptionMask(settings.get());
+    if (!running_.load() || subscriptionMask_.exchange(mask) == mask) {
+        return;
+    }
+
+    ASYNC_LOG(LogLevel::Info, "Settings changed, updating server subscription");
+    if (WebSocketClient* active = activeClient_.load(); active && active->isConnected()) {
+        active->sendMessage(buildSubscription(settings.get()));
+    }
+    if (WebSocketClient* standby = getStandbyClient(); standby && standby->isConnected()) {
+        standby->sendMessage(buildSubscription(settings.get()));
+    }
+}
+
+size_t NetworkManager::getReceivedCount() const {
+    return receivedCount_.load(std::memory_order_relaxed);
+}
+
+size_t NetworkManager::getInvalidCount() const {
+    return invalidCount_.load(std::memory_order_relaxed);
+}
+
+size_t NetworkManager::getDroppedCount() const {
+    return droppedCount_.load(std::memory_order_relaxed);
+}
+
+unsigned NetworkManager::getStateVersion() const {
+    return stateVersion_.load(std::memory_order_acquire);
 }
\ No newline at end of file
@@ -2,6 +2,15 @@
 #include "pch.h"
 #include "WebSocketClient.h"
 #include "ThreadSafeQueue.h"
+#include "EndpointProber.h"
+#include "PluginSettings.h"
+#include "PendingRequests.h"
+#include "LiveQueue.h"
+#include "SessionTracker.h"
+#include "ClockSync.h"
+#include "ThreadTuning.h"
+#include "OutboundSpool.h"
+#include "Config.h"
 #include <string>
 #include <memory>
 #include <atomic>
@@ -11,9 +20,26 @@
 #include <thread>
 #include <queue>
 #include <optional>
+#include <vector>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+#include <future>
 
 using json = nlohmann::json;
 
+// A validated message waiting for the game thread, stamped with when it came
+// off the wire so handlers can measure end-to-end latency
+struct InboundMessage {
+    json message;
+    std::chrono::steady_clock::time_point receivedAt;
+    uint64_t sessionSeq = 0; // 0 if not part of the resumable session stream
+
+    // When acting on it stops making sense, from the server's "deadline"
+    // translated to our clock; max() if it has none or the clock isn't synced yet
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+};
+
 class NetworkManager {
 public:
     NetworkManager();
@@ -26,6 +52,12 @@ public:
     // Start the network manager with given URL and token
     bool start(const std::string& url, const std::string& token);
 
+    // Start with a list of candidate endpoints. They are probed in parallel, the
+    // client connects to the fastest healthy one and the list is re-ranked every
+    // ENDPOINT_RERANK_INTERVAL_MS for failover. Probing blocks for up to
+    // ENDPOINT_PROBE_TIMEOUT_MS, so never call this on the game thread.
+    bool start(const std::vector<std::string>& urls, const std::string& token);
+
     // Stop the network manager
     void stop();
 
@@ -34,32 +66,261 @@ public:
 
     // Get the next message from the queue (non-blocking)
     // Returns std::nullopt if no messages available
-    std::optional<json> getNextMessage();
+    std::optional<InboundMessage> getNextMessage();
 
     // Send a message to the server
     bool sendMessage(const json& message);
 
+    // Send a report the server has to get even if the link is down right now
+    // (lobby created, join result). It is appended to the outbound spool,
+    // which the sweep thread flushes in order, a batch at a time, whenever the
+    // link is authenticated. Each goes out with a "spoolSeq" and stays spooled
+    // until a spool_ack covering it comes back; a link that drops first means
+    // it is sent again after the next auth. One too long for the spool is sent
+    // without that guarantee. False only if it could be neither sent nor spooled.
+    bool sendReliable(const json& message);
+
+    // Same, for a message serialised elsewhere (e.g. off the game thread)
+    bool sendReliableText(std::string payload);
+
+    // The spool behind sendReliable, shared so it outlives a restart of the
+    // manager. Set before start(); without one, sendReliable is sendMessage.
+    void setOutboundSpool(std::shared_ptr<OutboundSpool> spool);
+
+    // Messages in the outbound spool the server hasn't acknowledged yet
+    size_t getSpooledCount() const;
+
+    // Send a request stamped with a fresh "requestId" and complete it with the
+    // reply that echoes that id. onResult runs exactly once: on the network
+    // thread with the reply, on the sweep thread on timeout, or inline if the
+    // send fails (then this returns false). Replies never enter the game-thread
+    // queue; a caller that needs the game thread hops there itself.
+    using ResponseCallback = std::function<void(RequestResult)>;
+    bool sendRequest(json message, std::chrono::milliseconds timeout, ResponseCallback onResult);
+
+    // Same, for callers that would rather block (never the game thread)
+    std::future<RequestResult> sendRequest(json message, std::chrono::milliseconds timeout);
+
+    // Live queue (players, teams, match status), kept in sync from
+    // queue_snapshot/queue_delta on the network thread. Cheap from any thread:
+    // returns the current immutable state; a new object means it changed.
+    std::shared_ptr<const LiveQueueState> getQueueState() const;
+
+    // Snapshots requested because of gaps, bad patches or reconnects
+    size_t getQueueResyncCount() const;
+
+    // Outcome of the last auth request. The token (and session to resume) go
+    // in the upgrade request's headers, so the server can answer in its first
+    // frame; a server that ignores them gets an auth frame after
+    // HANDSHAKE_AUTH_TIMEOUT_MS, and the rest of this manager's connects skip
+    // the headers.
+    enum class AuthState { None, Pending, Accepted, Rejected, TimedOut };
+    AuthState getAuthState() const;
+
+    // From sending the upgrade request to the first message worth having
+    // (queue state, or something for the game thread) on the last connect of
+    // the active link; -1 until there has been one
+    long long getLastTimeToFirstMessageMicros() const;
+
+    // When an auth request was first accepted since start(), time_point() until
+    // then. Measured against the plugin's load time it gives the startup cost.
+    std::chrono::steady_clock::time_point getFirstAuthenticatedAt() const;
+
+    // Session resume. Messages the server pushes carry a sessionSeq; acks for
+    // the ones processed go back periodically and the auth request on
+    // reconnect presents the session, so the server replays only what was
+    // missed. Duplicates from a replay are dropped here.
+    //
+    // getResumeState() after stop() and setResumeState() before start() carry
+    // the session over to a new NetworkManager (e.g. a manual reconnect).
+    SessionResumeState getResumeState() const;
+    void setResumeState(const SessionResumeState& state);
+    size_t getDuplicateCount() const;
+
+    // Server clock estimate from ping/pong exchanges on the active link: a
+    // burst after each connect, then every CLOCK_SYNC_INTERVAL_MS
+    bool isClockSynced() const;
+    double getClockOffsetMs() const;    // Server minus local
+    double getClockRttMs() const;
+
+    // Messages whose server deadline had already passed when they arrived
+    // (e.g. replayed after a disconnect), dropped before queueing
+    size_t getExpiredCount() const;
+
+    // Authenticate the open connection(s) again with a different token, without
+    // reconnecting. Returns false if not connected.
+    bool reauthenticate(const std::string& token);
+
     // Get current queue size
     size_t getQueueSize() const;
 
+    // Endpoint currently in use
+    std::string getCurrentEndpoint() const;
+
+    // Handshake RTT of the current endpoint from the last probe, -1 if unknown
+    int getLastRttMs() const;
+
+    // Keep a second, idle connection open and promote it the moment the active
+    // one drops. Must be set before start().
+    void setHotStandbyEnabled(bool enabled);
+    bool isStandbyConnected() const;
+
+    // CPU affinity and priority for the lws service thread(s), and for the
+    // sweep and re-rank helpers. Applied as each thread starts; set before start().
+    void setThreadTuning(const ThreadTuning& network, const ThreadTuning& helper);
+
+    // Time from detecting the primary drop to the standby carrying traffic
+    long long getLastPromotionMicros() const;
+    int getPromotionCount() const;
+
     // Clear all pending messages
     void clearQueue();
 
+    // Plugin settings used to drop lobby actions the game thread would ignore
+    // anyway, before they take a queue slot. Set before start().
+    void setSettingsSource(std::shared_ptr<SettingsSnapshot> settings);
+
+    // Messages discarded because the matching setting is off
+    size_t getFilteredCount() const;
+
+    // Tell the server which message types and lobby actions this client acts
+    // on, so it stops sending the rest. Sent on every connect; call this after
+    // the settings change to resend if the subscription changed. The local
+    // filter stays in place for servers that ignore it.
+    void updateSubscription();
+    static json buildSubscription(const PluginSettings* settings);
+
+    // Frames received on the active link since start
+    size_t getReceivedCount() const;
+
+    // Frames rejected by validation, and valid ones lost to a full queue
+    size_t getInvalidCount() const;
+    size_t getDroppedCount() const;
+
+    // Feed a frame through the receive path (validation, filtering, queueing) as
+    // if it had arrived on the active link. Lets tools/ReplayHarness drive the
+    // manager from a capture without a server; works whether or not started.
+    // receivedAt lets a simulated clock stamp the frame.
+    void injectMessage(const json& message,
+        std::chrono::steady_clock::time_point receivedAt = std::chrono::steady_clock::now());
+
+    // Bumped whenever connection state or the active endpoint changes, so the
+    // UI can refresh its cached copy only when something actually changed
+    unsigned getStateVersion() const;
+
 private:
     // Callback functions for WebSocket client
+    void onClientMessage(WebSocketClient* source, const json& message);
     void onMessageReceived(const json& message);
-    void onConnectionChanged(bool connected);
+    void ingestMessage(const json& message, std::chrono::steady_clock::time_point receivedAt);
+    void enqueueForGame(InboundMessage inbound, const std::string& messageType);
+    void onConnectionChanged(WebSocketClient* source, bool connected);
+
+    // Correlated requests
+    bool sendRequestOn(WebSocketClient* client, json message, std::chrono::milliseconds timeout,
+        ResponseCallback onResult);
+    bool completeReply(const json& message);
+    void sweepLoop();
+    void authenticate(WebSocketClient* client);
+    void onAuthResult(WebSocketClient* client, const RequestResult& result);
+    WebSocketClient::HandshakeHeaders handshakeHeaders(WebSocketClient* client);
+    void onHandshakeAuthResult(WebSocketClient* client, uint64_t id, const RequestResult& result);
+    std::atomic<uint64_t>& handshakeAuthId(WebSocketClient* client);
+    std::atomic<AuthState>& authStateOf(WebSocketClient* client);
+    void cancelHandshakeAuth(WebSocketClient* client);
+    void noteFirstMessage();
+    void flushAck(bool force);
+    void syncClock(std::chrono::steady_clock::time_point now);
+    void flushSpool();
+    void rewindSpool();
+    void onSpoolAck(uint64_t record);
+    bool stampDeadline(InboundMessage& inbound) const;
+    void sendSubscription(WebSocketClient* client);
+
+    // Live queue
+    void applyQueueMessage(const json& message);
+    void requestQueueResync();
+
+    // Hot standby
+    WebSocketClient* getStandbyClient() const;
+    bool promoteStandby(WebSocketClient* failed, WebSocketClient* standby);
+    void announceRole(WebSocketClient* client, const char* role);
 
     // Validate and process incoming messages
     bool validateMessage(const json& message);
-    void processMessage(const json& message);
+    void processMessage(const json& message, std::chrono::steady_clock::time_point receivedAt,
+        uint64_t sessionSeq);
+    bool isWantedBySettings(const std::string& messageType, const json& message) const;
+
+    // Periodic endpoint re-ranking
+    void rerankLoop();
+    void applyProbeResults(const std::vector<EndpointProbeResult>& results);
 
     // Member variables
     std::unique_ptr<WebSocketClient> wsClient_;
-    ThreadSafeQueue<json> messageQueue_;
+    ThreadSafeQueue<InboundMessage> messageQueue_;
     std::atomic<bool> running_;
     std::atomic<bool> connected_;
 
+    // Hot standby
+    std::unique_ptr<WebSocketClient> standbyClient_;
+    std::atomic<WebSocketClient*> activeClient_; // Whichever of the two currently carries traffic
+    bool hotStandbyEnabled_;
+    ThreadTuning networkTuning_;
+    ThreadTuning helperTuning_;
+    std::atomic<long long> lastPromotionMicros_;
+    std::atomic<int> promotionCount_;
+
     std::string currentUrl_;
+    mutable std::mutex tokenMutex_;
     std::string currentToken_;
+
+    PendingRequests<SixMansConfig::MAX_PENDING_REQUESTS> pending_;
+    std::atomic<AuthState> authState_;             // The active link's; reports wait for Accepted
+    std::atomic<AuthState> standbyAuthState_;      // Carried over to authState_ on promotion
+    std::atomic<bool> handshakeAuth_;               // Cleared once a server ignores the headers
+    std::atomic<uint64_t> primaryHandshakeAuthId_;  // Request id sent in wsClient_'s headers, 0 if none
+    std::atomic<uint64_t> standbyHandshakeAuthId_;  // Same for standbyClient_
+    std::atomic<std::chrono::steady_clock::rep> upgradeSentAt_;
+    std::atomic<bool> firstMessagePending_;
+    std::atomic<long long> lastTimeToFirstMessageMicros_;
+    std::atomic<std::chrono::steady_clock::rep> firstAuthenticatedAt_; // 0 until then
+
+    LiveQueue liveQueue_;
+    std::atomic<bool> queueResyncPending_;
+    std::atomic<size_t> queueResyncCount_;
+    SessionTracker session_;
+    std::string standbySessionId_;              // Guarded by tokenMutex_
+    SessionResumeState stoppedResumeState_;
+    std::atomic<size_t> duplicateCount_;
+
+    ClockSync clock_;
+    std::atomic<int> clockSyncBurst_;           // Quick samples still owed since the last connect
+    std::atomic<bool> clockSyncPending_;
+    std::chrono::steady_clock::time_point lastClockSync_; // Sweep thread only
+    std::atomic<size_t> expiredCount_;
+    std::shared_ptr<OutboundSpool> spool_;
+    std::atomic<bool> spoolAcks_;               // Cleared once a server leaves spooled reports unacknowledged
+    std::atomic<uint64_t> spoolLastSent_;       // Record number of the last spooled report sent
+    std::atomic<std::chrono::steady_clock::rep> spoolAckDueAt_; // Ack deadline of what's in flight, 0 if nothing is
+
+    // Times out requests, paces session acks and clock sync pings, flushes the spool
+    std::unique_ptr<std::thread> sweepThread_;
+    std::mutex sweepMutex_;
+    std::condition_variable sweepCondition_;
+    bool sweepKick_ = false;                    // Guarded by sweepMutex_
+
+    std::shared_ptr<SettingsSnapshot> settings_;
+    std::atomic<size_t> filteredCount_;
+    std::atomic<unsigned> subscriptionMask_;  // What the last subscription sent asked for
+    std::atomic<size_t> receivedCount_;
+    std::atomic<size_t> invalidCount_;
+    std::atomic<size_t> droppedCount_;
+    std::atomic<unsigned> stateVersion_;
+
+    std::vector<std::string> endpoints_;
+    std::atomic<int> lastRttMs_;
+    std::unique_ptr<std::thread> rerankThread_;
+    std::mutex rerankMutex_;
+    std::condition_variable rerankCondition_;
 };
\ No newline at end of file
@@ -0,0 +1,284 @@
+#include "pch.h"
+#include "OutboundSpool.h"
+#include "logging.h"
+#include <atomic>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace OutboundSpoolFormat;
+
+namespace {
+    // True if the file at path is a spool with this geometry, so its records can be kept
+    bool isCompatibleSpool(const std::filesystem::path& path, uint32_t slotCount, uint32_t slotSize, size_t size) {
+        std::error_code ec;
+        if (std::filesystem::file_size(path, ec) != size || ec) {
+            return false;
+        }
+        std::ifstream file(path, std::ios::binary);
+        FileHeader header{};
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            return false;
+        }
+        return header.magic == MAGIC && header.version == VERSION
+            && header.slotCount == slotCount && header.slotSize == slotSize
+            && header.head >= header.tail && header.head - header.tail <= slotCount;
+    }
+}
+
+OutboundSpool::~OutboundSpool() {
+    close();
+}
+
+bool OutboundSpool::open(const std::filesystem::path& path, uint32_t slotCount, uint32_t slotSize) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (header_) {
+        return true;
+    }
+    if (slotCount == 0 || slotSize <= sizeof(SlotHeader)) {
+        LOG("Outbound spool: invalid geometry {}x{}", slotCount, slotSize);
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    size_t size = sizeof(FileHeader) + static_cast<size_t>(slotCount) * slotSize;
+    bool keep = isCompatibleSpool(path, slotCount, slotSize, size);
+    uint8_t* base = mapFile(path, size, !keep);
+    if (!base) {
+        LOG("Outbound spool: failed to map {}", path.string());
+        return false;
+    }
+
+    mapping_ = base;
+    header_ = reinterpret_cast<FileHeader*>(base);
+    if (keep) {
+        size_t recovered = recover();
+        if (recovered > 0) {
+            LOG("Outbound spool: {} message(s) left from the last session, sending after the next auth", recovered);
+        }
+    }
+    else {
+        std::memset(base, 0, size);
+        header_->magic = MAGIC;
+        header_->version = VERSION;
+        header_->slotCount = slotCount;
+        header_->slotSize = slotSize;
+        header_->head = 0;
+        header_->tail = 0;
+    }
+    sendCursor_ = header_->tail;
+    pendingCount_.store(static_cast<size_t>(header_->head - header_->tail), std::memory_order_release);
+
+    LOG("Outbound spool: {} slots of {} bytes in {}", slotCount, slotSize, path.string());
+    return true;
+}
+
+void OutboundSpool::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!header_) {
+        return;
+    }
+    header_ = nullptr;
+    pendingCount_.store(0, std::memory_order_release);
+    unmapFile();
+}
+
+bool OutboundSpool::isOpen() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return header_ != nullptr;
+}
+
+size_t OutboundSpool::recover() {
+    // head in the file may lag behind a record whose append finished just
+    // before the crash; the slots themselves say how far the queue goes
+    uint64_t record = header_->tail;
+    while (record - header_->tail < header_->slotCount) {
+        const SlotHeader* slotHeader = reinterpret_cast<const SlotHeader*>(slot(record));
+        if (slotHeader->seq != record + 1 || slotHeader->length > header_->slotSize - sizeof(SlotHeader)) {
+            break;
+        }
+        ++record;
+    }
+    header_->head = record;
+    return static_cast<size_t>(record - header_->tail);
+}
+
+uint8_t* OutboundSpool::slot(uint64_t record) const {
+    return mapping_ + sizeof(FileHeader) + (record % header_->slotCount) * header_->slotSize;
+}
+
+bool OutboundSpool::append(std::string_view payload) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!header_) {
+        return false;
+    }
+
+    uint64_t head = header_->head;
+    if (payload.size() > header_->slotSize - sizeof(SlotHeader) || head - header_->tail >= header_->slotCount) {
+        ++droppedCount_;
+        return false;
+    }
+
+    uint8_t* target = slot(head);
+    SlotHeader* slotHeader = reinterpret_cast<SlotHeader*>(target);
+
+    // Invalidate first and publish last, so a crash mid-copy loses only this record
+    std::atomic_ref<uint64_t> seq(slotHeader->seq);
+    seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slotHeader->length = static_cast<uint32_t>(payload.size());
+    std::memcpy(target + sizeof(SlotHeader), payload.data(), payload.size());
+    seq.store(head + 1, std::memory_order_release);
+
+    std::atomic_ref<uint64_t>(header_->head).store(head + 1, std::memory_order_release);
+    pendingCount_.store(static_cast<size_t>(head + 1 - header_->tail), std::memory_order_release);
+    return true;
+}
+
+size_t OutboundSpool::flush(size_t maxCount, const Sender& send) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!header_) {
+        return 0;
+    }
+
+    size_t sent = 0;
+    while (sent < maxCount && sendCursor_ != header_->head) {
+        const uint8_t* source = slot(sendCursor_);
+        const SlotHeader* slotHeader = reinterpret_cast<const SlotHeader*>(source);
+        if (!send(sendCursor_,
+            std::string_view(reinterpret_cast<const char*>(source + sizeof(SlotHeader)), slotHeader->length))) {
+            break;
+        }
+        ++sendCursor_;
+        ++sent;
+    }
+    return sent;
+}
+
+size_t OutboundSpool::acknowledge(uint64_t record) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!header_ || record < header_->tail || record >= sendCursor_) {
+        return 0; // Already acknowledged, or never sent (a stale or bogus ack)
+    }
+
+    size_t removed = static_cast<size_t>(record + 1 - header_->tail);
+    std::atomic_ref<uint64_t>(header_->tail).store(record + 1, std::memory_order_release);
+    pendingCount_.store(static_cast<size_t>(header_->head - header_->tail), std::memory_order_release);
+    return removed;
+}
+
+void OutboundSpool::rewind() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (header_) {
+        sendCursor_ = header_->tail;
+    }
+}
+
+size_t OutboundSpool::pending() const {
+    return pendingCount_.load(std::memory_order_acquire);
+}
+
+size_t OutboundSpool::unsent() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return header_ ? static_cast<size_t>(header_->head - sendCursor_) : 0;
+}
+
+size_t OutboundSpool::getDroppedCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return droppedCount_;
+}
+
+#ifdef _WIN32
+
+uint8_t* OutboundSpool::mapFile(const std::filesystem::path& path, size_t size, bool truncate) {
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+        nullptr, truncate ? CREATE_ALWAYS : OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+
+    ULARGE_INTEGER mappingSize;
+    mappingSize.QuadPart = size;
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE,
+        mappingSize.HighPart, mappingSize.LowPart, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    fileHandle_ = file;
+    mappingHandle_ = mapping;
+    mappingSize_ = size;
+    return static_cast<uint8_t*>(view);
+}
+
+void OutboundSpool::unmapFile() {
+    if (mapping_) {
+        FlushViewOfFile(mapping_, mappingSize_);
+        UnmapViewOfFile(mapping_);
+        mapping_ = nullptr;
+    }
+    if (mappingHandle_) {
+        CloseHandle(mappingHandle_);
+        mappingHandle_ = nullptr;
+    }
+    if (fileHandle_) {
+        CloseHandle(fileHandle_);
+        fileHandle_ = nullptr;
+    }
+    mappingSize_ = 0;
+}
+
+#else
+
+uint8_t* OutboundSpool::mapFile(const std::filesystem::path& path, size_t size, bool truncate) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | (truncate ? O_TRUNC : 0), 0644);
+    if (fd < 0) {
+        return nullptr;
+    }
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (view == MAP_FAILED) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    fd_ = fd;
+    mappingSize_ = size;
+    return static_cast<uint8_t*>(view);
+}
+
+void OutboundSpool::unmapFile() {
+    if (mapping_) {
+        msync(mapping_, mappingSize_, MS_ASYNC);
+        munmap(mapping_, mappingSize_);
+        mapping_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    mappingSize_ = 0;
+}
+
+#endif
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string_view>
+
+// On-disk layout.
+//
+// The file is a FileHeader followed by slotCount fixed-size slots. Record
+// number n lives in slot n % slotCount; records tail .. head-1 are waiting for
+// the server to acknowledge them. A slot's seq field is n + 1 once record n is completely written and
+// 0 while it is being written, so a crash mid-append leaves nothing half-valid.
+namespace OutboundSpoolFormat {
+    constexpr uint32_t MAGIC = 0x50534D53; // "SMSP"
+    constexpr uint32_t VERSION = 1;
+
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t slotCount;
+        uint32_t slotSize;          // Bytes per slot, SlotHeader included
+        uint64_t head;              // Next record number to append
+        uint64_t tail;              // Oldest record not acknowledged yet
+        uint8_t reserved[32];
+    };
+    static_assert(sizeof(FileHeader) == 64, "FileHeader layout changed");
+
+    struct SlotHeader {
+        uint64_t seq;               // Record number + 1, or 0 if empty/incomplete
+        uint32_t length;            // Payload bytes after the header
+        uint32_t reserved;
+    };
+    static_assert(sizeof(SlotHeader) == 16, "SlotHeader layout changed");
+}
+
+// Store-and-forward queue for outbound messages that must outlive a dropped
+// link, or a crash of the game.
+//
+// A bounded FIFO in a memory-mapped file, laid out like the flight recorder:
+// an append is on disk as soon as it returns, and open() picks up whatever the
+// previous session didn't get to send. flush() only hands records to the
+// connection; they stay until acknowledge() says the server has them, and
+// rewind() sends them again once that connection is gone. Delivery is at least
+// once: a record the server got but didn't get to acknowledge is sent twice,
+// with the same record number.
+//
+// Thread-safe. flush() holds the lock while it hands records over, so an
+// append made meanwhile lands behind them and order is kept.
+class OutboundSpool {
+public:
+    using Sender = std::function<bool(uint64_t record, std::string_view payload)>;
+
+    OutboundSpool() = default;
+    ~OutboundSpool();
+
+    // Non-copyable
+    OutboundSpool(const OutboundSpool&) = delete;
+    OutboundSpool& operator=(const OutboundSpool&) = delete;
+
+    // Map the spool file. Records left in it are kept if it has the same
+    // geometry; otherwise it starts out empty.
+    bool open(const std::filesystem::path& path, uint32_t slotCount, uint32_t slotSize);
+
+    // Unmap the file; unsent records stay in it for the next open()
+    void close();
+
+    bool isOpen() const;
+
+    // Queue one message. False if not open, full, or longer than a slot.
+    bool append(std::string_view payload);
+
+    // Hand up to maxCount records not sent since the last rewind(), oldest
+    // first, to send with their record numbers. The first false ends the pass.
+    // Returns how many went; they stay spooled until acknowledged.
+    size_t flush(size_t maxCount, const Sender& send);
+
+    // The server has every record up to and including this one. Only records
+    // already sent count. Returns how many were removed.
+    size_t acknowledge(uint64_t record);
+
+    // The connection the unacknowledged records went out on is gone; the next
+    // flush() starts over from the oldest
+    void rewind();
+
+    // Records waiting, sent or not. Lock-free, so it's cheap enough for every frame.
+    size_t pending() const;
+
+    // Records not sent since the last rewind()
+    size_t unsent() const;
+
+    // Appends refused because the spool was full or the message too long
+    size_t getDroppedCount() const;
+
+private:
+    // Map the file at the given size, optionally truncating it first
+    uint8_t* mapFile(const std::filesystem::path& path, size_t size, bool truncate);
+    void unmapFile();
+
+    // Rebuild head from the slots after an unclean shutdown
+    size_t recover();
+
+    uint8_t* slot(uint64_t record) const;
+
+    mutable std::mutex mutex_;
+    uint8_t* mapping_ = nullptr;
+    size_t mappingSize_ = 0;
+    OutboundSpoolFormat::FileHeader* header_ = nullptr;
+    uint64_t sendCursor_ = 0;              // Next record to flush; tail after open() and rewind()
+    size_t droppedCount_ = 0;
+    std::atomic<size_t> pendingCount_{ 0 }; // Mirrors head - tail for lock-free polling
+
+#ifdef _WIN32
+    void* fileHandle_ = nullptr;
+    void* mappingHandle_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// Outcome of a correlated request
+struct RequestResult {
+    enum class Status {
+        Ok,             // response holds the reply
+        Timeout,        // No reply before the deadline
+        SendFailed,     // Not connected, or the pending table was full
+        Cancelled,      // NetworkManager stopped first
+    };
+
+    Status status = Status::Cancelled;
+    json response;
+
+    bool ok() const { return status == Status::Ok; }
+};
+
+// Fixed table of requests waiting for a reply, keyed by correlation id.
+//
+// A request lives in slot id % N. Each slot is owned through its id word:
+// FREE, BUSY (being filled or emptied) or the id of the request it holds.
+// Completing, expiring and cancelling all CAS the id to BUSY first, so exactly
+// one of them gets the callback and runs it, on whatever thread won. No locks
+// on the reply path; the receive thread only pays for a CAS on a matching id.
+template<size_t N>
+class PendingRequests {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Callback = std::function<void(RequestResult)>;
+
+    PendingRequests() = default;
+
+    // Non-copyable
+    PendingRequests(const PendingRequests&) = delete;
+    PendingRequests& operator=(const PendingRequests&) = delete;
+
+    // Reserve a slot for a new request. Returns its correlation id, or 0 if
+    // all N slots are taken (callback is left untouched then).
+    uint64_t add(Clock::time_point deadline, Callback&& callback) {
+        for (size_t attempt = 0; attempt < N; ++attempt) {
+            uint64_t id = nextId_.fetch_add(1, std::memory_order_relaxed);
+            if (id == FREE || id == BUSY) {
+                continue;
+            }
+
+            Slot& slot = slots_[id % N];
+            uint64_t expected = FREE;
+            if (!slot.id.compare_exchange_strong(expected, BUSY, std::memory_order_acquire)) {
+                continue; // Still in use by an older request, try the next id
+            }
+            slot.deadline.store(deadline.time_since_epoch().count(), std::memory_order_relaxed);
+            slot.callback = std::move(callback);
+            slot.id.store(id, std::memory_order_release);
+            count_.fetch_add(1, std::memory_order_relaxed);
+            return id;
+        }
+        return 0;
+    }
+
+    // Deliver a reply. False if id is unknown or already expired/cancelled.
+    bool complete(uint64_t id, const json& response) {
+        Callback callback = take(id);
+        if (!callback) {
+            return false;
+        }
+        callback(RequestResult{ RequestResult::Status::Ok, response });
+        return true;
+    }
+
+    // Give up on one request, e.g. because the send failed after add()
+    bool fail(uint64_t id, RequestResult::Status status) {
+        Callback callback = take(id);
+        if (!callback) {
+            return false;
+        }
+        callback(RequestResult{ status, json() });
+        return true;
+    }
+
+    // Time out everything past its deadline. Returns how many expired.
+    size_t expire(Clock::time_point now) {
+        if (count_.load(std::memory_order_relaxed) == 0) {
+            return 0;
+        }
+
+        size_t expired = 0;
+        for (Slot& slot : slots_) {
+            uint64_t id = slot.id.load(std::memory_order_acquire);
+            // The slot may be recycled under us; then the CAS in fail() misses
+            if (id == FREE || id == BUSY
+                || slot.deadline.load(std::memory_order_relaxed) > now.time_since_epoch().count()) {
+                continue;
+            }
+            expired += fail(id, RequestResult::Status::Timeout) ? 1 : 0;
+        }
+        return expired;
+    }
+
+    // Complete every outstanding request with status (used on stop)
+    void failAll(RequestResult::Status status) {
+        for (Slot& slot : slots_) {
+            uint64_t id = slot.id.load(std::memory_order_acquire);
+            if (id != FREE && id != BUSY) {
+                fail(id, status);
+            }
+        }
+    }
+
+    size_t size() const {
+        return count_.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr uint64_t FREE = 0;
+    static constexpr uint64_t BUSY = std::numeric_limits<uint64_t>::max();
+
+    struct Slot {
+        std::atomic<uint64_t> id{ FREE };
+        std::atomic<Clock::rep> deadline{ 0 }; // Written while BUSY
+        Callback callback;
+    };
+
+    Callback take(uint64_t id) {
+        if (id == FREE || id == BUSY) {
+            return nullptr;
+        }
+        Slot& slot = slots_[id % N];
+        uint64_t expected = id;
+        if (!slot.id.compare_exchange_strong(expected, BUSY, std::memory_order_acq_rel)) {
+            return nullptr;
+        }
+        Callback callback = std::move(slot.callback);
+        slot.callback = nullptr;
+        slot.id.store(FREE, std::memory_order_release);
+        count_.fetch_sub(1, std::memory_order_relaxed);
+        return callback;
+    }
+
+    std::array<Slot, N> slots_;
+    std::atomic<uint64_t> nextId_{ 1 };
+    std::atomic<size_t> count_{ 0 };
+};
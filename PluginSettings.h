@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+// Plain copy of the plugin's cvars
+struct PluginSettings {
+    bool pluginEnabled = true;
+    bool autoJoin = false;
+    bool autoCreate = false;
+    bool hotStandby = false;
+    std::string verificationToken;
+    std::string serverEndpoints;
+
+    // Thread placement (see ThreadTuning): CPU list or hex mask, priority -2..2
+    std::string networkThreadAffinity;
+    int networkThreadPriority = 0;
+    std::string helperThreadAffinity;
+    int helperThreadPriority = 0;
+};
+
+// Immutable settings snapshot shared between the game, render and network threads.
+//
+// The game thread rebuilds and publishes a new snapshot from addOnValueChanged
+// whenever a cvar changes; readers just load the current pointer, so nobody looks
+// cvars up by name on a hot path and nobody sees a half-updated set.
+class SettingsSnapshot {
+public:
+    SettingsSnapshot()
+        : current_(std::make_shared<const PluginSettings>()) {}
+
+    // Non-copyable
+    SettingsSnapshot(const SettingsSnapshot&) = delete;
+    SettingsSnapshot& operator=(const SettingsSnapshot&) = delete;
+
+    std::shared_ptr<const PluginSettings> load() const {
+        return current_.load(std::memory_order_acquire);
+    }
+
+    void publish(PluginSettings settings) {
+        current_.store(std::make_shared<const PluginSettings>(std::move(settings)), std::memory_order_release);
+        version_.fetch_add(1, std::memory_order_release);
+    }
+
+    // Bumped on every publish; lets readers cache derived state cheaply
+    unsigned version() const {
+        return version_.load(std::memory_order_acquire);
+    }
+
+private:
+    std::atomic<std::shared_ptr<const PluginSettings>> current_;
+    std::atomic<unsigned> version_{ 0 };
+};
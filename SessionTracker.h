@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+
+// What a later connection needs to pick the session up again
+struct SessionResumeState {
+    std::string sessionId;   // Resume token from the server's auth_response, empty if none
+    uint64_t lastSeq = 0;    // Everything up to here has been processed
+};
+
+// Client side of session resume. The server numbers every message it pushes
+// ("sessionSeq") and keeps what the client hasn't acknowledged. On reconnect
+// the client presents the session id and the last seq it processed, and the
+// server replays only what came after.
+//
+// Tracks three things:
+//   - which seqs have arrived, so replayed duplicates are dropped (a window of
+//     WINDOW seqs above the highest contiguous one);
+//   - which arrived messages are still waiting in the game-thread queue, so the
+//     ack never covers something a stop() could still throw away;
+//   - when the last cumulative ack went out, to pace acks.
+//
+// Used from the network thread(s), the sweep thread and getNextMessage on the
+// game thread; one short mutex section per call.
+class SessionTracker {
+public:
+    static constexpr size_t WINDOW = 1024;
+    using Clock = std::chrono::steady_clock;
+
+    SessionTracker() = default;
+
+    // Non-copyable
+    SessionTracker(const SessionTracker&) = delete;
+    SessionTracker& operator=(const SessionTracker&) = delete;
+
+    // Start over for a session whose messages are processed through lastSeq
+    void reset(const std::string& sessionId, uint64_t lastSeq = 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sessionId_ = sessionId;
+        contiguous_ = lastSeq;
+        ahead_.reset();
+        queued_.clear();
+        lastAckSent_ = lastSeq;
+    }
+
+    // False if seq was already seen (a replayed duplicate)
+    bool accept(uint64_t seq) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (seq <= contiguous_) {
+            return false;
+        }
+
+        uint64_t offset = seq - contiguous_ - 1;
+        if (offset >= WINDOW) {
+            // Too far ahead to track the hole; whatever is missing below the
+            // window is given up on
+            uint64_t shift = offset - WINDOW + 1;
+            ahead_ = shift >= WINDOW ? std::bitset<WINDOW>() : ahead_ >> shift;
+            contiguous_ += shift;
+            offset = WINDOW - 1;
+        }
+        if (ahead_.test(offset)) {
+            return false;
+        }
+        ahead_.set(offset);
+        while (ahead_.test(0)) {
+            ahead_ >>= 1;
+            ++contiguous_;
+        }
+        return true;
+    }
+
+    // An accepted message went into the game-thread queue / came out of it.
+    // The queue is FIFO, so consumption is always at the front.
+    void queued(uint64_t seq) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queued_.push_back(seq);
+    }
+
+    // The push that followed queued() failed
+    void unqueued(uint64_t seq) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!queued_.empty() && queued_.back() == seq) {
+            queued_.pop_back();
+        }
+    }
+
+    void consumed(uint64_t seq) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!queued_.empty() && queued_.front() == seq) {
+            queued_.pop_front();
+        }
+    }
+
+    // The queue was cleared on purpose; treat its contents as handled
+    void clearQueued() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queued_.clear();
+    }
+
+    // The ack to send now, if one is due: the seq is behind by everyNth, or
+    // interval has passed since the last one (force sends any change)
+    std::optional<uint64_t> takeAck(Clock::time_point now, Clock::duration interval, uint64_t everyNth,
+        bool force = false) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t processed = processedLocked();
+        if (sessionId_.empty() || processed <= lastAckSent_) {
+            return std::nullopt;
+        }
+        if (!force && processed - lastAckSent_ < everyNth && now - lastAckTime_ < interval) {
+            return std::nullopt;
+        }
+        lastAckSent_ = processed;
+        lastAckTime_ = now;
+        return processed;
+    }
+
+    // Take this before discarding the queue, so whatever was still in it is
+    // replayed on resume
+    SessionResumeState resumeState() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return SessionResumeState{ sessionId_, processedLocked() };
+    }
+
+private:
+    // Highest seq such that everything up to it arrived and none of it is
+    // still waiting in the game-thread queue
+    uint64_t processedLocked() const {
+        return queued_.empty() ? contiguous_ : std::min(contiguous_, queued_.front() - 1);
+    }
+
+    mutable std::mutex mutex_;
+    std::string sessionId_;
+    uint64_t contiguous_ = 0;
+    std::bitset<WINDOW> ahead_;     // Bit i: contiguous_ + 1 + i has arrived
+    std::deque<uint64_t> queued_;
+    uint64_t lastAckSent_ = 0;
+    Clock::time_point lastAckTime_{};
+};
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string_view>
+
+// Single-producer, single-consumer queue of byte messages laid out in a block
+// of memory that two processes map (see BrokerLink). The block starts with a
+// Header; records follow back to back, each a RecordHeader plus its payload
+// padded to 8 bytes. A record never wraps: if it doesn't fit before the end,
+// the producer leaves a WRAP marker and starts again at the front.
+//
+// head and tail are byte counts that only grow, so full and empty can't be
+// confused. Each side owns one of them; the other reads it with acquire.
+//
+// Waking the consumer is left to the caller: before sleeping the consumer
+// calls prepareWait(), and after a push the producer calls takeWaiter() and
+// sends a wakeup only if it returns true. An idle consumer costs the producer
+// one syscall per wakeup; a busy one costs it nothing.
+//
+// The other process can write anything into the block, so neither side trusts
+// a position or length it reads from it. Once one doesn't add up the ring is
+// corrupt: push() and front() fail from then on and the caller drops the peer.
+class SharedRing {
+public:
+    static constexpr uint32_t MAGIC = 0x52534D53; // "SMSR"
+
+    struct alignas(64) Header {
+        uint32_t magic;
+        uint32_t capacity;                      // Data bytes after the header, a power of two
+        alignas(64) std::atomic<uint64_t> head; // Written by the producer
+        alignas(64) std::atomic<uint64_t> tail; // Written by the consumer
+        alignas(64) std::atomic<uint32_t> consumerWaiting;
+    };
+
+    struct RecordHeader {
+        uint32_t length;
+        uint32_t tag;   // Caller's; BrokerLink stamps the connection generation
+    };
+
+    static constexpr uint32_t WRAP = UINT32_MAX;
+    static constexpr uint32_t MIN_CAPACITY = 4096;
+
+    // Bytes to map for a ring with the given data capacity
+    static constexpr size_t blockSize(uint32_t capacity) {
+        return sizeof(Header) + capacity;
+    }
+
+    SharedRing() = default;
+
+    // Lay a new, empty ring out over block (the creating side, before sharing)
+    static SharedRing create(void* block, uint32_t capacity) {
+        Header* header = new (block) Header();
+        header->magic = MAGIC;
+        header->capacity = capacity;
+        header->head.store(0, std::memory_order_relaxed);
+        header->tail.store(0, std::memory_order_relaxed);
+        header->consumerWaiting.store(0, std::memory_order_relaxed);
+        return SharedRing(header);
+    }
+
+    // Use a ring someone else created; invalid if block doesn't hold one
+    static SharedRing attach(void* block, size_t blockBytes) {
+        Header* header = static_cast<Header*>(block);
+        if (blockBytes < sizeof(Header) || header->magic != MAGIC || header->capacity < MIN_CAPACITY
+            || (header->capacity & (header->capacity - 1)) != 0 || blockSize(header->capacity) > blockBytes) {
+            return SharedRing();
+        }
+        return SharedRing(header);
+    }
+
+    bool isValid() const { return header_ != nullptr; }
+
+    // Producer: append one record. False if it doesn't fit right now (or the
+    // ring is corrupt).
+    bool push(uint32_t tag, const void* data, size_t length) {
+        uint32_t capacity = capacity_;
+        size_t needed = recordSize(length);
+        if (corrupt_ || length >= WRAP || needed > capacity) {
+            return false;
+        }
+
+        uint64_t head = header_->head.load(std::memory_order_relaxed);
+        uint64_t tail = header_->tail.load(std::memory_order_acquire);
+        if (!isSane(head, tail)) {
+            return false;
+        }
+        size_t offset = static_cast<size_t>(head & (capacity - 1));
+        size_t untilEnd = capacity - offset;
+        size_t skip = needed > untilEnd ? untilEnd : 0;
+        if (head + skip + needed - tail > capacity) {
+            return false;
+        }
+
+        if (skip > 0) {
+            RecordHeader marker{ WRAP, 0 };
+            std::memcpy(data_ + offset, &marker, sizeof(marker));
+            head += skip;
+            offset = 0;
+        }
+        RecordHeader record{ static_cast<uint32_t>(length), tag };
+        std::memcpy(data_ + offset, &record, sizeof(record));
+        std::memcpy(data_ + offset + sizeof(record), data, length);
+        header_->head.store(head + needed, std::memory_order_release);
+        return true;
+    }
+
+    // Producer, after one or more pushes: true if the consumer was (about to
+    // go) asleep and needs waking. Clears the flag, so only one caller wakes it.
+    bool takeWaiter() {
+        std::atomic_thread_fence(std::memory_order_seq_cst); // Order the head store before this load
+        return header_->consumerWaiting.load(std::memory_order_relaxed) != 0
+            && header_->consumerWaiting.exchange(0, std::memory_order_relaxed) != 0;
+    }
+
+    // Consumer: the oldest record, if any. The view points into the ring and
+    // stays valid until pop(). Check isCorrupt() when this returns false.
+    bool front(uint32_t& tag, std::string_view& payload) {
+        if (corrupt_) {
+            return false;
+        }
+        uint32_t capacity = capacity_;
+        uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+        uint64_t head;
+        while (tail != (head = header_->head.load(std::memory_order_acquire))) {
+            if (!isSane(head, tail)) {
+                return false;
+            }
+            size_t offset = static_cast<size_t>(tail & (capacity - 1));
+            RecordHeader record;
+            std::memcpy(&record, data_ + offset, sizeof(record));
+            if (record.length == WRAP) {
+                tail += capacity - offset;
+                header_->tail.store(tail, std::memory_order_release);
+                continue;
+            }
+            // The record has to lie within what was published and before the end
+            if (record.length > capacity - offset - sizeof(record) || recordSize(record.length) > head - tail) {
+                corrupt_ = true;
+                return false;
+            }
+            tag = record.tag;
+            payload = std::string_view(reinterpret_cast<const char*>(data_ + offset + sizeof(record)), record.length);
+            frontSize_ = recordSize(record.length);
+            return true;
+        }
+        return false;
+    }
+
+    // Consumer: release the record front() returned
+    void pop() {
+        uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+        header_->tail.store(tail + frontSize_, std::memory_order_release);
+        frontSize_ = 0;
+    }
+
+    // Something in the block didn't add up; the peer is broken or hostile
+    bool isCorrupt() const { return corrupt_; }
+
+    // Consumer, before sleeping: announce it and re-check. Returns true if
+    // something arrived meanwhile, in which case don't sleep.
+    bool prepareWait() {
+        header_->consumerWaiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst); // Order this store before the head load
+        return header_->head.load(std::memory_order_acquire) != header_->tail.load(std::memory_order_relaxed);
+    }
+
+    // Consumer, on waking: no need to be woken while draining
+    void endWait() {
+        header_->consumerWaiting.store(0, std::memory_order_relaxed);
+    }
+
+    // Bytes queued, for either side's statistics
+    size_t usedBytes() const {
+        return static_cast<size_t>(header_->head.load(std::memory_order_acquire)
+            - header_->tail.load(std::memory_order_acquire));
+    }
+
+private:
+    explicit SharedRing(Header* header)
+        : header_(header), data_(reinterpret_cast<uint8_t*>(header) + sizeof(Header)), capacity_(header->capacity) {}
+
+    static size_t recordSize(size_t length) {
+        return sizeof(RecordHeader) + ((length + 7) & ~size_t{ 7 });
+    }
+
+    // Records are 8-byte aligned and never more than capacity apart
+    bool isSane(uint64_t head, uint64_t tail) {
+        if (((head | tail) & 7) != 0 || head - tail > capacity_) {
+            corrupt_ = true;
+        }
+        return !corrupt_;
+    }
+
+    Header* header_ = nullptr;
+    uint8_t* data_ = nullptr;
+    uint32_t capacity_ = 0;     // Read once: the peer could change the header's
+    size_t frontSize_ = 0;      // Bytes pop() releases
+    bool corrupt_ = false;
+};
@@ -10,30 +10,149 @@ void SixMansPlugin::VerifyToken(const std::string& token) {
         return;
     }
 
-    // If network is already initialized, restart it with the new token
+    // Already connected: ask the server about the new token on the same
+    // connection. The reply is matched to the request and shows up in the
+    // status line; no reconnect, no guessing how long to wait.
+    if (networkInitialized_ && networkManager_ && networkManager_->reauthenticate(token)) {
+        LOG("Token verification sent");
+        return;
+    }
+
+    // Otherwise restart with the new token; an auth request goes out as soon as
+    // a link connects
     if (networkInitialized_ && networkManager_) {
         LOG("Restarting network with new token");
         networkManager_->stop();
         networkManager_.reset();
         networkInitialized_ = false;
     }
-
-    // Initialize network with new token
-    gameWrapper->SetTimeout([this](GameWrapper*) {
+    resumeState_ = SessionResumeState(); // A session belongs to the old token
+    gameWrapper->Execute([this](GameWrapper*) {
         InitializeNetwork();
-        }, 1.0f);
+        });
 
     LOG("Token verification initiated");
 }
 
+void SixMansPlugin::refreshPanelState() {
+    // Settings: copy out of the snapshot only when a cvar changed
+    unsigned settingsVersion = settings_->version();
+    if (settingsVersion != panel_.settingsVersion) {
+        panel_.settingsVersion = settingsVersion;
+        panel_.settings = *settings_->load();
+
+        strncpy(panel_.tokenBuffer, panel_.settings.verificationToken.c_str(), sizeof(panel_.tokenBuffer) - 1);
+        panel_.tokenBuffer[sizeof(panel_.tokenBuffer) - 1] = '\0';
+        panel_.endpointsBuffer = panel_.settings.serverEndpoints;
+        panel_.networkAffinityBuffer = panel_.settings.networkThreadAffinity;
+        panel_.helperAffinityBuffer = panel_.settings.helperThreadAffinity;
+    }
+
+    // Network: re-read the endpoint only after a connect/disconnect/failover
+    const NetworkManager* network = networkManager_.get();
+    unsigned networkVersion = network ? network->getStateVersion() : 0;
+    if (network != panel_.network || networkVersion != panel_.networkVersion) {
+        panel_.network = network;
+        panel_.networkVersion = networkVersion;
+        panel_.endpoint = network ? network->getCurrentEndpoint() : std::string();
+    }
+
+    // Live queue: flatten the document into display strings once per update
+    std::shared_ptr<const LiveQueueState> queueState = network ? network->getQueueState() : nullptr;
+    if (queueState != panel_.queueState) {
+        panel_.queueState = queueState;
+        panel_.queueStatus.clear();
+        panel_.queuePlayers.clear();
+        panel_.blueTeam.clear();
+        panel_.orangeTeam.clear();
+        panel_.queuePlayerCount = 0;
+
+        // Entries are either names or {"name": ...} objects
+        auto joinNames = [](const json& document, const char* key, std::string& out) {
+            auto list = document.find(key);
+            if (list == document.end() || !list->is_array()) {
+                return size_t{ 0 };
+            }
+            for (const json& entry : *list) {
+                const json* name = entry.is_object() && entry.contains("name") ? &entry["name"] : &entry;
+                if (name->is_string()) {
+                    out += out.empty() ? "" : ", ";
+                    out += name->get_ref<const std::string&>();
+                }
+            }
+            return list->size();
+        };
+
+        if (queueState && queueState->document.is_object()) {
+            const json& document = queueState->document;
+            // Server patches decide the types here, so check before reading
+            auto status = document.find("status");
+            panel_.queueStatus = status != document.end() && status->is_string()
+                ? status->get_ref<const std::string&>() : "unknown";
+            panel_.queuePlayerCount = joinNames(document, "players", panel_.queuePlayers);
+            auto teams = document.find("teams");
+            if (teams != document.end() && teams->is_object()) {
+                joinNames(*teams, "blue", panel_.blueTeam);
+                joinNames(*teams, "orange", panel_.orangeTeam);
+            }
+        }
+    }
+}
+
+void SixMansPlugin::renderLiveQueue() {
+    ImGui::TextUnformatted("Live Queue");
+    const LiveQueueState* queueState = panel_.queueState.get();
+    if (!queueState || (!queueState->synced && queueState->seq == 0)) {
+        ImGui::TextUnformatted("Waiting for queue state...");
+        return;
+    }
+
+    ImGui::Text("Status: %s, %zu/6 queued%s", panel_.queueStatus.c_str(), panel_.queuePlayerCount,
+        queueState->synced ? "" : " (resyncing)");
+    if (!panel_.queuePlayers.empty()) {
+        ImGui::TextWrapped("Players: %s", panel_.queuePlayers.c_str());
+    }
+    if (!panel_.blueTeam.empty() || !panel_.orangeTeam.empty()) {
+        ImGui::TextColored(ImVec4(0.4f, 0.6f, 1.0f, 1.0f), "Blue: %s", panel_.blueTeam.c_str());
+        ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.2f, 1.0f), "Orange: %s", panel_.orangeTeam.c_str());
+    }
+}
+
+void SixMansPlugin::renderTelemetry() {
+    ImGui::TextUnformatted("Telemetry (last 2 minutes)");
+
+    char overlay[48];
+    const ImVec2 plotSize(0.0f, 40.0f);
+
+    snprintf(overlay, sizeof(overlay), "queue depth: %.0f", queueDepthHistory_.latest());
+    ImGui::PlotLines("##QueueDepth", &decltype(queueDepthHistory_)::plotGetter, &queueDepthHistory_,
+        queueDepthHistory_.size(), 0, overlay, 0.0f, std::max(queueDepthHistory_.max(), 1.0f), plotSize);
+
+    snprintf(overlay, sizeof(overlay), "rtt: %.0f ms", rttHistory_.latest());
+    ImGui::PlotLines("##Rtt", &decltype(rttHistory_)::plotGetter, &rttHistory_,
+        rttHistory_.size(), 0, overlay, 0.0f, std::max(rttHistory_.max(), 1.0f), plotSize);
+
+    snprintf(overlay, sizeof(overlay), "messages: %.0f/s", messageRateHistory_.latest());
+    ImGui::PlotLines("##MessageRate", &decltype(messageRateHistory_)::plotGetter, &messageRateHistory_,
+        messageRateHistory_.size(), 0, overlay, 0.0f, std::max(messageRateHistory_.max(), 1.0f), plotSize);
+
+    snprintf(overlay, sizeof(overlay), "dispatch latency: %.1f ms", dispatchLatencyHistory_.latest());
+    ImGui::PlotLines("##DispatchLatency", &decltype(dispatchLatencyHistory_)::plotGetter, &dispatchLatencyHistory_,
+        dispatchLatencyHistory_.size(), 0, overlay, 0.0f, std::max(dispatchLatencyHistory_.max(), 1.0f), plotSize);
+}
+
 void SixMansPlugin::RenderSettings() {
+    // Everything shown comes from the retained panel state; cvars are only
+    // looked up by name when the user actually changes something
+    refreshPanelState();
+    const PluginSettings& settings = panel_.settings;
+
     ImGui::Spacing();
 
     // Plugin Enabled Checkbox
-    CVarWrapper pluginEnabledCvar = cvarManager->getCvar("pluginEnabled");
-    bool pluginEnabled = pluginEnabledCvar.getBoolValue();
+    bool pluginEnabled = settings.pluginEnabled;
     if (ImGui::Checkbox("Enable Plugin", &pluginEnabled)) {
-        pluginEnabledCvar.setValue(static_cast<int>(pluginEnabled));
+        cvarManager->getCvar("pluginEnabled").setValue(static_cast<int>(pluginEnabled));
         cvarManager->executeCommand("writeconfig", false);
     }
 
@@ -41,32 +160,27 @@ void SixMansPlugin::RenderSettings() {
     ImGui::Separator();
     ImGui::Spacing();
 
-    // Verification Token Field
-    CVarWrapper verificationTokenCvar = cvarManager->getCvar("verificationToken");
-    std::string currentToken = verificationTokenCvar.getStringValue();
-    // Create a local buffer large enough for the token
-    char verificationToken[128];
-    strncpy(verificationToken, currentToken.c_str(), sizeof(verificationToken) - 1);
-    verificationToken[sizeof(verificationToken) - 1] = '\0';
+    // Verification Token Field (edited in place in the retained buffer)
+    char* verificationToken = panel_.tokenBuffer;
 
     ImGui::TextUnformatted("Verification Token");
-    if (ImGui::InputText("##VerificationToken", verificationToken, IM_ARRAYSIZE(verificationToken))) {
-        verificationTokenCvar.setValue(std::string(verificationToken));
+    if (ImGui::InputText("##VerificationToken", verificationToken, IM_ARRAYSIZE(panel_.tokenBuffer))) {
+        cvarManager->getCvar("verificationToken").setValue(std::string(verificationToken));
     }
 
     ImGui::SameLine();
     if (ImGui::Button("Apply")) {
-        verificationTokenCvar.setValue(std::string(verificationToken));
+        cvarManager->getCvar("verificationToken").setValue(std::string(verificationToken));
         VerifyToken(std::string(verificationToken));
         cvarManager->executeCommand("writeconfig", false);
     }
 
     // Status Display - Enhanced to show network connection status
-    bool hasToken = (strlen(verificationToken) > 0);
+    bool hasToken = verificationToken[0] != '\0';
     bool isConnected = networkManager_ && networkManager_->isConnected();
 
     ImVec4 statusColor;
-    std::string statusText;
+    const char* statusText;
 
     if (!hasToken) {
         statusColor = ImVec4(1, 0, 0, 1); // Red
@@ -77,8 +191,24 @@ void SixMansPlugin::RenderSettings() {
         statusText = "Initializing...";
     }
     else if (isConnected) {
-        statusColor = ImVec4(0, 1, 0, 1); // Green
-        statusText = "Connected";
+        switch (networkManager_->getAuthState()) {
+        case NetworkManager::AuthState::Rejected:
+            statusColor = ImVec4(1, 0, 0, 1); // Red
+            statusText = "Connected, token rejected";
+            break;
+        case NetworkManager::AuthState::TimedOut:
+            statusColor = ImVec4(1, 0.5, 0, 1); // Orange
+            statusText = "Connected, no auth response";
+            break;
+        case NetworkManager::AuthState::Pending:
+            statusColor = ImVec4(1, 1, 0, 1); // Yellow
+            statusText = "Connected, verifying token...";
+            break;
+        default:
+            statusColor = ImVec4(0, 1, 0, 1); // Green
+            statusText = "Connected";
+            break;
+        }
     }
     else {
         statusColor = ImVec4(1, 0.5, 0, 1); // Orange
@@ -86,7 +216,7 @@ void SixMansPlugin::RenderSettings() {
     }
 
     ImGui::PushStyleColor(ImGuiCol_Text, statusColor);
-    ImGui::Text("Status: %s", statusText.c_str());
+    ImGui::Text("Status: %s", statusText);
     ImGui::PopStyleColor();
 
     // Show queue size if network is active
@@ -96,6 +226,11 @@ void SixMansPlugin::RenderSettings() {
             ImGui::SameLine();
             ImGui::Text("(Queue: %zu)", queueSize);
         }
+        size_t spooled = networkManager_->getSpooledCount();
+        if (spooled > 0) {
+            ImGui::SameLine();
+            ImGui::Text("(Undelivered reports: %zu)", spooled);
+        }
     }
 
     ImGui::TextUnformatted("Get your token by typing !bmverify in the #bakkes-verify channel in the RL6Mans discord.");
@@ -106,16 +241,99 @@ void SixMansPlugin::RenderSettings() {
     // Network Settings Section
     ImGui::TextUnformatted("Network Settings");
 
+    // Endpoint list, applied on the next (re)connect
+    if (ImGui::InputText("Server Endpoints", &panel_.endpointsBuffer, ImGuiInputTextFlags_EnterReturnsTrue)) {
+        cvarManager->getCvar("serverEndpoints").setValue(panel_.endpointsBuffer);
+        cvarManager->executeCommand("writeconfig", false);
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Comma-separated ws:// or wss:// URLs. Leave empty for the default server. Press Enter, then Reconnect to apply.");
+    }
+    if (metricsServer_.isRunning()) {
+        ImGui::Text("Metrics: http://127.0.0.1:%d/metrics", metricsServer_.getPort());
+    }
+
     // Show connection info if connected
     if (isConnected) {
-        ImGui::Text("Connected to: %s", SixMansConfig::buildWebSocketUrl().c_str());
+        ImGui::Text("Connected to: %s", panel_.endpoint.c_str());
+        int rttMs = networkManager_->getLastRttMs();
+        if (rttMs >= 0) {
+            ImGui::SameLine();
+            ImGui::Text("(%d ms)", rttMs);
+        }
+        long long firstMessageMicros = networkManager_->getLastTimeToFirstMessageMicros();
+        if (firstMessageMicros >= 0) {
+            ImGui::SameLine();
+            ImGui::Text("(first message after %.1f ms)", firstMessageMicros / 1000.0);
+        }
+        if (loadToAuthMs_ >= 0) {
+            ImGui::Text("Authenticated %lld ms after plugin load", loadToAuthMs_);
+        }
+        if (networkManager_->isClockSynced()) {
+            ImGui::Text("Server clock: %+.1f ms (ping %.1f ms)", networkManager_->getClockOffsetMs(),
+                networkManager_->getClockRttMs());
+        }
+    }
+
+    // Hot standby toggle, applied on the next (re)connect
+    bool hotStandby = settings.hotStandby;
+    if (ImGui::Checkbox("Hot Standby Connection", &hotStandby)) {
+        cvarManager->getCvar("hotStandby").setValue(static_cast<int>(hotStandby));
+        cvarManager->executeCommand("writeconfig", false);
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Keeps a second idle connection open so a dropped link fails over instantly. Applied on reconnect.");
+    }
+    if (hotStandby && networkManager_) {
+        ImGui::SameLine();
+        ImGui::Text("(%s, %d failovers", networkManager_->isStandbyConnected() ? "ready" : "not ready",
+            networkManager_->getPromotionCount());
+        long long promotionMicros = networkManager_->getLastPromotionMicros();
+        if (promotionMicros >= 0) {
+            ImGui::SameLine(0.0f, 0.0f);
+            ImGui::Text(", last %lldus", promotionMicros);
+        }
+        ImGui::SameLine(0.0f, 0.0f);
+        ImGui::TextUnformatted(")");
+    }
+
+    // Thread placement, for keeping our threads off the game's busiest cores
+    if (ImGui::TreeNode("Thread Placement")) {
+        if (ImGui::InputText("Network CPUs", &panel_.networkAffinityBuffer, ImGuiInputTextFlags_EnterReturnsTrue)) {
+            cvarManager->getCvar("networkThreadAffinity").setValue(panel_.networkAffinityBuffer);
+            cvarManager->executeCommand("writeconfig", false);
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("CPUs the network thread may use: empty for any, 2,3 or 2-3, or a mask like 0xC. Press Enter, then Reconnect to apply.");
+        }
+        int networkPriority = settings.networkThreadPriority;
+        if (ImGui::SliderInt("Network Priority", &networkPriority, -2, 2)) {
+            cvarManager->getCvar("networkThreadPriority").setValue(networkPriority);
+            cvarManager->executeCommand("writeconfig", false);
+        }
+
+        if (ImGui::InputText("Helper CPUs", &panel_.helperAffinityBuffer, ImGuiInputTextFlags_EnterReturnsTrue)) {
+            cvarManager->getCvar("helperThreadAffinity").setValue(panel_.helperAffinityBuffer);
+            cvarManager->executeCommand("writeconfig", false);
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Same, for the logging, request sweep and endpoint re-rank threads.");
+        }
+        int helperPriority = settings.helperThreadPriority;
+        if (ImGui::SliderInt("Helper Priority", &helperPriority, -2, 2)) {
+            cvarManager->getCvar("helperThreadPriority").setValue(helperPriority);
+            cvarManager->executeCommand("writeconfig", false);
+        }
+        ImGui::TreePop();
     }
 
     // Manual reconnect button
-    if (!isConnected && hasToken) {
+    if (!isConnected && hasToken && !networkStarting_) {
         if (ImGui::Button("Reconnect")) {
             if (networkManager_) {
+                // Same token: pick the session up again instead of starting over
                 networkManager_->stop();
+                resumeState_ = networkManager_->getResumeState();
                 networkManager_.reset();
                 networkInitialized_ = false;
             }
@@ -137,12 +355,17 @@ void SixMansPlugin::RenderSettings() {
     ImGui::Separator();
     ImGui::Spacing();
 
+    renderLiveQueue();
+
+    ImGui::Spacing();
+    ImGui::Separator();
+    ImGui::Spacing();
+
     ImGui::TextUnformatted("Automatic Lobby Settings");
     // Auto Join Checkbox
-    CVarWrapper autoJoinCvar = cvarManager->getCvar("autoJoin");
-    bool autoJoinEnabled = autoJoinCvar.getBoolValue();
+    bool autoJoinEnabled = settings.autoJoin;
     if (ImGui::Checkbox("Auto Join 6Mans Lobbies", &autoJoinEnabled)) {
-        autoJoinCvar.setValue(static_cast<int>(autoJoinEnabled));
+        cvarManager->getCvar("autoJoin").setValue(static_cast<int>(autoJoinEnabled));
         cvarManager->executeCommand("writeconfig", false);
     }
     if (ImGui::IsItemHovered()) {
@@ -150,10 +373,9 @@ void SixMansPlugin::RenderSettings() {
     }
 
     // Auto Create Checkbox
-    CVarWrapper autoCreateCvar = cvarManager->getCvar("autoCreate");
-    bool autoCreateEnabled = autoCreateCvar.getBoolValue();
+    bool autoCreateEnabled = settings.autoCreate;
     if (ImGui::Checkbox("Auto Create 6Mans Lobbies", &autoCreateEnabled)) {
-        autoCreateCvar.setValue(static_cast<int>(autoCreateEnabled));
+        cvarManager->getCvar("autoCreate").setValue(static_cast<int>(autoCreateEnabled));
         cvarManager->executeCommand("writeconfig", false);
     }
     if (ImGui::IsItemHovered()) {
@@ -179,9 +401,31 @@ void SixMansPlugin::RenderSettings() {
         this->JoinPrivateLobby();
     }
     if (ImGui::IsItemHovered()) {
-        ImGui::SetTooltip("If this fails, it may not be up yet!");
+        ImGui::SetTooltip("Joins the last lobby the server sent. If this fails, it may not be up yet!");
     }
 
+    // Join state machine status
+    static const char* joinStateNames[] = { "Idle", "Joining", "Retrying", "In Lobby", "Failed" };
+    ImGui::Text("Join: %s", joinStateNames[static_cast<int>(lobby_->getJoinState())]);
+    long long lastJoinLatencyMs = lobby_->getLastJoinLatencyMs();
+    if (lastJoinLatencyMs >= 0) {
+        ImGui::SameLine();
+        ImGui::Text("(last join took %lld ms)", lastJoinLatencyMs);
+    }
+
+    // Actions the server said were no longer worth doing by the time we got to them
+    size_t expiredOnArrival = networkManager_ ? networkManager_->getExpiredCount() : 0;
+    size_t expiredInQueue = lobby_->getExpiredDropCount();
+    if (expiredOnArrival + expiredInQueue > 0) {
+        ImGui::Text("Expired and skipped: %zu on arrival, %zu while queued", expiredOnArrival, expiredInQueue);
+    }
+
+    ImGui::Spacing();
+    ImGui::Separator();
+    ImGui::Spacing();
+
+    renderTelemetry();
+
     ImGui::Spacing();
     ImGui::Separator();
     ImGui::Spacing();
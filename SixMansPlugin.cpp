@@ -3,8 +3,11 @@
 #include "SixMansPlugin.h"
 #include "logging.h"
 #include "Config.h"
+#include "AsyncLog.h"
+#include "FlightRecorder.h"
 #include <vector>
 #include <random>  
+#include <algorithm>
 #include <iostream>
 #include <nlohmann/json.hpp>
 
@@ -13,9 +16,23 @@ BAKKESMOD_PLUGIN(SixMansPlugin, "The official Bakkesmod plugin for 6mans", "1.0"
 std::shared_ptr<CVarManagerWrapper> _globalCvarManager;
 
 void SixMansPlugin::onLoad() {
+    loadedAt_ = std::chrono::steady_clock::now();
     _globalCvarManager = cvarManager;
     LOG("Plugin loaded!");
 
+    // Hot-path logging is formatted and written off the calling thread
+    AsyncLog::instance().start([](const std::string& line) {
+        _globalCvarManager->log(line);
+        });
+
+    // Raw frames go to a memory-mapped ring that survives a crash
+    FlightRecorder::instance().open(gameWrapper->GetDataFolder() / "sixmans" / SixMansConfig::FLIGHT_RECORDER_FILE,
+        SixMansConfig::FLIGHT_RECORDER_SLOTS, SixMansConfig::FLIGHT_RECORDER_SLOT_SIZE);
+
+    // Lobby reports the server hasn't had yet, including any a crash left behind
+    outboundSpool_->open(gameWrapper->GetDataFolder() / "sixmans" / SixMansConfig::OUTBOUND_SPOOL_FILE,
+        SixMansConfig::OUTBOUND_SPOOL_SLOTS, SixMansConfig::OUTBOUND_SPOOL_SLOT_SIZE);
+
     // !! Enable debug logging by setting DEBUG_LOG = true in logging.h !!
     // DEBUGLOG("SixMansPlugin debug mode enabled");
 
@@ -36,6 +53,63 @@ void SixMansPlugin::onLoad() {
         true
     );
 
+    // Register the serverEndpoints CVar (default: empty = compiled-in endpoint)
+    cvarManager->registerCvar(
+        "serverEndpoints",
+        "",
+        "Comma-separated WebSocket endpoints (ws[s]://host:port/path). The fastest healthy one is used, the rest are failover. "
+        "broker:<socket path> instead shares a local SixMansBroker's connection",
+        true
+    );
+
+    // Register the hotStandby CVar (default: off)
+    CVarWrapper hotStandbyCvar = cvarManager->registerCvar(
+        "hotStandby",
+        SixMansConfig::DEFAULT_HOT_STANDBY ? "1" : "0",
+        "Keep a second idle connection ready for instant failover",
+        true, true, 0, true, 1
+    );
+    hotStandbyCvar.setValue(hotStandbyCvar.getIntValue());
+
+    // Register the thread tuning CVars (default: leave it to the OS). The
+    // network ones apply on the next (re)connect, the helper ones also to the
+    // log drain thread right away.
+    cvarManager->registerCvar(
+        "networkThreadAffinity",
+        "",
+        "CPUs the network thread may run on: empty for any, a list like 2,3 or 2-3, or a hex mask like 0xC",
+        true
+    );
+    cvarManager->registerCvar(
+        "networkThreadPriority",
+        "0",
+        "Network thread priority, -2 (lowest) to 2 (highest). 0 = unchanged",
+        true, true, -2, true, 2
+    );
+    cvarManager->registerCvar(
+        "helperThreadAffinity",
+        "",
+        "CPUs the housekeeping threads (log, request sweep, endpoint re-rank) may run on, same format",
+        true
+    );
+    cvarManager->registerCvar(
+        "helperThreadPriority",
+        "0",
+        "Housekeeping thread priority, -2 (lowest) to 2 (highest). 0 = unchanged",
+        true, true, -2, true, 2
+    );
+    auto applyHelperTuning = [this]() {
+        AsyncLog::instance().setThreadTuning(ThreadTuning::fromSettings(
+            cvarManager->getCvar("helperThreadAffinity").getStringValue(),
+            cvarManager->getCvar("helperThreadPriority").getIntValue()));
+        };
+    for (const char* name : { "helperThreadAffinity", "helperThreadPriority" }) {
+        cvarManager->getCvar(name).addOnValueChanged([applyHelperTuning](std::string, CVarWrapper) {
+            applyHelperTuning();
+            });
+    }
+    applyHelperTuning();
+
     // Register the autoJoin CVar (default: "0")
     CVarWrapper autoJoinCvar = cvarManager->registerCvar(
         "autoJoin",
@@ -54,35 +128,137 @@ void SixMansPlugin::onLoad() {
     );
     autoCreateCvar.setValue(autoCreateCvar.getIntValue());
 
+    // Register the logLevel CVar (runtime filter on top of SIXMANS_MIN_LOG_LEVEL)
+    CVarWrapper logLevelCvar = cvarManager->registerCvar(
+        "logLevel",
+        std::to_string(SIXMANS_MIN_LOG_LEVEL),
+        "Minimum level for network and lobby logging. 0 = debug, 1 = info, 2 = warn, 3 = error, 4 = off",
+        true, true, 0, true, 4
+    );
+    logLevelCvar.addOnValueChanged([](std::string, CVarWrapper cvar) {
+        AsyncLog::instance().setLevel(static_cast<LogLevel>(cvar.getIntValue()));
+        });
+    AsyncLog::instance().setLevel(static_cast<LogLevel>(logLevelCvar.getIntValue()));
+
+    // Register the metricsPort CVar (default: 0 = off)
+    CVarWrapper metricsPortCvar = cvarManager->registerCvar(
+        "metricsPort",
+        "0",
+        "Serve Prometheus metrics on http://127.0.0.1:<port>/metrics for load tests. 0 = off",
+        true, true, 0, true, 65535
+    );
+    metricsPortCvar.addOnValueChanged([this](std::string, CVarWrapper cvar) {
+        applyMetricsPort(cvar.getIntValue());
+        });
+    applyMetricsPort(metricsPortCvar.getIntValue());
+
+    // Mirror all settings into one snapshot and keep it current
+    publishSettings();
+    for (const char* name : { "pluginEnabled", "verificationToken", "serverEndpoints", "hotStandby", "autoJoin", "autoCreate",
+        "networkThreadAffinity", "networkThreadPriority", "helperThreadAffinity", "helperThreadPriority" }) {
+        cvarManager->getCvar(name).addOnValueChanged([this](std::string, CVarWrapper) {
+            publishSettings();
+            });
+    }
+
     // Register a notifier for joining a private lobby
     cvarManager->registerNotifier("joinprivate", [this](std::vector<std::string> params) {
-        this->JoinPrivateLobby();
-        }, "Join a private lobby with a preset name and password", PERMISSION_ALL);
+        // joinprivate <name> <password>, or no arguments to retry the last lobby
+        if (params.size() >= 3) {
+            this->JoinPrivateLobby(params[1], params[2]);
+        }
+        else {
+            this->JoinPrivateLobby();
+        }
+        }, "Join a private lobby: joinprivate <name> <password>", PERMISSION_ALL);
 
-    // Hook the game tick event to process network messages
-    gameWrapper->HookEvent("Function TAGame.GameEvent_Soccar_TA.InitGame",
-        std::bind(&SixMansPlugin::onTick, this, std::placeholders::_1));
+    // Dispatch and lobby handling run on the game thread behind the facade
+    game_ = std::make_unique<BakkesGameFacade>(gameWrapper);
+    lobby_ = std::make_unique<LobbyController>(*game_, settings_, [this]() -> NetworkManager* {
+        return networkInitialized_ ? networkManager_.get() : nullptr;
+        });
+    lobby_->setOutboundSpool(outboundSpool_);
+    lobby_->install();
+
+    // Match reports go out through the same network manager, tagged with the lobby
+    telemetry_ = std::make_unique<MatchTelemetry>(*game_,
+        [this]() -> NetworkManager* { return networkInitialized_ ? networkManager_.get() : nullptr; },
+        [this]() { return lobby_->getLobbyName(); });
+    telemetry_->setOutboundSpool(outboundSpool_);
+    telemetry_->install();
+
+    carSampler_ = std::make_unique<CarSampler>(*game_, lobby_->profiler(),
+        gameWrapper->GetDataFolder() / "sixmans" / SixMansConfig::CAR_STREAM_DIR,
+        [this]() { return lobby_->getLobbyName(); });
+    carSampler_->install();
+
+    cvarManager->registerNotifier("sixmans_profile", [this](std::vector<std::string> params) {
+        lobby_->logHookProfile();
+        if (params.size() >= 2 && params[1] == "reset") {
+            lobby_->profiler().reset();
+        }
+        }, "Log per-hook call counts and costs: sixmans_profile [reset]", PERMISSION_ALL);
 
-    // Also hook car spawn to ensure we're processing messages during gameplay
-    gameWrapper->HookEvent("Function TAGame.Car_TA.SetVehicleInput",
-        std::bind(&SixMansPlugin::onTick, this, std::placeholders::_1));
+    // Start the once-a-second telemetry sampler for the settings panel
+    std::weak_ptr<bool> alive = alive_;
+    gameWrapper->SetTimeout([this, alive](GameWrapper*) {
+        if (alive.expired()) {
+            return;
+        }
+        sampleTelemetry();
+        }, 1.0f);
 
-    // Initialize network with delay to ensure game is fully loaded
-    gameWrapper->SetTimeout([this](GameWrapper*) {
-        InitializeNetwork();
-        }, 3.0f); // Delay network initialization by 3 seconds after game loads
+    // Connect right away; the lobby controller holds messages back until the
+    // game has loaded
+    InitializeNetwork();
+}
+
+void SixMansPlugin::applyMetricsPort(int port) {
+    if (metricsServer_.isRunning() && metricsServer_.getPort() == port) {
+        return;
+    }
+    metricsServer_.stop();
+    if (port > 0) {
+        metricsServer_.start(port);
+    }
+}
+
+void SixMansPlugin::publishSettings() {
+    PluginSettings settings;
+    settings.pluginEnabled = cvarManager->getCvar("pluginEnabled").getBoolValue();
+    settings.autoJoin = cvarManager->getCvar("autoJoin").getBoolValue();
+    settings.autoCreate = cvarManager->getCvar("autoCreate").getBoolValue();
+    settings.hotStandby = cvarManager->getCvar("hotStandby").getBoolValue();
+    settings.verificationToken = cvarManager->getCvar("verificationToken").getStringValue();
+    settings.serverEndpoints = cvarManager->getCvar("serverEndpoints").getStringValue();
+    settings.networkThreadAffinity = cvarManager->getCvar("networkThreadAffinity").getStringValue();
+    settings.networkThreadPriority = cvarManager->getCvar("networkThreadPriority").getIntValue();
+    settings.helperThreadAffinity = cvarManager->getCvar("helperThreadAffinity").getStringValue();
+    settings.helperThreadPriority = cvarManager->getCvar("helperThreadPriority").getIntValue();
+    settings_->publish(std::move(settings));
+
+    if (networkManager_) {
+        networkManager_->updateSubscription();
+    }
 }
 
 void SixMansPlugin::InitializeNetwork() {
-    LOG("InitializeNetwork called! Attempting to connect to {}", SixMansConfig::buildWebSocketUrl());
+    std::shared_ptr<const PluginSettings> settings = settings_->load();
+    std::vector<std::string> endpoints = SixMansConfig::parseEndpointList(settings->serverEndpoints);
+    LOG("InitializeNetwork called! {} endpoint(s), first: {}", endpoints.size(), endpoints.front());
     if (networkInitialized_) {
         LOG("Network already initialized");
         return;
     }
+    if (networkStarting_) {
+        // Start over with the current settings once the one in flight lands
+        LOG("Network start in progress, restarting when it completes");
+        networkRestartPending_ = true;
+        return;
+    }
 
     // Get verification token
-    CVarWrapper verificationTokenCvar = cvarManager->getCvar("verificationToken");
-    std::string token = verificationTokenCvar.getStringValue();
+    const std::string& token = settings->verificationToken;
 
     if (token.empty()) {
         LOG("No verification token provided, network initialization skipped");
@@ -90,113 +266,101 @@ void SixMansPlugin::InitializeNetwork() {
     }
 
     // Create network manager
-    networkManager_ = std::make_unique<NetworkManager>();
-
-    // Build WebSocket URL
-    std::string wsUrl = SixMansConfig::buildWebSocketUrl();
-
-    // Start network manager
-    if (networkManager_->start(wsUrl, token)) {
-        networkInitialized_ = true;
-        LOG("Network initialized successfully with URL: {}", wsUrl);
-    }
-    else {
-        LOG("Failed to initialize network");
-        networkManager_.reset();
-    }
-}
-
-void SixMansPlugin::onTick(std::string eventName) {
-    // Process network messages on the game thread
-    messageDispatcher();
+    auto network = std::make_unique<NetworkManager>();
+    network->setHotStandbyEnabled(settings->hotStandby);
+    network->setThreadTuning(
+        ThreadTuning::fromSettings(settings->networkThreadAffinity, settings->networkThreadPriority),
+        ThreadTuning::fromSettings(settings->helperThreadAffinity, settings->helperThreadPriority));
+    network->setSettingsSource(settings_);
+    network->setOutboundSpool(outboundSpool_);
+    network->setResumeState(resumeState_);
+    resumeState_ = SessionResumeState();
+
+    // Start network manager. Probing can take up to ENDPOINT_PROBE_TIMEOUT_MS
+    // and none of it needs the game thread, so it runs on its own; messages
+    // that arrive before the handover wait in the manager's queue.
+    networkStarting_ = true;
+    std::weak_ptr<bool> alive = alive_;
+    networkStartThread_ = std::thread([this, alive, network = std::move(network), endpoints, token]() mutable {
+        if (network->start(endpoints, token)) {
+            LOG("Network initialized successfully with URL: {}", network->getCurrentEndpoint());
+            std::lock_guard<std::mutex> lock(networkStartMutex_);
+            startedNetwork_ = std::move(network);
+        }
+        else {
+            LOG("Failed to initialize network");
+        }
+        // Runs after onUnload if the plugin went away in the meantime
+        gameWrapper->Execute([this, alive](GameWrapper*) {
+            if (alive.expired()) {
+                return;
+            }
+            adoptStartedNetwork();
+            });
+        });
 }
 
-void SixMansPlugin::messageDispatcher() {
-    if (!networkManager_ || !networkInitialized_) {
-        return;
+void SixMansPlugin::adoptStartedNetwork() {
+    if (networkStartThread_.joinable()) {
+        networkStartThread_.join();
     }
-
-    // Process up to 5 messages per tick to avoid blocking the game thread
-    for (int i = 0; i < 5; ++i) {
-        auto messageOpt = networkManager_->getNextMessage();
-        if (!messageOpt.has_value()) {
-            break; // No more messages
-        }
-
-        try {
-            json message = messageOpt.value();
-            std::string messageStr = message.dump();
-            DEBUGLOG("Processing message on game thread: {}", messageStr);
-
-            // Call the existing handleLobbyMessage method
-            handleLobbyMessage(messageStr);
+    {
+        std::lock_guard<std::mutex> lock(networkStartMutex_);
+        if (startedNetwork_) {
+            networkManager_ = std::move(startedNetwork_);
+            networkInitialized_ = true;
         }
-        catch (const std::exception& e) {
-            LOG("Error processing message in dispatcher: {}", e.what());
+    }
+    networkStarting_ = false;
+
+    if (networkRestartPending_) {
+        networkRestartPending_ = false;
+        if (networkManager_) {
+            networkManager_->stop();
+            networkManager_.reset();
+            networkInitialized_ = false;
         }
+        InitializeNetwork();
     }
 }
 
-void SixMansPlugin::handleLobbyMessage(const std::string& message) {
-    // Log the received message
-    LOG("Processing lobby message: {}", message);
-
-    try {
-        // Parse the JSON message
-        json messageJson = json::parse(message);
-
-        // Handle different message types
-        if (messageJson.contains("type")) {
-            std::string messageType = messageJson["type"];
-
-            if (messageType == "lobby_action" && messageJson.contains("action")) {
-                std::string action = messageJson["action"];
-
-                if (action == "join") {
-                    // Check if auto-join is enabled
-                    CVarWrapper autoJoinCvar = cvarManager->getCvar("autoJoin");
-                    if (autoJoinCvar.getBoolValue()) {
-                        // Extract lobby details if they exist in the message
-                        if (messageJson.contains("lobbyName") && messageJson.contains("password")) {
-                            std::string lobbyName = messageJson["lobbyName"];
-                            std::string password = messageJson["password"];
-
-                            // Join the lobby with the provided details
-                            LOG("Auto-joining lobby: {} with password: {}", lobbyName, password);
-                            // TODO: Update JoinPrivateLobby to accept parameters
-                            JoinPrivateLobby();
-                        }
-                        else {
-                            LOG("Received join action but missing lobby details");
-                        }
-                    }
-                }
-                else if (action == "create") {
-                    // Check if auto-create is enabled
-                    CVarWrapper autoCreateCvar = cvarManager->getCvar("autoCreate");
-                    if (autoCreateCvar.getBoolValue()) {
-                        LOG("Auto-creating lobby");
-                        CreatePrivateLobby();
-                    }
-                }
-            }
-            else if (messageType == "auth_response") {
-                bool success = messageJson.value("success", false);
-                if (success) {
-                    LOG("Server authentication successful");
-                }
-                else {
-                    LOG("Server authentication failed: {}", messageJson.value("error", "Unknown error"));
-                }
-            }
+void SixMansPlugin::sampleTelemetry() {
+    if (loadToAuthMs_ < 0 && networkManager_) {
+        std::chrono::steady_clock::time_point authenticatedAt = networkManager_->getFirstAuthenticatedAt();
+        if (authenticatedAt != std::chrono::steady_clock::time_point()) {
+            loadToAuthMs_ = std::chrono::duration_cast<std::chrono::milliseconds>(authenticatedAt - loadedAt_).count();
+            LOG("Authenticated {} ms after plugin load", loadToAuthMs_);
         }
     }
-    catch (const json::exception& e) {
-        LOG("Failed to parse message as JSON: {}", e.what());
+
+    if (networkManager_) {
+        size_t received = networkManager_->getReceivedCount();
+        // A restarted NetworkManager starts counting from zero again
+        size_t delta = received >= lastReceivedCount_ ? received - lastReceivedCount_ : received;
+        lastReceivedCount_ = received;
+
+        queueDepthHistory_.push(static_cast<float>(networkManager_->getQueueSize()));
+        // Clock sync pings run on every link; endpoint probes only with more than one endpoint
+        rttHistory_.push(networkManager_->isClockSynced() ? static_cast<float>(networkManager_->getClockRttMs()) : 0.0f);
+        messageRateHistory_.push(static_cast<float>(delta));
     }
-    catch (const std::exception& e) {
-        LOG("Error processing message: {}", e.what());
+    else {
+        lastReceivedCount_ = 0;
+        queueDepthHistory_.push(0.0f);
+        rttHistory_.push(0.0f);
+        messageRateHistory_.push(0.0f);
     }
+
+    dispatchLatencyHistory_.push(static_cast<float>(lobby_->takeMeanDispatchLatencyMs()));
+
+    // SetTimeout can't be cancelled, so the next sample outlives onUnload
+    std::weak_ptr<bool> alive = alive_;
+    gameWrapper->SetTimeout([this, alive](GameWrapper*) {
+        if (alive.expired()) {
+            return;
+        }
+        sampleTelemetry();
+        }, 1.0f);
 }
 
 void SixMansPlugin::getMap() {
@@ -207,109 +371,42 @@ void SixMansPlugin::getMap() {
 }
 
 void SixMansPlugin::CreatePrivateLobby() {
-    if (!gameWrapper) {
+    if (!lobby_) {
         LOG("GameWrapper not available.");
         return;
     }
+    lobby_->requestCreate();
+}
 
-    gameWrapper->Execute([this](GameWrapper* gw) {
-        // Ensure the game is not already in an online match
-        if (!gw || gw->IsInOnlineGame()) {
-            LOG("Already in an online match, cannot create a private match.");
-            return;
-        }
-
-        // Obtain MatchmakingWrapper
-        MatchmakingWrapper matchmaking = gw->GetMatchmakingWrapper();
-        if (matchmaking.IsNull()) {
-            LOG("MatchmakingWrapper is NULL!");
-            return;
-        }
-
-        const std::vector<std::string> mapNames = {
-            "Stadium_Day_P",       // DFH Stadium (Day)
-            "Stadium_Foggy_P",     // DFH Stadium (Stormy)
-            "Stadium_P",           // DFH Stadium (Night)
-            "EuroStadium_P",       // MannField (Day)
-            "EuroStadium_Night_P", // Mannfield (Night) 
-            "EuroStadium_Rainy_P", // Mannfield (Stormy)
-            "UtopiaStadium_P",     // Utopia Coliseum (Day)
-            "UtopiaStadium_Dusk_P",// Utopia Coliseum (Dusk)
-            "cs_p",                // Champions Field (Night)
-            "cs_day_p",            // Champions Field (Day)
-            "Park_P",              // Beckwith Park (Day)
-            "Park_Night_P",        // Beckwith Park (Night)
-            "Park_Rainy_P"         // Beckwith Park (Stormy)
-        };
-
-        // Random map selection
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<size_t> distr(0, mapNames.size() - 1);
-        std::string randomMap = mapNames[distr(gen)];
-
-        LOG("Selected map: " + randomMap);
-
-        // Configure match settings
-        CustomMatchSettings matchSettings;
-        matchSettings.MapName = randomMap;
-        matchSettings.ServerName = "smtty";
-        matchSettings.Password = "secure123";
-        matchSettings.GameMode = 0;
-        matchSettings.GameTags = "BotsNone,PlayerCount3";
-
-        // Set team settings
-        matchSettings.BlueTeamSettings.Name = "Team 1";
-        matchSettings.OrangeTeamSettings.Name = "Team 2";
-
-        // Pass the region
-        Region region = Region::USE;
-
-        LOG("Creating match on USE server...");
-        matchmaking.CreatePrivateMatch(region, static_cast<int>(PlaylistIds::PrivateMatch), matchSettings);
-        });
+void SixMansPlugin::JoinPrivateLobby(const std::string& lobbyName, const std::string& password) {
+    lobby_->requestJoin(lobbyName, password);
 }
 
 void SixMansPlugin::JoinPrivateLobby() {
-    static bool joinAttemptInProgress = false;
-    if (joinAttemptInProgress) {
-        LOG("JoinPrivateLobby already in progress, ignoring duplicate call.");
-        return;
-    }
-    joinAttemptInProgress = true;
+    lobby_->requestRetryJoin();
+}
 
-    std::string lobbyName = "c1721";
-    std::string lobbyPassword = "ky1w";
 
-    gameWrapper->Execute([this, lobbyName, lobbyPassword](GameWrapper* gw) {
-        // Ensure game is not already in an online match
-        if (!gw || gw->IsInOnlineGame()) {
-            LOG("GameWrapper not available or already in an online match.");
-            joinAttemptInProgress = false;
-            return;
-        }
+void SixMansPlugin::onUnload() {
+    // Callbacks still queued on the game thread must not touch the plugin
+    alive_.reset();
+    if (lobby_) {
+        lobby_->shutdown();
+    }
 
-        // Get MatchmakingWrapper dynamically to avoid crashes
-        MatchmakingWrapper matchmaking = gw->GetMatchmakingWrapper();
-        if (!matchmaking.IsNull()) {
-            matchmaking.JoinPrivateMatch(lobbyName, lobbyPassword);
-            LOG("Attempting to join private match: {} with password: {}", lobbyName, lobbyPassword);
-        }
-        else {
-            LOG("Failed to get MatchmakingWrapper.");
-            joinAttemptInProgress = false;
-            return;
+    // A start still in flight finishes first, so its manager is stopped too
+    if (networkStartThread_.joinable()) {
+        networkStartThread_.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(networkStartMutex_);
+        if (startedNetwork_) {
+            networkManager_ = std::move(startedNetwork_);
         }
+    }
+    networkStarting_ = false;
+    networkRestartPending_ = false;
 
-        // Reset the flag after a short delay using GameWrapper context
-        gw->SetTimeout([this](GameWrapper*) {
-            joinAttemptInProgress = false;
-            }, 1.0f); // Delay in seconds
-        });
-}
-
-
-void SixMansPlugin::onUnload() {
     // Clean up network connection
     if (networkManager_) {
         networkManager_->stop();
@@ -317,5 +414,15 @@ void SixMansPlugin::onUnload() {
     }
     networkInitialized_ = false;
 
+    // Their threads log; stop them while logging still works
+    carSampler_.reset();
+    metricsServer_.stop();
+
+    // The network threads are gone, nothing can be recording any more. What's
+    // still spooled stays on disk for next time.
+    FlightRecorder::instance().close();
+    outboundSpool_->close();
+
     LOG("Plugin unloaded");
+    AsyncLog::instance().stop();
 }
\ No newline at end of file
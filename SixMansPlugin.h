@@ -7,9 +7,20 @@
 #include <nlohmann/json.hpp>
 #include <memory>
 #include <thread>
+#include <mutex>
 #include <string>
+#include <chrono>
+#include <optional>
+#include <random>
 #include "version.h"
 #include "NetworkManager.h"
+#include "BakkesGameFacade.h"
+#include "LobbyController.h"
+#include "MatchTelemetry.h"
+#include "CarSampler.h"
+#include "MetricsServer.h"
+#include "PluginSettings.h"
+#include "TelemetryHistory.h"
 
 constexpr auto plugin_version = stringify(VERSION_MAJOR) "." stringify(VERSION_MINOR) "." stringify(VERSION_PATCH) "." stringify(VERSION_BUILD);
 
@@ -17,23 +28,91 @@ class SixMansPlugin : public BakkesMod::Plugin::BakkesModPlugin, public Settings
 private:
     std::unique_ptr<NetworkManager> networkManager_;
     bool networkInitialized_ = false;
+    SessionResumeState resumeState_; // Handed from a stopped NetworkManager to the next one
+    std::shared_ptr<OutboundSpool> outboundSpool_ = std::make_shared<OutboundSpool>(); // Reports waiting for a link
 
-    // Message processing on game thread
-    void messageDispatcher();
-    void handleLobbyMessage(const std::string& message);
+    // InitializeNetwork probes and connects on a thread of its own; the game
+    // thread takes the manager over once it's running
+    std::thread networkStartThread_;
+    std::mutex networkStartMutex_;
+    std::unique_ptr<NetworkManager> startedNetwork_; // Guarded by networkStartMutex_
+    bool networkStarting_ = false;
+    bool networkRestartPending_ = false;    // Settings changed while starting
+    void adoptStartedNetwork();
+
+    // Held only by the plugin; work queued onto the game thread from other
+    // threads checks it through a weak_ptr, since it may run after onUnload
+    std::shared_ptr<bool> alive_ = std::make_shared<bool>(true);
+
+    // Startup cost: plugin load to the first accepted auth, -1 until then
+    std::chrono::steady_clock::time_point loadedAt_;
+    long long loadToAuthMs_ = -1;
+
+    // Cvar values, republished whenever one of them changes
+    std::shared_ptr<SettingsSnapshot> settings_ = std::make_shared<SettingsSnapshot>();
+    void publishSettings();
+
+    // Retained copy of everything the settings panel shows (render thread only).
+    // Refreshed when the settings or network state version changes, so a normal
+    // frame does no allocations, cvar lookups or locks.
+    struct PanelState {
+        unsigned settingsVersion = ~0u;
+        PluginSettings settings;
+        char tokenBuffer[128] = {};
+        std::string endpointsBuffer;
+        std::string networkAffinityBuffer;
+        std::string helperAffinityBuffer;
+
+        const NetworkManager* network = nullptr;
+        unsigned networkVersion = ~0u;
+        std::string endpoint;
+
+        // Live queue, re-flattened only when a new state is published
+        std::shared_ptr<const LiveQueueState> queueState;
+        std::string queueStatus;
+        std::string queuePlayers;
+        std::string blueTeam;
+        std::string orangeTeam;
+        size_t queuePlayerCount = 0;
+    };
+    PanelState panel_;
+    void refreshPanelState();
+
+    // One-second telemetry samples for the settings panel plots
+    static constexpr size_t TELEMETRY_SAMPLES = 120;
+    TelemetryHistory<TELEMETRY_SAMPLES> queueDepthHistory_;
+    TelemetryHistory<TELEMETRY_SAMPLES> rttHistory_;
+    TelemetryHistory<TELEMETRY_SAMPLES> messageRateHistory_;
+    TelemetryHistory<TELEMETRY_SAMPLES> dispatchLatencyHistory_;
+    size_t lastReceivedCount_ = 0;
+    void sampleTelemetry();
+    void renderTelemetry();
+    void renderLiveQueue();
+
+    // Message dispatch, lobby creation and joining, behind the game facade
+    std::unique_ptr<BakkesGameFacade> game_;
+    std::unique_ptr<LobbyController> lobby_;
+
+    // Match results and stats for the server, reported at match end
+    std::unique_ptr<MatchTelemetry> telemetry_;
+
+    // Car positions through each 6mans match, kept on disk for review
+    std::unique_ptr<CarSampler> carSampler_;
+
+    // Opt-in Prometheus endpoint on localhost (metricsPort cvar)
+    MetricsServer metricsServer_;
+    void applyMetricsPort(int port);
 
 public:
     void onLoad();
     void onUnload();
     void CreatePrivateLobby();
     void getMap();
-    void JoinPrivateLobby();
+    void JoinPrivateLobby(const std::string& lobbyName, const std::string& password);
+    void JoinPrivateLobby(); // Retry the last lobby the server sent
     void InitializeNetwork();
     void VerifyToken(const std::string& token);
     void RenderSettings() override;
-
-    // Game tick handler for processing network messages
-    void onTick(std::string eventName);
 };
 
 using json = nlohmann::json;
\ No newline at end of file
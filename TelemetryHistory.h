@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Fixed-size history of one metric for ImGui::PlotLines.
+//
+// Written by the game thread (one sample per second), read by the render thread
+// through plotGetter. Storage is preallocated and every slot is an atomic, so
+// neither side allocates or locks.
+template<size_t N>
+class TelemetryHistory {
+public:
+    TelemetryHistory() {
+        for (auto& value : values_) {
+            value.store(0.0f, std::memory_order_relaxed);
+        }
+    }
+
+    // Non-copyable
+    TelemetryHistory(const TelemetryHistory&) = delete;
+    TelemetryHistory& operator=(const TelemetryHistory&) = delete;
+
+    void push(float value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        values_[head % N].store(value, std::memory_order_relaxed);
+        head_.store(head + 1, std::memory_order_release);
+        latest_.store(value, std::memory_order_relaxed);
+    }
+
+    float latest() const {
+        return latest_.load(std::memory_order_relaxed);
+    }
+
+    // Largest value currently in the window, for scaling the plot
+    float max() const {
+        float result = 0.0f;
+        for (const auto& value : values_) {
+            float v = value.load(std::memory_order_relaxed);
+            result = v > result ? v : result;
+        }
+        return result;
+    }
+
+    static constexpr int size() {
+        return static_cast<int>(N);
+    }
+
+    // ImGui::PlotLines getter; index 0 is the oldest sample
+    static float plotGetter(void* data, int index) {
+        const TelemetryHistory* history = static_cast<const TelemetryHistory*>(data);
+        size_t head = history->head_.load(std::memory_order_acquire);
+        return history->values_[(head + static_cast<size_t>(index)) % N].load(std::memory_order_relaxed);
+    }
+
+private:
+    std::array<std::atomic<float>, N> values_;
+    std::atomic<size_t> head_{ 0 };
+    std::atomic<float> latest_{ 0.0f };
+};
@@ -4,6 +4,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <optional>
+#include <atomic>
 
 template<typename T>
 class ThreadSafeQueue {
@@ -12,6 +13,7 @@ private:
     std::queue<T> queue_;
     std::condition_variable condition_;
     size_t max_size_;
+    std::atomic<size_t> count_{ 0 }; // Mirrors queue_.size() for lock-free polling
 
 public:
     explicit ThreadSafeQueue(size_t max_size = 100) : max_size_(max_size) {}
@@ -28,6 +30,7 @@ public:
             return false; // Queue is full
         }
         queue_.push(item);
+        count_.store(queue_.size(), std::memory_order_release);
         condition_.notify_one();
         return true;
     }
@@ -39,6 +42,7 @@ public:
             return false; // Queue is full
         }
         queue_.push(std::move(item));
+        count_.store(queue_.size(), std::memory_order_release);
         condition_.notify_one();
         return true;
     }
@@ -46,12 +50,18 @@ public:
     // Pop an item from the queue (non-blocking)
     // Returns std::nullopt if queue is empty
     std::optional<T> tryPop() {
+        // Fast path: an empty poll is a single atomic load, no lock
+        if (count_.load(std::memory_order_acquire) == 0) {
+            return std::nullopt;
+        }
+
         std::lock_guard<std::mutex> lock(mutex_);
         if (queue_.empty()) {
             return std::nullopt;
         }
         T result = std::move(queue_.front());
         queue_.pop();
+        count_.store(queue_.size(), std::memory_order_release);
         return result;
     }
 
@@ -65,9 +75,15 @@ public:
         }
         T result = std::move(queue_.front());
         queue_.pop();
+        count_.store(queue_.size(), std::memory_order_release);
         return result;
     }
 
+    // Lock-free snapshot of the size; may be stale by the time it's used
+    size_t approxSize() const {
+        return count_.load(std::memory_order_acquire);
+    }
+
     // Check if queue is empty
     bool empty() const {
         std::lock_guard<std::mutex> lock(mutex_);
@@ -85,5 +101,6 @@ public:
         std::lock_guard<std::mutex> lock(mutex_);
         std::queue<T> empty;
         queue_.swap(empty);
+        count_.store(0, std::memory_order_release);
     }
 };
\ No newline at end of file
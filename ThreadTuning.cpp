@@ -0,0 +1,123 @@
+#include "pch.h"
+#include "ThreadTuning.h"
+#include "logging.h"
+#include <algorithm>
+#include <cctype>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <cerrno>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+bool ThreadTuning::applyToCurrentThread(const char* threadName) const {
+    bool ok = true;
+
+#ifdef _WIN32
+    if (affinityMask != 0
+        && SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(affinityMask)) == 0) {
+        LOG("Could not set {} thread affinity to 0x{:x} (error {})", threadName, affinityMask, GetLastError());
+        ok = false;
+    }
+    // THREAD_PRIORITY_LOWEST .. THREAD_PRIORITY_HIGHEST are -2 .. 2
+    if (priority != 0 && !SetThreadPriority(GetCurrentThread(), priority)) {
+        LOG("Could not set {} thread priority to {} (error {})", threadName, priority, GetLastError());
+        ok = false;
+    }
+#else
+    if (affinityMask != 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu = 0; cpu < 64; ++cpu) {
+            if (affinityMask & (uint64_t{ 1 } << cpu)) {
+                CPU_SET(cpu, &set);
+            }
+        }
+        int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (error != 0) {
+            LOG("Could not set {} thread affinity to 0x{:x} (error {})", threadName, affinityMask, error);
+            ok = false;
+        }
+    }
+    // Under the default scheduler niceness is per thread (per tid)
+    if (priority != 0) {
+        int niceness = -5 * priority;
+        if (setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), niceness) != 0) {
+            LOG("Could not set {} thread niceness to {} (errno {})", threadName, niceness, errno);
+            ok = false;
+        }
+    }
+#endif
+
+    if (ok && !isDefault()) {
+        LOG("{} thread: affinity 0x{:x}, priority {}", threadName, affinityMask, priority);
+    }
+    return ok;
+}
+
+ThreadTuning ThreadTuning::fromSettings(const std::string& affinity, int priority) {
+    ThreadTuning tuning;
+    tuning.priority = std::clamp(priority, -2, 2);
+    if (std::optional<uint64_t> mask = parseAffinity(affinity)) {
+        tuning.affinityMask = *mask;
+    }
+    else {
+        LOG("Ignoring malformed thread affinity '{}'", affinity);
+    }
+    return tuning;
+}
+
+std::optional<uint64_t> ThreadTuning::parseAffinity(const std::string& text) {
+    std::string spec;
+    for (char c : text) {
+        if (!std::isspace(static_cast<unsigned char>(c))) {
+            spec += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+    }
+    if (spec.empty() || spec == "all") {
+        return uint64_t{ 0 };
+    }
+
+    if (spec.rfind("0x", 0) == 0) {
+        if (spec.size() == 2 || spec.size() > 18
+            || !std::all_of(spec.begin() + 2, spec.end(), [](char c) { return std::isxdigit(static_cast<unsigned char>(c)); })) {
+            return std::nullopt;
+        }
+        return std::stoull(spec.substr(2), nullptr, 16);
+    }
+
+    // Comma-separated CPUs and inclusive ranges
+    uint64_t mask = 0;
+    size_t pos = 0;
+    while (pos <= spec.size()) {
+        size_t end = spec.find(',', pos);
+        std::string item = spec.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+        size_t dash = item.find('-');
+        std::string first = item.substr(0, dash);
+        std::string last = dash == std::string::npos ? first : item.substr(dash + 1);
+        auto isNumber = [](const std::string& s) {
+            return !s.empty() && s.size() <= 2 && std::all_of(s.begin(), s.end(), [](char c) { return c >= '0' && c <= '9'; });
+        };
+        if (!isNumber(first) || !isNumber(last)) {
+            return std::nullopt;
+        }
+        int low = std::stoi(first);
+        int high = std::stoi(last);
+        if (low > high || high >= 64) {
+            return std::nullopt;
+        }
+        for (int cpu = low; cpu <= high; ++cpu) {
+            mask |= uint64_t{ 1 } << cpu;
+        }
+        if (end == std::string::npos) {
+            break;
+        }
+        pos = end + 1;
+    }
+    return mask;
+}
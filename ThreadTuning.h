@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// Where and how eagerly one of the plugin's own threads runs, so the network
+// and housekeeping threads can be kept off the cores the game renders and
+// simulates on. Applied by the thread itself when it starts (or, for the log
+// drain, on its next pass), so nobody needs another thread's native handle.
+struct ThreadTuning {
+    uint64_t affinityMask = 0;  // Bit n = logical CPU n; 0 leaves placement to the OS
+    int priority = 0;           // -2 (lowest) .. 2 (highest); 0 leaves it alone
+
+    bool isDefault() const { return affinityMask == 0 && priority == 0; }
+
+    bool operator==(const ThreadTuning& other) const {
+        return affinityMask == other.affinityMask && priority == other.priority;
+    }
+
+    // Apply to the calling thread. Priorities map to the Windows thread
+    // priority levels of the same number, and on Linux to a niceness of
+    // -5 * priority for that thread alone. Logs and returns false if the OS
+    // refuses, e.g. no usable CPU in the mask or raising priority unprivileged.
+    bool applyToCurrentThread(const char* threadName) const;
+
+    // From the cvar forms: affinity "" or "all" (any CPU), "0x0c" (a hex mask)
+    // or "2,3" / "2-3" (CPU lists); priority is clamped to -2..2. A malformed
+    // affinity is logged and ignored.
+    static ThreadTuning fromSettings(const std::string& affinity, int priority);
+    static std::optional<uint64_t> parseAffinity(const std::string& text);
+};
@@ -1,6 +1,9 @@
 #include "pch.h"
 #include "WebSocketClient.h"
 #include "logging.h"
+#include "AsyncLog.h"
+#include "FlightRecorder.h"
+#include "Metrics.h"
 #include "Config.h"
 #include <regex>
 #include <mutex>
@@ -8,11 +11,13 @@
 #include <atomic>
 #include <optional>
 #include <chrono>
+#include <cstring>
 
 
 WebSocketClient::WebSocketClient()
     : running_(false), connected_(false), context_(nullptr), websocket_(nullptr),
-    serverPort_(443), useSSL_(false), writePending_(false) { //use ssl later
+    serverPort_(443), useSSL_(false), endpointIndex_(0), consecutiveFailures_(0),
+    brokerGeneration_(0), writePending_(false), everConnected_(false) { //use ssl later
 
     // Initialize protocols array
     protocols_[0] = {
@@ -30,6 +35,12 @@ WebSocketClient::~WebSocketClient() {
 }
 
 bool WebSocketClient::start(const std::string& url, const std::string& token,
+    MessageCallback messageCallback,
+    ConnectionCallback connectionCallback) {
+    return start(std::vector<std::string>{ url }, token, messageCallback, connectionCallback);
+}
+
+bool WebSocketClient::start(const std::vector<std::string>& urls, const std::string& token,
     MessageCallback messageCallback,
     ConnectionCallback connectionCallback) {
     if (running_.load()) {
@@ -37,11 +48,41 @@ bool WebSocketClient::start(const std::string& url, const std::string& token,
         return false;
     }
 
-    if (!parseUrl(url, serverHost_, serverPort_, serverPath_, useSSL_)) {
-        LOG("Failed to parse WebSocket URL: {}", url);
+    // Validate every endpoint up front so failover never trips over a typo
+    std::vector<std::string> validUrls;
+    brokerPath_.clear();
+    for (const auto& url : urls) {
+        if (BrokerProtocol::isBrokerUrl(url)) {
+            // The broker does the connecting and failover, so it stands alone
+            brokerPath_ = url.substr(std::strlen(BrokerProtocol::URL_PREFIX));
+            validUrls = { url };
+            break;
+        }
+
+        std::string host, path;
+        int port = 443;
+        bool ssl = false;
+        if (!parseUrl(url, host, port, path, ssl)) {
+            LOG("Failed to parse WebSocket URL: {}", url);
+            continue;
+        }
+        useSSL_ = useSSL_ || ssl; // The context needs global SSL init if any endpoint uses it
+        validUrls.push_back(url);
+    }
+
+    if (validUrls.empty()) {
+        LOG("No usable WebSocket endpoints");
         return false;
     }
 
+    {
+        std::lock_guard<std::mutex> lock(endpointMutex_);
+        endpoints_ = validUrls;
+        endpointIndex_ = 0;
+        consecutiveFailures_ = 0;
+        currentEndpoint_ = endpoints_.front();
+    }
+
     // Create connection data
     connectionData_ = std::make_unique<ConnectionData>();
     connectionData_->client = this;
@@ -54,12 +95,68 @@ bool WebSocketClient::start(const std::string& url, const std::string& token,
     running_.store(true);
 
     // Start the event loop thread
-    eventThread_ = std::make_unique<std::thread>(&WebSocketClient::runEventLoop, this);
+    eventThread_ = std::make_unique<std::thread>(
+        brokerPath_.empty() ? &WebSocketClient::runEventLoop : &WebSocketClient::runBrokerLoop, this);
+
+    LOG("WebSocket client started with {} endpoint(s), primary: {}", validUrls.size(), validUrls.front());
+    return true;
+}
+
+void WebSocketClient::setEndpoints(const std::vector<std::string>& urls) {
+    if (urls.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(endpointMutex_);
+    endpoints_ = urls;
+    endpointIndex_ = 0;
+    consecutiveFailures_ = 0;
+}
+
+void WebSocketClient::setThreadTuning(const ThreadTuning& tuning) {
+    threadTuning_ = tuning;
+}
+
+void WebSocketClient::setHandshakeHeaderProvider(HandshakeHeaderProvider provider) {
+    handshakeHeaderProvider_ = std::move(provider);
+}
 
-    LOG("WebSocket client started for URL: {}", url);
+std::string WebSocketClient::getCurrentEndpoint() const {
+    std::lock_guard<std::mutex> lock(endpointMutex_);
+    return currentEndpoint_;
+}
+
+bool WebSocketClient::selectEndpoint() {
+    std::string url;
+    {
+        std::lock_guard<std::mutex> lock(endpointMutex_);
+        if (endpoints_.empty()) {
+            return false;
+        }
+        endpointIndex_ %= endpoints_.size();
+        url = endpoints_[endpointIndex_];
+        currentEndpoint_ = url;
+    }
+
+    bool ssl = false;
+    if (!parseUrl(url, serverHost_, serverPort_, serverPath_, ssl)) {
+        return false;
+    }
+    useSSL_ = ssl;
     return true;
 }
 
+void WebSocketClient::recordConnectFailure() {
+    std::lock_guard<std::mutex> lock(endpointMutex_);
+    if (++consecutiveFailures_ < SixMansConfig::MAX_CONNECT_FAILURES_BEFORE_FAILOVER || endpoints_.size() < 2) {
+        return;
+    }
+
+    consecutiveFailures_ = 0;
+    endpointIndex_ = (endpointIndex_ + 1) % endpoints_.size();
+    LOG("Failing over to endpoint {}", endpoints_[endpointIndex_]);
+}
+
 void WebSocketClient::stop() {
     if (!running_.load()) {
         return;
@@ -97,17 +194,40 @@ void WebSocketClient::stop() {
 
 bool WebSocketClient::sendMessage(const json& message) {
     if (!connected_.load()) {
-        LOG("Cannot send message: WebSocket not connected");
+        ASYNC_LOG(LogLevel::Warn, "Cannot send message: WebSocket not connected");
         return false;
     }
+    return sendText(message.dump());
+}
 
-    std::lock_guard<std::mutex> lock(writeMutex_);
-    pendingWrite_ = message.dump();
-    writePending_ = true;
+bool WebSocketClient::sendText(std::string payload) {
+    if (!connected_.load()) {
+        ASYNC_LOG(LogLevel::Warn, "Cannot send message: WebSocket not connected");
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        if (pendingWrites_.size() >= static_cast<size_t>(SixMansConfig::MAX_QUEUE_SIZE)) {
+            ASYNC_LOG(LogLevel::Warn, "Outbound WebSocket queue full, dropping message");
+            return false;
+        }
+        pendingWrites_.push_back(std::move(payload));
+        writePending_.store(true);
+
+        // The event loop moves it into the broker's ring; ringing the broker's
+        // doorbell can stall, which the game thread mustn't
+        if (!brokerPath_.empty()) {
+            if (broker_) {
+                broker_->wake();
+            }
+            return true;
+        }
+    }
 
-    // Wake up the event loop
+    // Wake up the event loop. lws_callback_on_writable is not safe to call from
+    // this thread, so the service thread requests it in EVENT_WAIT_CANCELLED.
     if (context_) {
-        lws_callback_on_writable(websocket_);
         lws_cancel_service(context_);
     }
 
@@ -119,12 +239,15 @@ bool WebSocketClient::isConnected() const {
 }
 
 void WebSocketClient::runEventLoop() {
+    threadTuning_.applyToCurrentThread("network");
+
     // The lws_context should be created only once.
     struct lws_context_creation_info info = {};
     info.port = CONTEXT_PORT_NO_LISTEN;
     info.protocols = protocols_;
     info.gid = -1;
     info.uid = -1;
+    info.user = this; // Lets EVENT_WAIT_CANCELLED find its way back to us
     if (useSSL_) {
         info.options = LWS_SERVER_OPTION_DO_SSL_GLOBAL_INIT;
     }
@@ -137,9 +260,14 @@ void WebSocketClient::runEventLoop() {
 
     // This is the main service loop. It will run as long as the client is running.
     while (running_.load()) {
-        // If we are not connected and not trying to reconnect, start a connection attempt.
-        if (!connected_.load() && !connectionData_->shouldReconnect.load()) {
-            connectionData_->shouldReconnect.store(true); // Mark that we are attempting a connect/reconnect
+        // If we are not connected and a (re)connect has been requested, start a connection attempt.
+        if (!connected_.load() && connectionData_->shouldReconnect.load()) {
+            connectionData_->shouldReconnect.store(false); // Attempt in flight, the callbacks re-arm this on failure
+
+            if (!selectEndpoint()) {
+                LOG("No valid WebSocket endpoint to connect to");
+                break;
+            }
 
             struct lws_client_connect_info connectInfo = {};
             connectInfo.context = context_;
@@ -149,15 +277,18 @@ void WebSocketClient::runEventLoop() {
             connectInfo.host = serverHost_.c_str();
             connectInfo.origin = serverHost_.c_str();
             connectInfo.protocol = protocols_[0].name;
-            connectInfo.userdata = connectionData_.get();
+            connectInfo.opaque_user_data = connectionData_.get(); // Read back with lws_get_opaque_user_data
             if (useSSL_) {
                 connectInfo.ssl_connection = LCCSCF_USE_SSL;
             }
 
-            LOG("Attempting to connect to {}:{}{}", serverHost_, serverPort_, serverPath_);
+            ASYNC_LOG(LogLevel::Info, "Attempting to connect to {}:{}{}", serverHost_, serverPort_, serverPath_);
             websocket_ = lws_client_connect_via_info(&connectInfo);
             if (!websocket_) {
-                LOG("Failed to start WebSocket connection attempt. Retrying in {}ms", SixMansConfig::RECONNECT_DELAY_MS);
+                ASYNC_LOG(LogLevel::Warn, "Failed to start WebSocket connection attempt. Retrying in {}ms", SixMansConfig::RECONNECT_DELAY_MS);
+                Metrics::instance().connectFailures.add();
+                recordConnectFailure();
+                connectionData_->shouldReconnect.store(true);
                 std::this_thread::sleep_for(std::chrono::milliseconds(SixMansConfig::RECONNECT_DELAY_MS));
                 continue; // Loop again to retry
             }
@@ -178,6 +309,143 @@ void WebSocketClient::runEventLoop() {
     context_ = nullptr;
 }
 
+void WebSocketClient::runBrokerLoop() {
+    threadTuning_.applyToCurrentThread("network");
+
+    while (running_.load()) {
+        if (!broker_) {
+            auto link = std::make_unique<BrokerLink>();
+            ASYNC_LOG(LogLevel::Info, "Attaching to the connection broker at {}", brokerPath_);
+            if (!link->attach(brokerPath_, connectionData_->token, SixMansConfig::BROKER_ATTACH_TIMEOUT_MS)) {
+                ASYNC_LOG(LogLevel::Warn, "Could not attach to the connection broker. Retrying in {}ms", SixMansConfig::RECONNECT_DELAY_MS);
+                std::this_thread::sleep_for(std::chrono::milliseconds(SixMansConfig::RECONNECT_DELAY_MS));
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(writeMutex_);
+            broker_ = std::move(link);
+        }
+
+        // Same 50ms cadence as lws_service, so stop() is noticed as quickly
+        bool attached = broker_->poll(50);
+        broker_->drain([this](BrokerProtocol::Record record, std::string_view payload) {
+            onBrokerRecord(record, payload);
+            });
+
+        if (writePending_.load()) {
+            std::lock_guard<std::mutex> lock(writeMutex_);
+            flushBrokerWrites();
+        }
+
+        if (!attached) {
+            LOG("Connection broker went away");
+            setBrokerConnected(false);
+            {
+                std::lock_guard<std::mutex> lock(writeMutex_);
+                broker_.reset();
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(SixMansConfig::RECONNECT_DELAY_MS));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    broker_.reset();
+}
+
+void WebSocketClient::onBrokerRecord(BrokerProtocol::Record record, std::string_view payload) {
+    switch (record) {
+    case BrokerProtocol::Up: {
+        // The broker's equivalent of the upgrade request: this connect's
+        // headers go with a new generation, which retires anything queued
+        // for the last connection
+        setBrokerConnected(false); // In case the broker's Down went missing
+        WebSocketClient::HandshakeHeaders headers;
+        if (handshakeHeaderProvider_) {
+            headers = handshakeHeaderProvider_();
+        }
+        uint32_t generation;
+        {
+            std::lock_guard<std::mutex> lock(writeMutex_);
+            generation = ++brokerGeneration_;
+            pendingWrites_.clear();
+            writePending_.store(false);
+        }
+        broker_->sendHello(generation, static_cast<uint32_t>(std::strtoul(std::string(payload).c_str(), nullptr, 10)), headers);
+        setBrokerConnected(true);
+        break;
+    }
+
+    case BrokerProtocol::Down:
+        setBrokerConnected(false);
+        break;
+
+    case BrokerProtocol::Message:
+        FlightRecorder::instance().record(FlightRecorder::Direction::Inbound, connectionData_->epoch,
+            payload.data(), payload.size(), FlightRecorderFormat::FLAG_FINAL_FRAGMENT);
+        Metrics::instance().framesReceived.add();
+        Metrics::instance().bytesReceived.add(payload.size());
+        try {
+            json message = connectionData_->parser.parse(payload);
+            if (connectionData_->messageCallback) {
+                connectionData_->messageCallback(message);
+            }
+        }
+        catch (const json::exception& e) {
+            Metrics::instance().parseErrors.add();
+            ASYNC_LOG(LogLevel::Warn, "Failed to handle JSON message: {}", e.what());
+        }
+        break;
+    }
+}
+
+void WebSocketClient::setBrokerConnected(bool connected) {
+    if (connected_.exchange(connected) == connected) {
+        return;
+    }
+
+    if (connected) {
+        LOG("Connected through the connection broker");
+        if (everConnected_) {
+            Metrics::instance().reconnects.add();
+        }
+        everConnected_ = true;
+        connectionData_->epoch = FlightRecorder::instance().nextEpoch();
+        FlightRecorder::instance().record(FlightRecorder::Direction::Connected, connectionData_->epoch,
+            getCurrentEndpoint());
+    }
+    else {
+        FlightRecorder::instance().record(FlightRecorder::Direction::Disconnected, connectionData_->epoch,
+            std::string("broker upstream lost"));
+    }
+    if (connectionData_->connectionCallback) {
+        connectionData_->connectionCallback(connected);
+    }
+}
+
+void WebSocketClient::dropPendingWrites() {
+    // Acks, pongs, request ids and role announcements only mean something on
+    // the connection they were queued for; NetworkManager sends fresh ones
+    // when the next one comes up
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    if (!pendingWrites_.empty()) {
+        ASYNC_LOG(LogLevel::Debug, "Dropping {} frame(s) queued for the closed connection", pendingWrites_.size());
+    }
+    pendingWrites_.clear();
+    writePending_.store(false);
+}
+
+// Event thread; caller holds writeMutex_
+void WebSocketClient::flushBrokerWrites() {
+    while (broker_ && !pendingWrites_.empty()) {
+        if (!broker_->push(brokerGeneration_, pendingWrites_.front())) {
+            break; // Ring full
+        }
+        FlightRecorder::instance().record(FlightRecorder::Direction::Outbound, connectionData_->epoch, pendingWrites_.front());
+        Metrics::instance().framesSent.add();
+        Metrics::instance().bytesSent.add(pendingWrites_.front().size());
+        pendingWrites_.pop_front();
+    }
+    writePending_.store(!pendingWrites_.empty());
+}
 
 bool WebSocketClient::parseUrl(const std::string& url, std::string& host, int& port,
     std::string& path, bool& useSSL) {
@@ -218,7 +486,8 @@ void WebSocketClient::handleMessage(const std::string& message) {
         }
     }
     catch (const json::exception& e) {
-        LOG("Failed to parse JSON message: {}", e.what());
+        Metrics::instance().parseErrors.add();
+        ASYNC_LOG(LogLevel::Warn, "Failed to parse JSON message: {}", e.what());
     }
 }
 
@@ -240,79 +509,130 @@ int WebSocketClient::websocketCallback(struct lws* wsi, enum lws_callback_reason
             LOG("WebSocket connection established");
             client->connected_.store(true);
             client->websocket_ = wsi; // Store the websocket instance
-
-            // Copy the pointer into the session-specific user data for future callbacks
-            *(static_cast<ConnectionData**>(user)) = connectionData;
+            if (client->everConnected_) {
+                Metrics::instance().reconnects.add();
+            }
+            client->everConnected_ = true;
+            {
+                std::lock_guard<std::mutex> lock(client->endpointMutex_);
+                client->consecutiveFailures_ = 0;
+            }
+            connectionData->rxBuffer.clear(); // Drop any partial frame from the previous connection
+            connectionData->inboundRedaction = FlightRecorder::Redaction();
+            client->dropPendingWrites(); // Anything that raced the last close
+            connectionData->epoch = FlightRecorder::instance().nextEpoch();
+            FlightRecorder::instance().record(FlightRecorder::Direction::Connected, connectionData->epoch,
+                client->getCurrentEndpoint());
 
             // CORRECTED: Access callback through connectionData
             if (connectionData->connectionCallback) {
                 connectionData->connectionCallback(true);
             }
 
-            // Immediately request a write callback to send the auth token
+            // Flush whatever the connection callback queued (auth, subscription)
             lws_callback_on_writable(wsi);
         }
         break;
 
+    case LWS_CALLBACK_CLIENT_APPEND_HANDSHAKE_HEADER:
+        if (client && client->handshakeHeaderProvider_) {
+            // in points at the write cursor of the upgrade request, len is the room left
+            unsigned char** cursor = static_cast<unsigned char**>(in);
+            unsigned char* end = *cursor + len;
+            for (const auto& [name, value] : client->handshakeHeaderProvider_()) {
+                std::string field = name + ":";
+                if (lws_add_http_header_by_name(wsi, reinterpret_cast<const unsigned char*>(field.c_str()),
+                    reinterpret_cast<const unsigned char*>(value.data()), static_cast<int>(value.size()), cursor, end)) {
+                    LOG("No room for the {} handshake header", name);
+                    return -1;
+                }
+            }
+        }
+        break;
+
     case LWS_CALLBACK_CLIENT_RECEIVE:
         if (client && connectionData && in && len > 0) {
             // Use the callback stored in connectionData
             if (connectionData->messageCallback) {
+                const char* data = static_cast<const char*>(in);
+                bool isFinal = lws_is_final_fragment(wsi) && lws_remaining_packet_payload(wsi) == 0;
+                FlightRecorder::instance().record(FlightRecorder::Direction::Inbound, connectionData->epoch, data, len,
+                    isFinal ? FlightRecorderFormat::FLAG_FINAL_FRAGMENT : 0, &connectionData->inboundRedaction);
+                Metrics::instance().bytesReceived.add(len);
+
+                // Large state payloads arrive in rx_buffer_size chunks. Unfragmented
+                // frames are parsed straight from the lws buffer; only split ones
+                // are copied into the reassembly buffer.
+                if (!isFinal || !connectionData->rxBuffer.empty()) {
+                    connectionData->rxBuffer.append(data, len);
+                    if (!isFinal) {
+                        break;
+                    }
+                    data = connectionData->rxBuffer.data();
+                    len = connectionData->rxBuffer.size();
+                }
+
+                Metrics::instance().framesReceived.add();
                 try {
-                    json received_json = json::parse(static_cast<const char*>(in), static_cast<const char*>(in) + len);
+                    json received_json = connectionData->parser.parse(data, len);
                     connectionData->messageCallback(received_json);
                 }
-                catch (const json::parse_error& e) {
-                    LOG("JSON parse error: {}", e.what());
+                catch (const json::exception& e) {
+                    // Handlers run inline on the lws thread; nothing above us catches
+                    Metrics::instance().parseErrors.add();
+                    ASYNC_LOG(LogLevel::Warn, "Failed to handle JSON message: {}", e.what());
                 }
+                connectionData->rxBuffer.clear();
             }
         }
         break;
 
     case LWS_CALLBACK_CLIENT_WRITEABLE:
         if (client && connectionData) {
-            // Priority 1: Send the initial auth token message from the buffer
-            if (!connectionData->writeBuffer.empty()) {
-                size_t msgLen = connectionData->writeBuffer.length();
-                // LWS_PRE is padding libwebsockets needs before your data
-                unsigned char* buffer = new unsigned char[LWS_PRE + msgLen];
-                memcpy(buffer + LWS_PRE, connectionData->writeBuffer.c_str(), msgLen);
-                int result = lws_write(wsi, buffer + LWS_PRE, msgLen, LWS_WRITE_TEXT);
-                delete[] buffer;
-
-                if (result < 0) {
-                    LOG("Failed to send authentication message");
-                    return -1;
-                }
-                connectionData->writeBuffer.clear();
-            }
-            // Priority 2: Send any pending message from the sendMessage function
-            else if (client->writePending_) {
+            // Send the oldest pending message from sendMessage. Auth goes in
+            // the upgrade request, or through sendMessage like everything else.
+            if (client->writePending_.load()) {
                 std::lock_guard<std::mutex> lock(client->writeMutex_);
-                size_t msgLen = client->pendingWrite_.length();
-                unsigned char* buffer = new unsigned char[LWS_PRE + msgLen];
-                memcpy(buffer + LWS_PRE, client->pendingWrite_.c_str(), msgLen);
-                int result = lws_write(wsi, buffer + LWS_PRE, msgLen, LWS_WRITE_TEXT);
-                delete[] buffer;
-
-                if (result < 0) {
-                    LOG("Failed to send WebSocket message");
-                    return -1;
+                if (!client->pendingWrites_.empty()) {
+                    const std::string& pending = client->pendingWrites_.front();
+                    size_t msgLen = pending.length();
+                    unsigned char* buffer = new unsigned char[LWS_PRE + msgLen];
+                    memcpy(buffer + LWS_PRE, pending.c_str(), msgLen);
+                    int result = lws_write(wsi, buffer + LWS_PRE, msgLen, LWS_WRITE_TEXT);
+                    delete[] buffer;
+
+                    if (result < 0) {
+                        ASYNC_LOG(LogLevel::Error, "Failed to send WebSocket message");
+                        return -1;
+                    }
+                    FlightRecorder::instance().record(FlightRecorder::Direction::Outbound, connectionData->epoch, pending);
+                    Metrics::instance().framesSent.add();
+                    Metrics::instance().bytesSent.add(msgLen);
+                    client->pendingWrites_.pop_front();
                 }
-                client->pendingWrite_.clear();
-                client->writePending_ = false;
+                client->writePending_.store(!client->pendingWrites_.empty());
+            }
+
+            // One frame per callback; ask for another if more are waiting
+            if (client->writePending_.load()) {
+                lws_callback_on_writable(wsi);
             }
         }
         break;
 
     case LWS_CALLBACK_CLIENT_CONNECTION_ERROR:
-        LOG("WebSocket connection error: {}", in ? std::string(static_cast<const char*>(in), len) : "Unknown error");
+        ASYNC_LOG(LogLevel::Warn, "WebSocket connection error: {}", in ? std::string(static_cast<const char*>(in), len) : "Unknown error");
+        Metrics::instance().connectFailures.add();
         if (client && connectionData) {
             client->connected_.store(false);
+            client->dropPendingWrites();
+            FlightRecorder::instance().record(FlightRecorder::Direction::Disconnected, connectionData->epoch,
+                in ? std::string(static_cast<const char*>(in), len) : std::string("connection error"));
             // CORRECTED: Access callback through connectionData
             if (connectionData->connectionCallback) {
                 connectionData->connectionCallback(false);
             }
+            client->recordConnectFailure();
             client->scheduleReconnect();
         }
         break;
@@ -321,6 +641,9 @@ int WebSocketClient::websocketCallback(struct lws* wsi, enum lws_callback_reason
         LOG("WebSocket connection closed");
         if (client && connectionData) {
             client->connected_.store(false);
+            client->dropPendingWrites();
+            FlightRecorder::instance().record(FlightRecorder::Direction::Disconnected, connectionData->epoch,
+                std::string("closed"));
             // CORRECTED: Access callback through connectionData
             if (connectionData->connectionCallback) {
                 connectionData->connectionCallback(false);
@@ -329,6 +652,15 @@ int WebSocketClient::websocketCallback(struct lws* wsi, enum lws_callback_reason
         }
         break;
 
+    case LWS_CALLBACK_EVENT_WAIT_CANCELLED: {
+        // Woken by sendMessage from another thread; request the write from here
+        WebSocketClient* owner = static_cast<WebSocketClient*>(lws_context_user(lws_get_context(wsi)));
+        if (owner && owner->writePending_.load() && owner->connected_.load() && owner->websocket_) {
+            lws_callback_on_writable(owner->websocket_);
+        }
+        break;
+    }
+
     default:
         break;
     }
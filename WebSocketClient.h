@@ -8,7 +8,14 @@
 #include <memory>
 #include <libwebsockets.h>
 #include <optional>
+#include <vector>
+#include <deque>
+#include <utility>
 #include <nlohmann/json.hpp>
+#include "FastJsonParser.h"
+#include "ThreadTuning.h"
+#include "BrokerLink.h"
+#include "FlightRecorder.h"
 
 using json = nlohmann::json;
 
@@ -18,6 +25,11 @@ public:
     using MessageCallback = std::function<void(const json& message)>;
     using ConnectionCallback = std::function<void(bool connected)>;
 
+    // Extra HTTP headers for the upgrade request, asked for on the lws thread
+    // at every connect attempt so they can carry current credentials
+    using HandshakeHeaders = std::vector<std::pair<std::string, std::string>>;
+    using HandshakeHeaderProvider = std::function<HandshakeHeaders()>;
+
     WebSocketClient();
     ~WebSocketClient();
 
@@ -30,22 +42,53 @@ public:
         MessageCallback messageCallback,
         ConnectionCallback connectionCallback = nullptr);
 
+    // Start with an ordered endpoint list. The first entry is used until it fails
+    // MAX_CONNECT_FAILURES_BEFORE_FAILOVER connects in a row, then the next one.
+    // A broker:<socket path> entry instead attaches to a local tools/SixMansBroker
+    // and shares its upstream connection; the broker then handles endpoints
+    // and reconnects, and "connected" follows its upstream link.
+    bool start(const std::vector<std::string>& urls, const std::string& token,
+        MessageCallback messageCallback,
+        ConnectionCallback connectionCallback = nullptr);
+
+    // Replace the endpoint order (e.g. after re-ranking). Takes effect on the next
+    // connect attempt; an established connection is left alone.
+    void setEndpoints(const std::vector<std::string>& urls);
+
+    // CPU affinity and priority for the lws service thread. Set before start().
+    void setThreadTuning(const ThreadTuning& tuning);
+
+    // Set before start()
+    void setHandshakeHeaderProvider(HandshakeHeaderProvider provider);
+
+    // Endpoint of the current (or most recent) connection attempt
+    std::string getCurrentEndpoint() const;
+
     // Stop the WebSocket connection
     void stop();
 
     // Send a message to the server
     bool sendMessage(const json& message);
 
+    // Same, for a message that is already serialised
+    bool sendText(std::string payload);
+
     // Check if connected
     bool isConnected() const;
 
+    // Split a ws[s]://host[:port][/path] URL into its parts
+    static bool parseUrl(const std::string& url, std::string& host, int& port, std::string& path, bool& useSSL);
+
 private:
     struct ConnectionData {
         WebSocketClient* client;
         std::string token;
         MessageCallback messageCallback;
         ConnectionCallback connectionCallback;
-        std::string writeBuffer;
+        std::string rxBuffer;           // Reassembly buffer for fragmented frames
+        FastJsonParser parser;          // Owned by the lws thread
+        uint32_t epoch = 0;             // Flight recorder epoch of the current connection
+        FlightRecorder::Redaction inboundRedaction; // Carried across fragments of one message
         bool connectionEstablished;
         std::atomic<bool> shouldReconnect;
     };
@@ -56,12 +99,20 @@ private:
 
     // Helper methods
     void runEventLoop();
-    bool parseUrl(const std::string& url, std::string& host, int& port, std::string& path, bool& useSSL);
+    void runBrokerLoop();
+    void onBrokerRecord(BrokerProtocol::Record record, std::string_view payload);
+    void setBrokerConnected(bool connected);
+    void flushBrokerWrites();
+    void dropPendingWrites();
+    bool selectEndpoint();
+    void recordConnectFailure();
     void handleMessage(const std::string& message);
     void scheduleReconnect();
 
     // Member variables
     std::unique_ptr<std::thread> eventThread_;
+    ThreadTuning threadTuning_;
+    HandshakeHeaderProvider handshakeHeaderProvider_;
     std::atomic<bool> running_;
     std::atomic<bool> connected_;
 
@@ -74,9 +125,26 @@ private:
     std::string serverPath_;
     bool useSSL_;
 
+    mutable std::mutex endpointMutex_;
+    std::vector<std::string> endpoints_;
+    size_t endpointIndex_;
+    int consecutiveFailures_;
+    std::string currentEndpoint_;
+
     std::unique_ptr<ConnectionData> connectionData_;
 
+    // Broker mode (brokerPath_ set): no lws context, the link is owned by the
+    // event thread and swapped under writeMutex_
+    std::string brokerPath_;
+    std::unique_ptr<BrokerLink> broker_;
+    uint32_t brokerGeneration_;     // Guarded by writeMutex_
+
+    // Outbound frames, written one per WRITEABLE callback in FIFO order.
+    // Dropped when the connection they were queued for goes away.
     mutable std::mutex writeMutex_;
-    std::string pendingWrite_;
-    bool writePending_;
+    std::deque<std::string> pendingWrites_;
+    std::atomic<bool> writePending_;
+
+    // Event thread only; a connect after the first counts as a reconnect
+    bool everConnected_;
 };
\ No newline at end of file
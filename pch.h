@@ -2,16 +2,22 @@
 
 #define WIN32_LEAN_AND_MEAN
 #define _CRT_SECURE_NO_WARNINGS
+
+#ifndef SIXMANS_HEADLESS
 #include "bakkesmod/plugin/bakkesmodplugin.h"
+#endif
 
 #include <string>
 #include <vector>
 #include <functional>
 #include <memory>
 
+#ifndef SIXMANS_HEADLESS
 #include "IMGUI/imgui.h"
 #include "IMGUI/imgui_stdlib.h"
 #include "IMGUI/imgui_searchablecombo.h"
 #include "IMGUI/imgui_rangeslider.h"
+#endif
 
+// Headless builds (tools/) get logging.h from tools/headless instead
 #include "logging.h"
\ No newline at end of file
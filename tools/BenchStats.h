@@ -0,0 +1,64 @@
+#pragma once
+
+// Latency sample collection shared by the tools in this directory
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+class LatencyStats {
+public:
+    void add(std::chrono::nanoseconds elapsed) {
+        samples_.push_back(elapsed.count());
+        sorted_ = false;
+    }
+
+    template<typename Rep, typename Period>
+    void add(std::chrono::duration<Rep, Period> elapsed) {
+        add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed));
+    }
+
+    size_t count() const {
+        return samples_.size();
+    }
+
+    // Samples strictly above the limit
+    size_t countAbove(std::chrono::nanoseconds limit) const {
+        return static_cast<size_t>(std::count_if(samples_.begin(), samples_.end(),
+            [&](long long ns) { return ns > limit.count(); }));
+    }
+
+    // One line: count, mean, p50, p99, p99.9 and max, in the given unit
+    void print(const char* name, double unitNanos = 1e3, const char* unit = "us") {
+        if (samples_.empty()) {
+            std::printf("  %-12s (no samples)\n", name);
+            return;
+        }
+        sort();
+        double sum = 0;
+        for (long long ns : samples_) {
+            sum += static_cast<double>(ns);
+        }
+        std::printf("  %-12s n=%-8zu mean %9.2f %s  p50 %9.2f  p99 %9.2f  p99.9 %9.2f  max %9.2f\n",
+            name, samples_.size(), sum / samples_.size() / unitNanos, unit,
+            percentile(0.50) / unitNanos, percentile(0.99) / unitNanos,
+            percentile(0.999) / unitNanos, samples_.back() / unitNanos);
+    }
+
+private:
+    void sort() {
+        if (!sorted_) {
+            std::sort(samples_.begin(), samples_.end());
+            sorted_ = true;
+        }
+    }
+
+    double percentile(double p) const {
+        size_t index = static_cast<size_t>(p * (samples_.size() - 1));
+        return static_cast<double>(samples_[index]);
+    }
+
+    std::vector<long long> samples_;
+    bool sorted_ = true;
+};
@@ -0,0 +1,225 @@
+// FlightRecorderDump.cpp
+//
+// Decodes the flight recorder ring written by FlightRecorder (by default
+// <BakkesMod data>/sixmans/flight_recorder.bin, plus .prev from the previous
+// session). Safe to run while the game is up; records still being written are
+// skipped. Token and password values were masked with '*' when recorded.
+// Does not depend on BakkesMod, e.g.
+//
+//   cl /std:c++20 /O2 /EHsc /I.. FlightRecorderDump.cpp
+//   g++ -std=c++20 -O2 -I.. FlightRecorderDump.cpp
+//
+// Usage: FlightRecorderDump <file> [--epoch N] [--tail N] [--full] [--corpus]
+//
+// --corpus writes the inbound messages as ReplayHarness input instead (JSONL,
+// fragments reassembled, truncated messages skipped).
+
+#include "FlightRecorder.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+using namespace FlightRecorderFormat;
+
+namespace {
+    struct Record {
+        SlotHeader header;
+        std::string payload;
+    };
+
+    const char* directionName(uint8_t direction) {
+        switch (static_cast<Direction>(direction)) {
+        case Direction::Inbound: return "<-";
+        case Direction::Outbound: return "->";
+        case Direction::Connected: return "CONNECT";
+        case Direction::Disconnected: return "CLOSE";
+        }
+        return "?";
+    }
+
+    // Printable, single-line version of a payload
+    std::string escape(const std::string& payload, size_t limit) {
+        std::string out;
+        for (size_t i = 0; i < payload.size() && i < limit; ++i) {
+            unsigned char c = static_cast<unsigned char>(payload[i]);
+            if (c == '\n') out += "\\n";
+            else if (c == '\r') out += "\\r";
+            else if (c == '\t') out += "\\t";
+            else if (c < 0x20 || c >= 0x7f) {
+                char hex[8];
+                snprintf(hex, sizeof(hex), "\\x%02x", c);
+                out += hex;
+            }
+            else out += static_cast<char>(c);
+        }
+        if (payload.size() > limit) {
+            out += "...";
+        }
+        return out;
+    }
+
+    // Inbound messages as ReplayHarness corpus lines
+    void writeCorpus(const std::vector<Record>& records) {
+        std::string message;
+        uint32_t messageEpoch = 0;
+        bool truncated = false;
+        size_t written = 0, skipped = 0;
+        uint64_t originNs = 0;
+
+        for (const Record& record : records) {
+            const SlotHeader& h = record.header;
+            if (static_cast<Direction>(h.direction) != Direction::Inbound) {
+                continue;
+            }
+            if (h.epoch != messageEpoch) {
+                // A new connection never continues a fragmented message
+                message.clear();
+                truncated = false;
+                messageEpoch = h.epoch;
+            }
+            message += record.payload;
+            truncated |= (h.flags & FLAG_TRUNCATED) != 0;
+            if (!(h.flags & FLAG_FINAL_FRAGMENT)) {
+                continue;
+            }
+
+            if (truncated) {
+                ++skipped;
+            }
+            else {
+                if (written == 0) {
+                    originNs = h.timestampNs;
+                }
+                nlohmann::json line;
+                line["t"] = static_cast<double>(h.timestampNs - originNs) / 1e6;
+                line["frame"] = message;
+                printf("%s\n", line.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace).c_str());
+                ++written;
+            }
+            message.clear();
+            truncated = false;
+        }
+        fprintf(stderr, "%zu messages written, %zu truncated ones skipped\n", written, skipped);
+    }
+
+    std::string wallClock(const FileHeader& file, uint64_t timestampNs) {
+        int64_t wallNs = file.systemAtOpenNs + static_cast<int64_t>(timestampNs - file.steadyAtOpenNs);
+        std::time_t seconds = static_cast<std::time_t>(wallNs / 1000000000);
+        std::tm local{};
+#ifdef _WIN32
+        localtime_s(&local, &seconds);
+#else
+        localtime_r(&seconds, &local);
+#endif
+        char buffer[32];
+        size_t n = std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &local);
+        snprintf(buffer + n, sizeof(buffer) - n, ".%03d", static_cast<int>((wallNs / 1000000) % 1000));
+        return buffer;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <file> [--epoch N] [--tail N] [--full] [--corpus]\n", argv[0]);
+        return 2;
+    }
+
+    const char* path = argv[1];
+    long long epochFilter = -1;
+    size_t tail = 0;
+    size_t payloadLimit = 200;
+    bool corpus = false;
+    for (int i = 2; i < argc; ++i) {
+        if (!strcmp(argv[i], "--epoch") && i + 1 < argc) epochFilter = atoll(argv[++i]);
+        else if (!strcmp(argv[i], "--tail") && i + 1 < argc) tail = static_cast<size_t>(atoll(argv[++i]));
+        else if (!strcmp(argv[i], "--full")) payloadLimit = SIZE_MAX;
+        else if (!strcmp(argv[i], "--corpus")) corpus = true;
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return 1;
+    }
+
+    FileHeader file{};
+    if (!in.read(reinterpret_cast<char*>(&file), sizeof(file)) || file.magic != MAGIC) {
+        fprintf(stderr, "%s is not a flight recorder file\n", path);
+        return 1;
+    }
+    if (file.version != VERSION) {
+        fprintf(stderr, "unsupported version %u (expected %u)\n", file.version, VERSION);
+        return 1;
+    }
+    if (file.slotSize <= sizeof(SlotHeader) || file.slotCount == 0) {
+        fprintf(stderr, "corrupt header (%u slots of %u bytes)\n", file.slotCount, file.slotSize);
+        return 1;
+    }
+
+    // Read every slot, then order by sequence number; the ring's head is
+    // wherever the highest seq is
+    std::vector<Record> records;
+    std::vector<char> slot(file.slotSize);
+    size_t incomplete = 0;
+    for (uint32_t i = 0; i < file.slotCount; ++i) {
+        if (!in.read(slot.data(), slot.size())) {
+            break;
+        }
+        Record record;
+        std::memcpy(&record.header, slot.data(), sizeof(SlotHeader));
+        if (record.header.seq == 0) {
+            incomplete += file.nextIndex > i ? 1 : 0;
+            continue;
+        }
+        if (epochFilter >= 0 && record.header.epoch != static_cast<uint64_t>(epochFilter)) {
+            continue;
+        }
+        uint32_t stored = std::min<uint32_t>(record.header.stored, file.slotSize - sizeof(SlotHeader));
+        record.payload.assign(slot.data() + sizeof(SlotHeader), stored);
+        records.push_back(std::move(record));
+    }
+
+    std::sort(records.begin(), records.end(), [](const Record& a, const Record& b) {
+        return a.header.seq < b.header.seq;
+    });
+    if (tail > 0 && records.size() > tail) {
+        records.erase(records.begin(), records.end() - tail);
+    }
+
+    if (corpus) {
+        writeCorpus(records);
+        return 0;
+    }
+
+    printf("%s: %u slots x %u bytes, %llu records written, %zu shown",
+        path, file.slotCount, file.slotSize, static_cast<unsigned long long>(file.nextIndex), records.size());
+    if (incomplete > 0) {
+        printf(", %zu incomplete", incomplete);
+    }
+    printf("\n");
+
+    uint64_t previousNs = records.empty() ? 0 : records.front().header.timestampNs;
+    for (const Record& record : records) {
+        const SlotHeader& h = record.header;
+        double deltaMs = static_cast<double>(h.timestampNs - previousNs) / 1e6;
+        previousNs = h.timestampNs;
+
+        printf("#%-8llu %s +%9.3fms  epoch %-4u %-7s %6u B%s%s  %s\n",
+            static_cast<unsigned long long>(h.seq - 1),
+            wallClock(file, h.timestampNs).c_str(),
+            deltaMs,
+            h.epoch,
+            directionName(h.direction),
+            h.length,
+            (h.flags & FLAG_FINAL_FRAGMENT) ? "" : " (fragment)",
+            (h.flags & FLAG_TRUNCATED) ? " (truncated)" : "",
+            escape(record.payload, payloadLimit).c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+// JsonParseBench.cpp
+//
+// Standalone throughput comparison of the inbound frame decoders: nlohmann's
+// json::parse versus FastJsonParser (simdjson On-Demand when built with
+// SIXMANS_USE_SIMDJSON). Does not depend on BakkesMod, e.g.
+//
+//   cl /std:c++20 /O2 /EHsc /DSIXMANS_USE_SIMDJSON /I.. JsonParseBench.cpp simdjson.cpp
+//   g++ -std=c++20 -O2 -DSIXMANS_USE_SIMDJSON -I.. JsonParseBench.cpp -lsimdjson
+//
+// Usage: JsonParseBench [iterations] [players]
+
+#include "FastJsonParser.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using json = nlohmann::json;
+
+namespace {
+    // A lobby_action carrying a large queue/state blob, the worst case for the
+    // receive path since the client only needs a handful of top-level fields.
+    std::string buildStatePayload(int players) {
+        json state;
+        state["status"] = "in_progress";
+        state["players"] = json::array();
+        for (int i = 0; i < players; ++i) {
+            state["players"].push_back({
+                { "id", 100000 + i },
+                { "name", "player_" + std::to_string(i) },
+                { "team", i % 2 },
+                { "mmr", 1000.5 + i },
+                { "history", { 1, 0, 1, 1, 0, 1 } }
+            });
+        }
+
+        json message;
+        message["type"] = "lobby_action";
+        message["action"] = "join";
+        message["state"] = state;
+        message["lobbyName"] = "sm1234";
+        message["password"] = "abcd";
+        message["timestamp"] = 1700000000123;
+        return message.dump();
+    }
+
+    template<typename Fn>
+    void run(const char* name, const std::string& payload, int iterations, Fn&& parse) {
+        size_t sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            json parsed = parse(payload);
+            sink += parsed.size();
+        }
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        double mb = static_cast<double>(payload.size()) * iterations / (1024.0 * 1024.0);
+        std::printf("%-24s %10.1f msg/s %10.1f MB/s %8.2f us/msg (sink %zu)\n",
+            name, iterations / elapsed, mb / elapsed, elapsed * 1e6 / iterations, sink);
+    }
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 2000;
+    int players = argc > 2 ? std::atoi(argv[2]) : 500;
+
+    const std::string small = R"({"type":"ping","timestamp":1700000000123})";
+    const std::string large = buildStatePayload(players);
+
+    std::printf("small payload: %zu bytes, large payload: %zu bytes\n", small.size(), large.size());
+#ifndef SIXMANS_USE_SIMDJSON
+    std::printf("note: built without SIXMANS_USE_SIMDJSON, FastJsonParser falls back to nlohmann\n");
+#endif
+
+    FastJsonParser parser;
+    for (const auto* payload : { &small, &large }) {
+        int n = payload == &small ? iterations * 50 : iterations;
+        run("nlohmann json::parse", *payload, n, [](const std::string& p) { return json::parse(p); });
+        run("FastJsonParser", *payload, n, [&](const std::string& p) { return parser.parse(p); });
+    }
+
+    std::printf("fast path hits: %zu, fallbacks: %zu\n", parser.fastPathHits(), parser.fallbackHits());
+    return 0;
+}
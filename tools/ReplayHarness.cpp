@@ -0,0 +1,293 @@
+// ReplayHarness.cpp
+//
+// Replays a capture of server frames through NetworkManager's receive path
+// (FastJsonParser, validation, settings filter, queue) and a headless stand-in
+// for the game-thread dispatcher, then reports throughput, drops, the queue
+// high-water mark and per-stage latency. Builds without BakkesMod, e.g.
+//
+//   g++ -std=c++20 -O2 -DSIXMANS_HEADLESS -DSIXMANS_USE_SIMDJSON -I.. -Iheadless ReplayHarness.cpp
+//       ../NetworkManager.cpp ../WebSocketClient.cpp ../EndpointProber.cpp ../AsyncLog.cpp
+//       ../FlightRecorder.cpp ../ThreadTuning.cpp ../BrokerLink.cpp ../OutboundSpool.cpp ../Metrics.cpp
+//       -lwebsockets -lsimdjson -lpthread [-lrt]
+//
+// Corpus: one JSON object per line, {"t": <ms since capture start>, "frame": <raw
+// frame as a string, or the message object>}. FlightRecorderDump --corpus writes
+// this format from a flight recorder file.
+//
+// By default frames are fed as fast as possible against a virtual clock: game
+// ticks (--tick-hz, default 120) are run inline whenever the capture's
+// timestamps say one would have happened, so results depend only on the input.
+// With --realtime the original timing is kept (scaled by --speed) and the
+// dispatcher runs on its own thread at the tick rate. --tick-hz 0 dispatches
+// everything as soon as it's queued.
+//
+// Usage: ReplayHarness <corpus.jsonl> [--realtime] [--speed X] [--tick-hz N]
+//                      [--repeat N] [--no-auto-join] [--no-auto-create] [--verbose]
+
+#include "NetworkManager.h"
+#include "AsyncLog.h"
+#include "Config.h"
+#include "FastJsonParser.h"
+#include "BenchStats.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    struct Frame {
+        double atMs;
+        std::string raw;
+    };
+
+    struct Options {
+        const char* corpus = nullptr;
+        bool realtime = false;
+        double speed = 1.0;
+        int tickHz = 120;
+        int repeat = 1;
+        bool autoJoin = true;
+        bool autoCreate = true;
+        bool verbose = false;
+    };
+
+    std::vector<Frame> loadCorpus(const char* path, size_t& skipped) {
+        std::vector<Frame> frames;
+        std::ifstream in(path);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.empty()) {
+                continue;
+            }
+            try {
+                json entry = json::parse(line);
+                const json& frame = entry.at("frame");
+                frames.push_back({ entry.value("t", 0.0), frame.is_string() ? frame.get<std::string>() : frame.dump() });
+            }
+            catch (const json::exception&) {
+                ++skipped;
+            }
+        }
+        return frames;
+    }
+
+    // Feeds frames into the manager and plays the game thread's part
+    class Replay {
+    public:
+        explicit Replay(NetworkManager& network) : network_(network) {}
+
+        void feed(const Frame& frame) {
+            auto start = Clock::now();
+            json message;
+            try {
+                message = parser_.parse(frame.raw.data(), frame.raw.size());
+            }
+            catch (const json::parse_error&) {
+                ++parseErrors_;
+                return;
+            }
+            auto parsed = Clock::now();
+            network_.injectMessage(message);
+            auto ingested = Clock::now();
+
+            parse_.add(parsed - start);
+            ingest_.add(ingested - parsed);
+            highWater_ = std::max(highWater_, network_.getQueueSize());
+        }
+
+        // One game tick: same per-tick budget as SixMansPlugin::messageDispatcher
+        // (or unbounded when budget is 0). Returns how many were dispatched.
+        int tick(int budget) {
+            int handled = 0;
+            while (budget == 0 || handled < budget) {
+                auto inbound = network_.getNextMessage();
+                if (!inbound.has_value()) {
+                    break;
+                }
+                auto dequeued = Clock::now();
+                queueWait_.add(dequeued - inbound->receivedAt);
+                dispatch(inbound->message);
+                dispatch_.add(Clock::now() - dequeued);
+                ++handled;
+            }
+            dispatched_ += handled;
+            return handled;
+        }
+
+        void report(double seconds, size_t frames) {
+            std::printf("frames:        %zu in %.3f s (%.0f frames/s)\n", frames, seconds, frames / seconds);
+            std::printf("parse errors:  %zu\n", parseErrors_);
+            std::printf("received:      %zu\n", network_.getReceivedCount());
+            std::printf("invalid:       %zu\n", network_.getInvalidCount());
+            std::printf("filtered:      %zu\n", network_.getFilteredCount());
+            std::printf("queue drops:   %zu\n", network_.getDroppedCount());
+            std::printf("dispatched:    %zu\n", dispatched_);
+            std::printf("queue high:    %zu / %d\n", highWater_, SixMansConfig::MAX_QUEUE_SIZE);
+            std::printf("fast path:     %zu hits, %zu fallbacks\n", parser_.fastPathHits(), parser_.fallbackHits());
+            for (const auto& [kind, count] : byKind_) {
+                std::printf("  %-28s %zu\n", kind.c_str(), count);
+            }
+            std::printf("latency:\n");
+            parse_.print("parse");
+            ingest_.print("ingest");
+            queueWait_.print("queue wait");
+            dispatch_.print("dispatch");
+        }
+
+    private:
+        // What handleLobbyMessage reads before it calls into the game
+        void dispatch(const json& message) {
+            std::string kind = message.value("type", "");
+            if (message.contains("action")) {
+                kind += "/" + message["action"].get<std::string>();
+            }
+            if (message.contains("lobbyName")) {
+                lastLobby_ = message["lobbyName"].get<std::string>();
+            }
+            ++byKind_[kind];
+        }
+
+        NetworkManager& network_;
+        FastJsonParser parser_;
+        LatencyStats parse_, ingest_, queueWait_, dispatch_;
+        std::map<std::string, size_t> byKind_;
+        std::string lastLobby_;
+        size_t parseErrors_ = 0;
+        size_t dispatched_ = 0;
+        size_t highWater_ = 0;
+    };
+
+    void runVirtual(Replay& replay, const std::vector<Frame>& frames, int tickHz) {
+        const int budget = tickHz > 0 ? SixMansConfig::MESSAGES_PER_TICK : 0;
+        const double tickMs = tickHz > 0 ? 1000.0 / tickHz : 0.0;
+        double nextTickMs = frames.empty() ? 0.0 : frames.front().atMs;
+
+        for (const Frame& frame : frames) {
+            if (tickHz > 0) {
+                // Catch the virtual game thread up to this frame's arrival
+                for (; nextTickMs <= frame.atMs; nextTickMs += tickMs) {
+                    replay.tick(budget);
+                }
+            }
+            replay.feed(frame);
+            if (tickHz == 0) {
+                replay.tick(0);
+            }
+        }
+        while (replay.tick(budget) > 0) {
+        }
+    }
+
+    void runRealtime(Replay& replay, const std::vector<Frame>& frames, int tickHz, double speed) {
+        std::atomic<bool> feeding{ true };
+        std::thread dispatcher([&] {
+            const int budget = tickHz > 0 ? SixMansConfig::MESSAGES_PER_TICK : 0;
+            auto period = tickHz > 0 ? std::chrono::nanoseconds(1000000000 / tickHz) : std::chrono::nanoseconds(0);
+            auto next = Clock::now();
+            for (;;) {
+                bool done = !feeding.load();
+                int handled = replay.tick(budget);
+                if (done && handled == 0) {
+                    break;
+                }
+                if (tickHz > 0) {
+                    next += period;
+                    std::this_thread::sleep_until(next);
+                }
+                else if (handled == 0) {
+                    std::this_thread::yield();
+                }
+            }
+            });
+
+        const double originMs = frames.empty() ? 0.0 : frames.front().atMs;
+        auto start = Clock::now();
+        for (const Frame& frame : frames) {
+            auto due = start + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double, std::milli>((frame.atMs - originMs) / speed));
+            std::this_thread::sleep_until(due);
+            replay.feed(frame);
+        }
+        feeding.store(false);
+        dispatcher.join();
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--realtime")) options.realtime = true;
+        else if (!strcmp(argv[i], "--speed") && i + 1 < argc) options.speed = std::atof(argv[++i]);
+        else if (!strcmp(argv[i], "--tick-hz") && i + 1 < argc) options.tickHz = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--repeat") && i + 1 < argc) options.repeat = std::max(1, std::atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--no-auto-join")) options.autoJoin = false;
+        else if (!strcmp(argv[i], "--no-auto-create")) options.autoCreate = false;
+        else if (!strcmp(argv[i], "--verbose")) options.verbose = true;
+        else if (argv[i][0] != '-') options.corpus = argv[i];
+    }
+    if (!options.corpus || options.speed <= 0.0 || options.tickHz < 0) {
+        std::fprintf(stderr, "usage: %s <corpus.jsonl> [--realtime] [--speed X] [--tick-hz N] [--repeat N]"
+            " [--no-auto-join] [--no-auto-create] [--verbose]\n", argv[0]);
+        return 2;
+    }
+
+    size_t skipped = 0;
+    std::vector<Frame> corpus = loadCorpus(options.corpus, skipped);
+    if (corpus.empty()) {
+        std::fprintf(stderr, "no frames in %s (%zu unreadable lines)\n", options.corpus, skipped);
+        return 1;
+    }
+
+    // Repeats are laid end to end in time
+    std::vector<Frame> frames;
+    double span = corpus.back().atMs - corpus.front().atMs + 1.0;
+    for (int r = 0; r < options.repeat; ++r) {
+        for (const Frame& frame : corpus) {
+            frames.push_back({ frame.atMs + r * span, frame.raw });
+        }
+    }
+
+    // Logging is off unless asked for; it would dominate the numbers
+    setHeadlessLogQuiet(!options.verbose);
+    if (options.verbose) {
+        AsyncLog::instance().start([](const std::string& line) { std::fprintf(stderr, "%s\n", line.c_str()); });
+    }
+    else {
+        AsyncLog::instance().setLevel(LogLevel::Off);
+    }
+
+    auto settings = std::make_shared<SettingsSnapshot>();
+    PluginSettings pluginSettings;
+    pluginSettings.autoJoin = options.autoJoin;
+    pluginSettings.autoCreate = options.autoCreate;
+    settings->publish(pluginSettings);
+
+    NetworkManager network;
+    network.setSettingsSource(settings);
+    Replay replay(network);
+
+    std::printf("%s: %zu frames (%zu unreadable lines) x %d, %s, tick %d Hz\n", options.corpus, corpus.size(),
+        skipped, options.repeat, options.realtime ? "original timing" : "virtual clock", options.tickHz);
+
+    auto start = Clock::now();
+    if (options.realtime) {
+        runRealtime(replay, frames, options.tickHz, options.speed);
+    }
+    else {
+        runVirtual(replay, frames, options.tickHz);
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    replay.report(seconds, frames.size());
+    AsyncLog::instance().stop();
+    return 0;
+}
@@ -0,0 +1,342 @@
+#pragma once
+
+// Scripted stand-in for Rocket League behind IGameFacade, for running
+// LobbyController (and anything else written against the facade) outside the
+// game. Time is simulated: each step() is one game tick of 1/tickHz seconds in
+// which queued execute() callbacks run, then due timers, then any hook events
+// scheduled for that tick. Matchmaking calls are recorded, and joins/creates
+// are answered with the configured join events after a delay, so the join
+// state machine sees the same sequence of calls it does in the game.
+
+#include "GameFacade.h"
+#include "Config.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class SimulatedGame : public IGameFacade {
+public:
+    struct MatchmakingCall {
+        enum class Kind { Join, Create };
+        Kind kind;
+        std::string lobbyName;
+        std::string password;
+        std::string mapName;    // Create only
+        std::string region;     // Create only
+        double atSeconds;
+    };
+
+    // How the simulated game answers JoinPrivateMatch
+    struct JoinBehaviour {
+        double responseDelayS = 0.5;    // Time until the success/failure event
+        int failuresBeforeSuccess = 0;  // Per lobby name
+        bool silent = false;            // Never fire an event; the controller's timeout has to notice
+        double leaveAfterS = 5.0;       // Leave the match again, so the next join isn't refused
+    };
+
+    explicit SimulatedGame(double tickHz = 120.0)
+        : tickSeconds_(1.0 / tickHz), base_(Clock::now()) {}
+
+    // Non-copyable
+    SimulatedGame(const SimulatedGame&) = delete;
+    SimulatedGame& operator=(const SimulatedGame&) = delete;
+
+    // Fire eventName hz times per simulated second (at most once per tick)
+    void emitEvery(const std::string& eventName, double hz) {
+        emitters_.push_back({ eventName, hz > 0.0 ? 1.0 / hz : tickSeconds_, seconds() });
+    }
+
+    // Fire eventName once at the given simulated time
+    void emitAt(const std::string& eventName, double atSeconds) {
+        schedule(atSeconds, [this, eventName] { fire(eventName); });
+    }
+
+    // Announce a stat ticker event at the given simulated time
+    void emitStatAt(const StatEvent& event, double atSeconds) {
+        schedule(atSeconds, [this, event] {
+            for (StatCallback& callback : statCallbacks_) {
+                callback(event);
+            }
+            });
+    }
+
+    // Report the state of the given number of cars hz times per simulated
+    // second (at most once per tick). Car i is player handle CAR_PLAYER_BASE + i,
+    // driving its own circle and slowly using then refilling boost.
+    static constexpr uintptr_t CAR_PLAYER_BASE = 0x1000;
+    void driveCars(size_t cars, double hz) {
+        carCount_ = cars;
+        carPeriod_ = hz > 0.0 ? 1.0 / hz : tickSeconds_;
+        nextCarTick_ = seconds();
+    }
+
+    // What readMatchResult reports from now on
+    void setMatchResult(const MatchResult& result) {
+        matchResult_ = result;
+    }
+
+    void setJoinBehaviour(const JoinBehaviour& behaviour) {
+        joinBehaviour_ = behaviour;
+    }
+
+    void setMatchmakingAvailable(bool available) {
+        matchmakingAvailable_ = available;
+    }
+
+    // Simulated time at which the game has finished loading (isGameReady)
+    void setReadyAt(double atSeconds) {
+        readyAtSeconds_ = atSeconds;
+    }
+
+    // Run one tick. Returns the real time spent inside callbacks, i.e. what the
+    // code under test cost the game this frame.
+    std::chrono::nanoseconds step() {
+        auto start = Clock::now();
+        double current = seconds();
+
+        std::vector<Callback> executes;
+        {
+            std::lock_guard<std::mutex> lock(executeMutex_);
+            executes.swap(executeQueue_);
+        }
+        for (Callback& callback : executes) {
+            callback();
+        }
+
+        // Timers may schedule more timers; only run what's due now
+        while (!timers_.empty() && timers_.begin()->first.first <= current) {
+            Callback callback = std::move(timers_.begin()->second);
+            timers_.erase(timers_.begin());
+            callback();
+        }
+
+        for (Emitter& emitter : emitters_) {
+            if (emitter.next <= current) {
+                emitter.next += emitter.period;
+                fire(emitter.eventName);
+            }
+        }
+
+        if (carCount_ > 0 && nextCarTick_ <= current) {
+            nextCarTick_ += carPeriod_;
+            for (size_t car = 0; car < carCount_; ++car) {
+                for (CarHook& carHook : carHooks_) {
+                    HookProfiler::Scope scope(*carHook.profiler, carHook.hook);
+                    if (carHook.wanted()) {
+                        carHook.callback(carState(car, current));
+                    }
+                }
+            }
+        }
+
+        auto cost = Clock::now() - start;
+        ++ticks_;
+        simNanos_.store(static_cast<int64_t>(ticks_ * tickSeconds_ * 1e9), std::memory_order_release);
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(cost);
+    }
+
+    // Step until the simulated clock reaches untilSeconds. beforeTick runs ahead of
+    // each tick with the current simulated time (to feed input); onTick gets each
+    // tick's cost. With paced set, ticks are spread over real time.
+    void runUntil(double untilSeconds, bool paced,
+        const std::function<void(double)>& beforeTick,
+        const std::function<void(std::chrono::nanoseconds)>& onTick) {
+        auto realStart = Clock::now();
+        double simStart = seconds();
+        while (seconds() < untilSeconds) {
+            if (paced) {
+                std::this_thread::sleep_until(realStart + std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(seconds() - simStart)));
+            }
+            if (beforeTick) {
+                beforeTick(seconds());
+            }
+            std::chrono::nanoseconds cost = step();
+            if (onTick) {
+                onTick(cost);
+            }
+        }
+    }
+
+    // Simulated seconds since construction
+    double seconds() const {
+        return static_cast<double>(simNanos_.load(std::memory_order_acquire)) / 1e9;
+    }
+
+    // The facade time point for a simulated time
+    Clock::time_point at(double simSeconds) const {
+        return base_ + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(simSeconds));
+    }
+
+    const std::vector<MatchmakingCall>& matchmakingCalls() const {
+        return calls_;
+    }
+
+    uint64_t ticks() const {
+        return ticks_;
+    }
+
+    // IGameFacade
+
+    Clock::time_point now() const override {
+        return at(seconds());
+    }
+
+    void execute(Callback callback) override {
+        std::lock_guard<std::mutex> lock(executeMutex_);
+        executeQueue_.push_back(std::move(callback));
+    }
+
+    void setTimeout(Callback callback, float delaySeconds) override {
+        schedule(seconds() + delaySeconds, std::move(callback));
+    }
+
+    void hookEvent(const std::string& eventName, HookCallback callback) override {
+        hooks_[eventName].push_back(std::move(callback));
+    }
+
+    bool isInOnlineGame() const override {
+        return inOnlineGame_;
+    }
+
+    bool isGameReady() const override {
+        return seconds() >= readyAtSeconds_;
+    }
+
+    bool joinPrivateMatch(const std::string& lobbyName, const std::string& password) override {
+        if (!matchmakingAvailable_) {
+            return false;
+        }
+        calls_.push_back({ MatchmakingCall::Kind::Join, lobbyName, password, "", "", seconds() });
+
+        int attempt = ++joinAttempts_[lobbyName];
+        if (joinBehaviour_.silent) {
+            return true;
+        }
+        double respondAt = seconds() + joinBehaviour_.responseDelayS;
+        if (attempt <= joinBehaviour_.failuresBeforeSuccess) {
+            schedule(respondAt, [this] { fire(SixMansConfig::JOIN_FAILURE_EVENT); });
+        }
+        else {
+            schedule(respondAt, [this] { enterMatch(); fire(SixMansConfig::JOIN_SUCCESS_EVENT); });
+        }
+        return true;
+    }
+
+    void hookCarStates(HookProfiler& profiler, size_t hook, CarStateFilter wanted,
+        CarStateCallback callback) override {
+        carHooks_.push_back({ &profiler, hook, std::move(wanted), std::move(callback) });
+    }
+
+    void hookStatEvents(StatCallback callback) override {
+        statCallbacks_.push_back(std::move(callback));
+    }
+
+    bool readMatchResult(MatchResult& result) const override {
+        if (!matchResult_) {
+            return false;
+        }
+        result = *matchResult_;
+        return true;
+    }
+
+    std::unique_ptr<PreparedMatch> prepareMatch(const PrivateMatchRequest& request) override {
+        return std::make_unique<PreparedMatch>(request);
+    }
+
+    bool createPrivateMatch(const PreparedMatch& match) override {
+        if (!matchmakingAvailable_) {
+            return false;
+        }
+        const PrivateMatchRequest& request = match.request();
+        calls_.push_back({ MatchmakingCall::Kind::Create, request.serverName, request.password,
+            request.mapName, request.region, seconds() });
+        schedule(seconds() + joinBehaviour_.responseDelayS, [this] { enterMatch(); });
+        return true;
+    }
+
+private:
+    struct Emitter {
+        std::string eventName;
+        double period;
+        double next;
+    };
+
+    struct CarHook {
+        HookProfiler* profiler;
+        size_t hook;
+        CarStateFilter wanted;
+        CarStateCallback callback;
+    };
+
+    void schedule(double atSeconds, Callback callback) {
+        timers_.emplace(std::make_pair(atSeconds, timerOrder_++), std::move(callback));
+    }
+
+    void fire(const std::string& eventName) {
+        auto it = hooks_.find(eventName);
+        if (it == hooks_.end()) {
+            return;
+        }
+        for (HookCallback& callback : it->second) {
+            callback(eventName);
+        }
+    }
+
+    static CarState carState(size_t car, double t) {
+        double radius = 1500.0 + 200.0 * static_cast<double>(car);
+        double speed = 1200.0 + 100.0 * static_cast<double>(car);   // uu/s along the circle
+        double angle = speed / radius * t + static_cast<double>(car);
+        double boost = std::fmod(0.1 * t + 0.15 * static_cast<double>(car), 2.0);
+        return CarState{ CAR_PLAYER_BASE + car,
+            { static_cast<float>(radius * std::cos(angle)), static_cast<float>(radius * std::sin(angle)), 17.0f },
+            { static_cast<float>(-speed * std::sin(angle)), static_cast<float>(speed * std::cos(angle)), 0.0f },
+            static_cast<float>(boost < 1.0 ? 1.0 - boost : boost - 1.0) };
+    }
+
+    void enterMatch() {
+        inOnlineGame_ = true;
+        unsigned match = ++matchGeneration_;
+        schedule(seconds() + joinBehaviour_.leaveAfterS, [this, match] {
+            if (match == matchGeneration_) {
+                inOnlineGame_ = false;
+            }
+            });
+    }
+
+    const double tickSeconds_;
+    const Clock::time_point base_;
+    uint64_t ticks_ = 0;
+    std::atomic<int64_t> simNanos_{ 0 };
+
+    std::map<std::string, std::vector<HookCallback>> hooks_;
+    std::vector<Emitter> emitters_;
+    std::vector<StatCallback> statCallbacks_;
+    std::vector<CarHook> carHooks_;
+    size_t carCount_ = 0;
+    double carPeriod_ = 0.0;
+    double nextCarTick_ = 0.0;
+    std::optional<MatchResult> matchResult_;
+    std::multimap<std::pair<double, uint64_t>, Callback> timers_; // (due, insertion order)
+    uint64_t timerOrder_ = 0;
+
+    std::mutex executeMutex_;
+    std::vector<Callback> executeQueue_;
+
+    JoinBehaviour joinBehaviour_;
+    bool matchmakingAvailable_ = true;
+    double readyAtSeconds_ = 0.0;
+    bool inOnlineGame_ = false;
+    unsigned matchGeneration_ = 0;
+    std::map<std::string, int> joinAttempts_;
+    std::vector<MatchmakingCall> calls_;
+};
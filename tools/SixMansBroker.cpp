@@ -0,0 +1,444 @@
+// SixMansBroker.cpp
+//
+// Connection broker for hosts that run several game clients: holds a single
+// upstream WebSocket and lets every plugin instance on the host share it
+// (serverEndpoints broker:<socket path>), instead of each one keeping its own
+// connection, TLS session and lws context. Instances attach over a Unix domain
+// socket and exchange messages through shared memory rings (see BrokerLink.h).
+//
+// Upstream each instance is a "link". The broker connects with
+// X-SixMans-Multiplex: 1, tags what an instance sends with "link": n and routes
+// what the server sends by that field; frames without one go to every
+// instance. Links are keyed by account token, so an instance that restarts
+// gets its link back and can resume its session, and a second instance with
+// the same token takes the link over. Each Hello's handshake headers become
+// that link's auth request, so attached instances still authenticate without
+// an extra round trip. When an instance goes away the server is told with
+// link_closed, as if its socket had closed.
+//
+// Builds without BakkesMod, e.g.
+//
+//   g++ -std=c++20 -O2 -DSIXMANS_HEADLESS -DSIXMANS_USE_SIMDJSON -I.. -Iheadless SixMansBroker.cpp
+//       ../BrokerLink.cpp ../WebSocketClient.cpp ../AsyncLog.cpp ../FlightRecorder.cpp
+//       ../ThreadTuning.cpp ../Metrics.cpp ../MetricsServer.cpp -lwebsockets -lsimdjson -lpthread [-lrt]
+//
+// --metrics-port N serves the upstream link's counters (see Metrics.h) at
+// http://127.0.0.1:N/metrics.
+//
+// Usage: SixMansBroker --upstream URL[,URL...] [--socket PATH] [--ring-bytes N] [--report S]
+//                      [--metrics-port N]
+
+#include "BrokerLink.h"
+#include "WebSocketClient.h"
+#include "AsyncLog.h"
+#include "MetricsServer.h"
+#include "Config.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    constexpr size_t BACKLOG_LIMIT = 4096;  // Records an instance may fall behind its ring before it's dropped
+
+    std::atomic<bool> stopRequested{ false };
+
+    struct Options {
+        std::string upstream;
+        std::string socketPath =
+#ifdef _WIN32
+            "sixmans-broker.sock";
+#else
+            "/tmp/sixmans-broker.sock";
+#endif
+        uint32_t ringBytes = SixMansConfig::BROKER_RING_BYTES;
+        double report = 30.0;
+        int metricsPort = 0;
+    };
+
+    struct Instance {
+        std::unique_ptr<LocalSocket> socket;
+        bool attached = false;
+        bool closing = false;
+        uint32_t link = 0;
+        std::string token;
+        std::unique_ptr<SharedMemory> region;
+        SharedRing toInstance;
+        SharedRing toBroker;
+        uint32_t generation = 0;    // From the last Hello; 0 until one arrives on this upstream connection
+        std::deque<std::pair<BrokerProtocol::Record, std::string>> backlog; // What didn't fit in toInstance
+        size_t framesUp = 0;
+        size_t framesDown = 0;
+        size_t wakes = 0;
+    };
+
+    class Broker {
+    public:
+        explicit Broker(const Options& options) : options_(options) {}
+
+        int run() {
+            listener_ = LocalSocket::listen(options_.socketPath);
+            if (!listener_) {
+                return 1;
+            }
+
+            upstream_.setHandshakeHeaderProvider([]() {
+                return WebSocketClient::HandshakeHeaders{ { "X-SixMans-Multiplex", "1" } };
+                });
+            std::vector<std::string> endpoints = SixMansConfig::parseEndpointList(options_.upstream);
+            if (!upstream_.start(endpoints, "",
+                [this](const json& message) { onUpstreamMessage(message); },
+                [this](bool connected) { onUpstreamConnection(connected); })) {
+                return 1;
+            }
+            std::printf("broker on %s, upstream %s\n", options_.socketPath.c_str(), endpoints.front().c_str());
+
+            auto nextReport = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options_.report));
+            std::vector<LocalSocket*> sockets;
+            while (!stopRequested.load()) {
+                // Arm every ring before sleeping; one that already has records means no sleep
+                bool busy = false;
+                sockets.assign(1, listener_.get());
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    for (auto& instance : instances_) {
+                        sockets.push_back(instance->socket.get());
+                        busy = (instance->attached && instance->toBroker.prepareWait()) || busy;
+                    }
+                }
+                if (!busy) {
+                    std::unique_ptr<bool[]> readable(new bool[sockets.size()]);
+                    LocalSocket::waitReadable(sockets.data(), sockets.size(), 50, readable.get());
+                }
+
+                acceptInstances();
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    for (auto& instance : instances_) {
+                        service(*instance);
+                    }
+                    removeClosed();
+                }
+
+                if (options_.report > 0.0 && Clock::now() >= nextReport) {
+                    report();
+                    nextReport += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options_.report));
+                }
+            }
+
+            upstream_.stop();
+            report();
+            return 0;
+        }
+
+    private:
+        void acceptInstances() {
+            while (std::unique_ptr<LocalSocket> socket = listener_->accept()) {
+                auto instance = std::make_unique<Instance>();
+                instance->socket = std::move(socket);
+                std::lock_guard<std::mutex> lock(mutex_);
+                instances_.push_back(std::move(instance));
+            }
+        }
+
+        // Main thread, mutex_ held
+        void service(Instance& instance) {
+            frames_.clear();
+            if (!instance.socket->receive(frames_)) {
+                instance.closing = true;
+            }
+            for (auto& [type, payload] : frames_) {
+                switch (type) {
+                case BrokerProtocol::Frame::Attach:
+                    attach(instance, payload);
+                    break;
+                case BrokerProtocol::Frame::Hello:
+                    hello(instance, payload);
+                    break;
+                case BrokerProtocol::Frame::Wake:
+                    ++instance.wakes;
+                    break;
+                default:
+                    break;
+                }
+            }
+            if (!instance.attached || instance.closing) {
+                return;
+            }
+
+            instance.toBroker.endWait();
+            forwardUpstream(instance);
+            while (!instance.backlog.empty() && pushToInstance(instance, instance.backlog.front().first, instance.backlog.front().second)) {
+                instance.backlog.pop_front();
+            }
+        }
+
+        void attach(Instance& instance, const std::string& token) {
+            if (instance.attached) {
+                return;
+            }
+
+            // One instance per account: a newcomer with the same token takes the link over
+            auto [entry, isNew] = links_.try_emplace(token, nextLink_);
+            if (isNew) {
+                ++nextLink_;
+            }
+            for (auto& other : instances_) {
+                if (other.get() != &instance && other->attached && other->link == entry->second) {
+                    std::printf("link %u: replaced by a new attach\n", entry->second);
+                    other->closing = true;
+                }
+            }
+
+            size_t blockBytes = SharedRing::blockSize(options_.ringBytes);
+            std::string name = SharedMemory::uniqueName(nextRegion_++);
+            instance.region = SharedMemory::create(name, BrokerProtocol::regionSize(options_.ringBytes));
+            if (!instance.region) {
+                std::fprintf(stderr, "could not create shared memory %s\n", name.c_str());
+                instance.closing = true;
+                return;
+            }
+            instance.toInstance = SharedRing::create(instance.region->data(), options_.ringBytes);
+            instance.toBroker = SharedRing::create(static_cast<uint8_t*>(instance.region->data()) + blockBytes, options_.ringBytes);
+            instance.link = entry->second;
+            instance.token = token;
+            instance.attached = true;
+
+            json ready = { { "region", name }, { "ringBytes", options_.ringBytes } };
+            if (!instance.socket->sendFrame(BrokerProtocol::Frame::Ready, ready.dump())) {
+                instance.closing = true;
+                return;
+            }
+            std::printf("link %u: attached\n", instance.link);
+            if (upstreamUp_) {
+                deliver(instance, BrokerProtocol::Up, std::to_string(upstreamNumber_));
+            }
+        }
+
+        // The instance's connect on this upstream connection: what would have
+        // been its upgrade request's auth headers become an auth message
+        void hello(Instance& instance, const std::string& payload) {
+            json message = json::parse(payload, nullptr, false);
+            if (!instance.attached || !message.is_object() || !upstreamUp_
+                || message.value("upstream", 0u) != upstreamNumber_) {
+                return; // Answers an Up from before the upstream reconnected; another Hello follows
+            }
+            instance.generation = message.value("generation", 0u);
+
+            const json headers = message.value("headers", json::object());
+            std::string authorization = headers.value("Authorization", "");
+            if (authorization.rfind("Bearer ", 0) != 0) {
+                return; // Auth frames will come through the ring instead
+            }
+            json auth = { { "type", "auth" }, { "token", authorization.substr(7) }, { "link", instance.link } };
+            std::string requestId = headers.value("X-SixMans-Request-Id", "");
+            if (!requestId.empty()) {
+                auth["requestId"] = std::strtoull(requestId.c_str(), nullptr, 10);
+            }
+            std::string resume = headers.value("X-SixMans-Resume", "");
+            size_t colon = resume.rfind(':');
+            if (colon != std::string::npos && colon > 0) {
+                auth["resume"] = { { "sessionId", resume.substr(0, colon) },
+                    { "lastSeq", std::strtoull(resume.c_str() + colon + 1, nullptr, 10) } };
+            }
+            upstream_.sendMessage(auth);
+        }
+
+        // Records from before the instance's latest Hello are for a dead
+        // connection and dropped; ones from after it wait for the Hello
+        void forwardUpstream(Instance& instance) {
+            uint32_t generation;
+            std::string_view payload;
+            while (instance.toBroker.front(generation, payload)) {
+                if (generation > instance.generation) {
+                    break;
+                }
+                if (generation == instance.generation && upstreamUp_) {
+                    json message = json::parse(payload.begin(), payload.end(), nullptr, false);
+                    if (message.is_object()) {
+                        message["link"] = instance.link;
+                        upstream_.sendMessage(message);
+                        ++instance.framesUp;
+                    }
+                }
+                instance.toBroker.pop();
+            }
+            if (instance.toBroker.isCorrupt()) {
+                std::printf("link %u: corrupt ring, detaching\n", instance.link);
+                instance.closing = true;
+            }
+        }
+
+        // lws thread
+        void onUpstreamMessage(const json& message) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto link = message.find("link");
+            if (link == message.end() || !link->is_number_unsigned()) {
+                std::string payload = message.dump();
+                for (auto& instance : instances_) {
+                    if (instance->attached) {
+                        deliver(*instance, BrokerProtocol::Message, payload);
+                    }
+                }
+                return;
+            }
+
+            for (auto& instance : instances_) {
+                if (instance->attached && instance->link == link->get<uint32_t>()) {
+                    json routed = message;
+                    routed.erase("link");
+                    deliver(*instance, BrokerProtocol::Message, routed.dump());
+                    return;
+                }
+            }
+        }
+
+        // lws thread
+        void onUpstreamConnection(bool connected) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            upstreamUp_ = connected;
+            if (connected) {
+                ++upstreamNumber_;
+            }
+            std::printf("upstream %s\n", connected ? "connected" : "lost");
+            for (auto& instance : instances_) {
+                if (instance->attached) {
+                    instance->generation = 0; // Nothing queued so far belongs to the new connection
+                    deliver(*instance, connected ? BrokerProtocol::Up : BrokerProtocol::Down,
+                        connected ? std::to_string(upstreamNumber_) : std::string());
+                }
+            }
+        }
+
+        // mutex_ held. Keeps order: once anything is backlogged, so is the rest.
+        void deliver(Instance& instance, BrokerProtocol::Record record, std::string payload) {
+            if (instance.backlog.empty() && pushToInstance(instance, record, payload)) {
+                return;
+            }
+            instance.backlog.emplace_back(record, std::move(payload));
+            if (instance.backlog.size() > BACKLOG_LIMIT) {
+                std::printf("link %u: not keeping up, detaching\n", instance.link);
+                instance.closing = true;
+            }
+        }
+
+        bool pushToInstance(Instance& instance, BrokerProtocol::Record record, const std::string& payload) {
+            if (instance.closing || !instance.toInstance.push(record, payload.data(), payload.size())) {
+                if (instance.toInstance.isCorrupt() && !instance.closing) {
+                    std::printf("link %u: corrupt ring, detaching\n", instance.link);
+                    instance.closing = true;
+                }
+                return false;
+            }
+            ++instance.framesDown;
+            if (instance.toInstance.takeWaiter()) {
+                instance.socket->sendFrame(BrokerProtocol::Frame::Wake);
+            }
+            return true;
+        }
+
+        // mutex_ held
+        void removeClosed() {
+            for (auto it = instances_.begin(); it != instances_.end();) {
+                Instance& instance = **it;
+                if (!instance.closing) {
+                    ++it;
+                    continue;
+                }
+                if (instance.attached) {
+                    std::printf("link %u: detached after %zu frames up, %zu down\n",
+                        instance.link, instance.framesUp, instance.framesDown);
+                    bool replaced = std::any_of(instances_.begin(), instances_.end(), [&](const auto& other) {
+                        return other.get() != &instance && other->attached && !other->closing && other->link == instance.link;
+                        });
+                    if (upstreamUp_ && !replaced) {
+                        upstream_.sendMessage({ { "type", "link_closed" }, { "link", instance.link } });
+                    }
+                }
+                it = instances_.erase(it);
+            }
+        }
+
+        void report() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            size_t attached = 0;
+            for (auto& instance : instances_) {
+                if (!instance->attached) {
+                    continue;
+                }
+                ++attached;
+                std::printf("link %u: %zu frames up, %zu down, %zu wakes, %zu backlogged, %zu B queued to it\n",
+                    instance->link, instance->framesUp, instance->framesDown, instance->wakes,
+                    instance->backlog.size(), instance->toInstance.usedBytes());
+            }
+            std::printf("%zu instance(s) on 1 upstream connection (%s)\n", attached, upstreamUp_ ? "up" : "down");
+        }
+
+        Options options_;
+        std::unique_ptr<LocalSocket> listener_;
+        WebSocketClient upstream_;
+
+        // Instances, their rings' producer side and the link table; shared
+        // between the main loop and the lws thread
+        std::mutex mutex_;
+        std::vector<std::unique_ptr<Instance>> instances_;
+        std::unordered_map<std::string, uint32_t> links_;
+        uint32_t nextLink_ = 1;
+        unsigned nextRegion_ = 0;
+        bool upstreamUp_ = false;
+        uint32_t upstreamNumber_ = 0;   // Counts upstream connects; echoed in Hello
+
+        std::vector<std::pair<BrokerProtocol::Frame, std::string>> frames_; // Main thread scratch
+    };
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        auto next = [&]() { return i + 1 < argc ? argv[++i] : ""; };
+        if (!strcmp(argv[i], "--upstream")) options.upstream = next();
+        else if (!strcmp(argv[i], "--socket")) options.socketPath = next();
+        else if (!strcmp(argv[i], "--ring-bytes")) options.ringBytes = static_cast<uint32_t>(std::strtoul(next(), nullptr, 0));
+        else if (!strcmp(argv[i], "--report")) options.report = std::atof(next());
+        else if (!strcmp(argv[i], "--metrics-port")) options.metricsPort = std::atoi(next());
+        else {
+            std::fprintf(stderr, "usage: %s --upstream URL[,URL...] [--socket PATH] [--ring-bytes N] [--report S]"
+                " [--metrics-port N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (options.upstream.empty() || options.ringBytes < SharedRing::MIN_CAPACITY || (options.ringBytes & (options.ringBytes - 1)) != 0) {
+        std::fprintf(stderr, "--upstream is required and --ring-bytes must be a power of two of at least 4096\n");
+        return 2;
+    }
+
+    std::setvbuf(stdout, nullptr, _IOLBF, BUFSIZ); // Runs for hours; keep the log current
+    std::signal(SIGINT, [](int) { stopRequested.store(true); });
+    std::signal(SIGTERM, [](int) { stopRequested.store(true); });
+
+    AsyncLog::instance().start([](const std::string& line) {
+        std::fprintf(stderr, "%s\n", line.c_str());
+        });
+
+    MetricsServer metrics;
+    if (options.metricsPort > 0 && !metrics.start(options.metricsPort)) {
+        AsyncLog::instance().stop();
+        return 1;
+    }
+
+    Broker broker(options);
+    int status = broker.run();
+    metrics.stop();
+    AsyncLog::instance().stop();
+    return status;
+}
@@ -0,0 +1,264 @@
+// ThreadTuningBench.cpp
+//
+// Shows what ThreadTuning buys on Linux: a simulated game (render/physics
+// threads doing a fixed amount of work per frame, the first one also draining
+// NetworkManager like the dispatch hooks do) runs next to a stand-in for the
+// lws service thread, which wakes on a socket, parses frames with
+// FastJsonParser and feeds them to NetworkManager. The network thread (and
+// optionally the game threads) are placed and prioritised with ThreadTuning,
+// so runs with different settings can be compared:
+//
+//   message latency   send -> parsed and queued, and send -> dispatched on the game thread
+//   game frames       per-frame cost against the frame period (preemption shows up here)
+//
+// Builds without BakkesMod, e.g.
+//
+//   g++ -std=c++20 -O2 -DSIXMANS_HEADLESS -DSIXMANS_USE_SIMDJSON -I.. -Iheadless ThreadTuningBench.cpp
+//       ../ThreadTuning.cpp ../NetworkManager.cpp ../WebSocketClient.cpp ../EndpointProber.cpp
+//       ../AsyncLog.cpp ../FlightRecorder.cpp ../BrokerLink.cpp ../OutboundSpool.cpp ../Metrics.cpp
+//       -lwebsockets -lsimdjson -lpthread [-lrt]
+//
+// Usage: ThreadTuningBench [--seconds S] [--rate msgs/s] [--players N]
+//                          [--game-threads N] [--tick-hz N] [--load 0..1] [--game-cpus LIST]
+//                          [--net-cpus LIST] [--net-priority -2..2] [--seed N]
+//
+// Raising priority (--net-priority > 0) needs CAP_SYS_NICE; the run goes on
+// untuned if the OS refuses.
+
+#include "NetworkManager.h"
+#include "AsyncLog.h"
+#include "FastJsonParser.h"
+#include "ThreadTuning.h"
+#include "BenchStats.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    struct Options {
+        double seconds = 10.0;
+        double rate = 200.0;
+        int players = 12;
+        int gameThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        double tickHz = 120.0;
+        double load = 0.6;      // Fraction of each frame the game threads spend busy
+        std::string gameCpus;
+        std::string netCpus;
+        int netPriority = 0;
+        unsigned seed = 1;
+    };
+
+    // Frames on the socket: send time (steady clock ns) followed by the JSON text
+    struct WireHeader {
+        long long sentNs;
+    };
+
+    long long nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    // Pointless arithmetic the optimiser can't drop, standing in for game work
+    void busyFor(Clock::duration duration) {
+        static std::atomic<unsigned> sink{ 0 };
+        unsigned x = 1;
+        auto until = Clock::now() + duration;
+        while (Clock::now() < until) {
+            for (int i = 0; i < 64; ++i) {
+                x = x * 1664525u + 1013904223u;
+            }
+        }
+        sink.fetch_add(x, std::memory_order_relaxed);
+    }
+
+    std::string buildFrame(int players, int index) {
+        json message;
+        message["type"] = "lobby_action";
+        message["action"] = "join";
+        message["lobbyName"] = "sm" + std::to_string(index);
+        message["password"] = "pw";
+        json state = json::array();
+        for (int i = 0; i < players; ++i) {
+            state.push_back({ { "id", 100000 + i }, { "name", "player_" + std::to_string(i) }, { "mmr", 1000.5 + i } });
+        }
+        message["players"] = state;
+        return message.dump();
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+        if (!strcmp(argv[i], "--seconds")) options.seconds = std::atof(next());
+        else if (!strcmp(argv[i], "--rate")) options.rate = std::atof(next());
+        else if (!strcmp(argv[i], "--players")) options.players = std::atoi(next());
+        else if (!strcmp(argv[i], "--game-threads")) options.gameThreads = std::atoi(next());
+        else if (!strcmp(argv[i], "--tick-hz")) options.tickHz = std::atof(next());
+        else if (!strcmp(argv[i], "--load")) options.load = std::atof(next());
+        else if (!strcmp(argv[i], "--game-cpus")) options.gameCpus = next();
+        else if (!strcmp(argv[i], "--net-cpus")) options.netCpus = next();
+        else if (!strcmp(argv[i], "--net-priority")) options.netPriority = std::atoi(next());
+        else if (!strcmp(argv[i], "--seed")) options.seed = static_cast<unsigned>(std::atoi(next()));
+        else {
+            std::fprintf(stderr, "usage: %s [--seconds S] [--rate msgs/s] [--players N] [--game-threads N]"
+                " [--tick-hz N] [--load 0..1] [--game-cpus LIST] [--net-cpus LIST] [--net-priority -2..2]"
+                " [--seed N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (options.rate <= 0.0 || options.tickHz <= 0.0 || options.gameThreads < 1) {
+        std::fprintf(stderr, "--rate, --tick-hz and --game-threads must be positive\n");
+        return 2;
+    }
+
+    ThreadTuning netTuning = ThreadTuning::fromSettings(options.netCpus, options.netPriority);
+    ThreadTuning gameTuning = ThreadTuning::fromSettings(options.gameCpus, 0);
+
+    AsyncLog::instance().setLevel(LogLevel::Off);
+
+    auto settings = std::make_shared<SettingsSnapshot>();
+    PluginSettings pluginSettings;
+    pluginSettings.autoJoin = true;
+    settings->publish(pluginSettings);
+
+    NetworkManager network;
+    network.setSettingsSource(settings);
+
+    // Datagram-like stream so each read is one frame, like an lws receive callback
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sockets) != 0) {
+        std::perror("socketpair");
+        return 1;
+    }
+
+    std::atomic<bool> running{ true };
+    auto start = Clock::now();
+    auto end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.seconds));
+
+    // Network thread: poll, read, parse, hand to NetworkManager
+    LatencyStats receiveLatency;
+    std::thread networkThread([&]() {
+        netTuning.applyToCurrentThread("network");
+        FastJsonParser parser;
+        std::vector<char> buffer(1 << 16);
+        pollfd fd{ sockets[1], POLLIN, 0 };
+        while (running.load()) {
+            if (poll(&fd, 1, 50) <= 0) {
+                continue;
+            }
+            ssize_t n = read(sockets[1], buffer.data(), buffer.size());
+            if (n < static_cast<ssize_t>(sizeof(WireHeader))) {
+                continue;
+            }
+            WireHeader header;
+            std::memcpy(&header, buffer.data(), sizeof(header));
+            Clock::time_point sentAt{ std::chrono::nanoseconds(header.sentNs) };
+            try {
+                json message = parser.parse(buffer.data() + sizeof(header), static_cast<size_t>(n) - sizeof(header));
+                network.injectMessage(message, sentAt);
+            }
+            catch (const json::exception&) {
+                continue;
+            }
+            receiveLatency.add(Clock::now() - sentAt);
+        }
+    });
+
+    // Game threads: fixed work per frame; the first one also dispatches
+    auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / options.tickHz));
+    auto work = std::chrono::duration_cast<Clock::duration>(period * options.load);
+    std::vector<LatencyStats> frameCost(options.gameThreads);
+    std::vector<size_t> missedFrames(options.gameThreads, 0);
+    LatencyStats dispatchLatency;
+    std::vector<std::thread> gameThreads;
+    for (int index = 0; index < options.gameThreads; ++index) {
+        gameThreads.emplace_back([&, index]() {
+            gameTuning.applyToCurrentThread("game");
+            auto frameDeadline = Clock::now();
+            while (Clock::now() < end) {
+                frameDeadline += period;
+                auto frameStart = Clock::now();
+                busyFor(work);
+                if (index == 0) {
+                    for (int i = 0; i < SixMansConfig::MESSAGES_PER_TICK; ++i) {
+                        std::optional<InboundMessage> inbound = network.getNextMessage();
+                        if (!inbound) {
+                            break;
+                        }
+                        dispatchLatency.add(Clock::now() - inbound->receivedAt);
+                    }
+                }
+                auto frameEnd = Clock::now();
+                frameCost[index].add(frameEnd - frameStart);
+                if (frameEnd > frameDeadline) {
+                    ++missedFrames[index];
+                    frameDeadline = frameEnd; // Don't try to catch up, like a game would drop the frame
+                }
+                std::this_thread::sleep_until(frameDeadline);
+            }
+        });
+    }
+
+    // Server stand-in on this thread: Poisson arrivals at --rate
+    std::mt19937 rng(options.seed);
+    std::exponential_distribution<double> gap(options.rate);
+    std::vector<char> wire;
+    size_t sent = 0;
+    auto nextSend = start;
+    while (Clock::now() < end) {
+        nextSend += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(gap(rng)));
+        std::this_thread::sleep_until(nextSend);
+        std::string frame = buildFrame(options.players, static_cast<int>(sent));
+        WireHeader header{ nowNs() };
+        wire.resize(sizeof(header) + frame.size());
+        std::memcpy(wire.data(), &header, sizeof(header));
+        std::memcpy(wire.data() + sizeof(header), frame.data(), frame.size());
+        if (write(sockets[0], wire.data(), wire.size()) > 0) {
+            ++sent;
+        }
+    }
+
+    for (std::thread& thread : gameThreads) {
+        thread.join();
+    }
+    running.store(false);
+    networkThread.join();
+    close(sockets[0]);
+    close(sockets[1]);
+
+    LatencyStats allFrames;
+    size_t frames = 0, missed = 0;
+    for (int index = 0; index < options.gameThreads; ++index) {
+        frames += frameCost[index].count();
+        missed += missedFrames[index];
+    }
+
+    std::printf("%.1f s, %d game thread(s) at %.0f Hz with %.0f%% load (cpus %s), network cpus %s priority %d\n",
+        options.seconds, options.gameThreads, options.tickHz, options.load * 100.0,
+        options.gameCpus.empty() ? "any" : options.gameCpus.c_str(),
+        options.netCpus.empty() ? "any" : options.netCpus.c_str(), netTuning.priority);
+    std::printf("messages:      %zu sent, %zu queue drops\n", sent, network.getDroppedCount());
+    std::printf("game frames:   %zu, %zu over the %.2f ms period (%.3f%%)\n", frames, missed,
+        std::chrono::duration<double, std::milli>(period).count(), frames ? 100.0 * missed / frames : 0.0);
+    std::printf("latency:\n");
+    receiveLatency.print("receive");
+    dispatchLatency.print("dispatch", 1e6, "ms");
+    frameCost[0].print("game frame", 1e6, "ms");
+    for (int index = 1; index < options.gameThreads; ++index) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "worker %d", index);
+        frameCost[index].print(name, 1e6, "ms");
+    }
+    return 0;
+}
@@ -0,0 +1,259 @@
+// TickBench.cpp
+//
+// Runs the real LobbyController and NetworkManager receive path against
+// SimulatedGame and measures what they cost the game: per-tick callback time
+// against a frame budget, and how long messages wait for a tick to dispatch
+// them. Input is a synthetic, seeded message stream (or a ReplayHarness
+// corpus), so runs are reproducible. Builds without BakkesMod, e.g.
+//
+//   g++ -std=c++20 -O2 -DSIXMANS_HEADLESS -DSIXMANS_USE_SIMDJSON -I.. -Iheadless TickBench.cpp
+//       ../LobbyController.cpp ../NetworkManager.cpp ../WebSocketClient.cpp ../EndpointProber.cpp
+//       ../AsyncLog.cpp ../FlightRecorder.cpp ../ThreadTuning.cpp ../BrokerLink.cpp ../OutboundSpool.cpp
+//       ../CarSampler.cpp ../Metrics.cpp -lwebsockets -lsimdjson -lpthread [-lrt]
+//
+// --load-s S has the game finish loading S seconds in, so messages arriving
+// before that are held back by the ready gate and dispatched afterwards.
+//
+// --cars N drives N cars through the car sampler every tick, as a private
+// match that ends when the run does; its hook shows up in the profile as
+// CarSample and the stream goes to the temp directory. The sampler's worker
+// drains in real time, so stream sizes are only meaningful with --paced.
+//
+// Usage: TickBench [--seconds S] [--tick-hz N] [--rate msgs/s] [--corpus file]
+//                  [--budget-us N] [--join-delay S] [--join-failures N] [--load-s S]
+//                  [--cars N] [--paced] [--seed N]
+
+#include "SimulatedGame.h"
+#include "BenchStats.h"
+#include "LobbyController.h"
+#include "NetworkManager.h"
+#include "AsyncLog.h"
+#include "CarSampler.h"
+#include "Config.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Options {
+        double seconds = 60.0;
+        double tickHz = 120.0;
+        double rate = 20.0;
+        const char* corpus = nullptr;
+        double budgetUs = 100.0;
+        double joinDelay = 0.5;
+        int joinFailures = 0;
+        double loadSeconds = 0.0;
+        int cars = 0;
+        bool paced = false;
+        unsigned seed = 1;
+    };
+
+    struct TimedMessage {
+        double atSeconds;
+        json message;
+    };
+
+    // Mostly pings and queue chatter with the occasional join or prepare/go pair,
+    // roughly what a busy queue night looks like from one client
+    std::vector<TimedMessage> syntheticStream(const Options& options) {
+        std::vector<TimedMessage> stream;
+        std::mt19937 rng(options.seed);
+        std::exponential_distribution<double> gap(options.rate);
+        std::uniform_real_distribution<double> pick(0.0, 1.0);
+
+        int lobby = 0;
+        for (double t = gap(rng); t < options.seconds; t += gap(rng)) {
+            double r = pick(rng);
+            if (r < 0.55) {
+                stream.push_back({ t, { { "type", "ping" }, { "timestamp", static_cast<long long>(t * 1000) } } });
+            }
+            else if (r < 0.85) {
+                json players = json::array();
+                for (int i = 0; i < 6; ++i) {
+                    players.push_back({ { "id", i }, { "name", "player" + std::to_string(i) } });
+                }
+                stream.push_back({ t, { { "type", "queue_state" }, { "players", players } } });
+            }
+            else if (r < 0.95) {
+                std::string name = "sm" + std::to_string(++lobby);
+                stream.push_back({ t, { { "type", "lobby_action" }, { "action", "join" },
+                    { "lobbyName", name }, { "password", "pw" } } });
+            }
+            else {
+                std::string id = "prep" + std::to_string(++lobby);
+                stream.push_back({ t, { { "type", "lobby_prepare" }, { "prepareId", id }, { "action", "join" },
+                    { "lobbyName", "sm" + std::to_string(lobby) }, { "password", "pw" } } });
+                stream.push_back({ t + 0.5, { { "type", "lobby_action" }, { "action", "go" }, { "prepareId", id } } });
+            }
+        }
+        std::stable_sort(stream.begin(), stream.end(), [](const TimedMessage& a, const TimedMessage& b) {
+            return a.atSeconds < b.atSeconds;
+        });
+        return stream;
+    }
+
+    // ReplayHarness corpus format: {"t": ms, "frame": string or object}
+    std::vector<TimedMessage> corpusStream(const char* path) {
+        std::vector<TimedMessage> stream;
+        std::ifstream in(path);
+        std::string line;
+        double origin = -1.0;
+        while (std::getline(in, line)) {
+            try {
+                json entry = json::parse(line);
+                const json& frame = entry.at("frame");
+                double t = entry.value("t", 0.0) / 1000.0;
+                if (origin < 0.0) {
+                    origin = t;
+                }
+                stream.push_back({ t - origin, frame.is_string() ? json::parse(frame.get<std::string>()) : frame });
+            }
+            catch (const json::exception&) {
+            }
+        }
+        return stream;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+        if (!strcmp(argv[i], "--seconds")) options.seconds = std::atof(next());
+        else if (!strcmp(argv[i], "--tick-hz")) options.tickHz = std::atof(next());
+        else if (!strcmp(argv[i], "--rate")) options.rate = std::atof(next());
+        else if (!strcmp(argv[i], "--corpus")) options.corpus = next();
+        else if (!strcmp(argv[i], "--budget-us")) options.budgetUs = std::atof(next());
+        else if (!strcmp(argv[i], "--join-delay")) options.joinDelay = std::atof(next());
+        else if (!strcmp(argv[i], "--join-failures")) options.joinFailures = std::atoi(next());
+        else if (!strcmp(argv[i], "--load-s")) options.loadSeconds = std::atof(next());
+        else if (!strcmp(argv[i], "--cars")) options.cars = std::atoi(next());
+        else if (!strcmp(argv[i], "--paced")) options.paced = true;
+        else if (!strcmp(argv[i], "--seed")) options.seed = static_cast<unsigned>(std::atoi(next()));
+        else {
+            std::fprintf(stderr, "usage: %s [--seconds S] [--tick-hz N] [--rate msgs/s] [--corpus file]"
+                " [--budget-us N] [--join-delay S] [--join-failures N] [--load-s S] [--cars N] [--paced] [--seed N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (options.tickHz <= 0.0 || options.rate <= 0.0) {
+        std::fprintf(stderr, "--tick-hz and --rate must be positive\n");
+        return 2;
+    }
+
+    std::vector<TimedMessage> stream = options.corpus ? corpusStream(options.corpus) : syntheticStream(options);
+    if (options.corpus && !stream.empty()) {
+        options.seconds = std::max(options.seconds, stream.back().atSeconds + 1.0);
+    }
+
+    setHeadlessLogQuiet(true);
+    AsyncLog::instance().setLevel(LogLevel::Off);
+
+    auto settings = std::make_shared<SettingsSnapshot>();
+    PluginSettings pluginSettings;
+    pluginSettings.autoJoin = true;
+    pluginSettings.autoCreate = true;
+    settings->publish(pluginSettings);
+
+    NetworkManager network;
+    network.setSettingsSource(settings);
+
+    SimulatedGame game(options.tickHz);
+    SimulatedGame::JoinBehaviour joinBehaviour;
+    joinBehaviour.responseDelayS = options.joinDelay;
+    joinBehaviour.failuresBeforeSuccess = options.joinFailures;
+    game.setJoinBehaviour(joinBehaviour);
+    game.setReadyAt(options.loadSeconds);
+
+    LobbyController lobby(game, settings, [&network]() -> NetworkManager* { return &network; });
+    lobby.install();
+    game.emitAt("Function TAGame.GameEvent_Soccar_TA.InitGame", 0.0);
+    game.emitEvery("Function TAGame.Car_TA.SetVehicleInput", options.tickHz);
+    game.emitEvery("Function Engine.GameViewportClient.Tick", options.tickHz);
+
+    std::unique_ptr<CarSampler> carSampler;
+    if (options.cars > 0) {
+        MatchResult result;
+        result.matchGuid = "TICKBENCH";
+        result.privateMatch = true;
+        for (int i = 0; i < options.cars; ++i) {
+            PlayerResult player;
+            player.player = SimulatedGame::CAR_PLAYER_BASE + i;
+            player.name = "player" + std::to_string(i);
+            player.team = i % 2;
+            result.players.push_back(player);
+        }
+        game.setMatchResult(result);
+        carSampler = std::make_unique<CarSampler>(game, lobby.profiler(),
+            std::filesystem::temp_directory_path() / "sixmans_tickbench", []() { return std::string("tickbench"); });
+        carSampler->install();
+        game.driveCars(static_cast<size_t>(options.cars), options.tickHz);
+        game.emitAt("Function TAGame.GameEvent_Soccar_TA.EventMatchEnded", options.seconds - 0.5);
+    }
+
+    LatencyStats tickCost, queueWait;
+    lobby.setDispatchObserver([&](const InboundMessage&, IGameFacade::Clock::duration wait) {
+        queueWait.add(wait);
+    });
+
+    // Frames are stamped with their simulated arrival time, not when the loop
+    // got round to them, so queue wait is measured in simulated time
+    size_t nextMessage = 0;
+    auto feed = [&](double now) {
+        for (; nextMessage < stream.size() && stream[nextMessage].atSeconds <= now; ++nextMessage) {
+            network.injectMessage(stream[nextMessage].message, game.at(stream[nextMessage].atSeconds));
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    game.runUntil(options.seconds, options.paced, feed, [&](std::chrono::nanoseconds cost) {
+        tickCost.add(cost);
+    });
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Stopping the sampler lets its worker finish the stream
+    size_t carStreams = 0;
+    uint64_t carStreamBytes = 0;
+    if (carSampler) {
+        carSampler->stop();
+        carStreams = carSampler->getStreamCount();
+        carStreamBytes = carSampler->getBytesWritten();
+    }
+
+    size_t joins = 0, creates = 0;
+    for (const auto& call : game.matchmakingCalls()) {
+        (call.kind == SimulatedGame::MatchmakingCall::Kind::Join ? joins : creates)++;
+    }
+
+    auto budget = std::chrono::nanoseconds(static_cast<long long>(options.budgetUs * 1000));
+    size_t overBudget = tickCost.countAbove(budget);
+
+    std::printf("simulated %.1f s at %.0f Hz in %.3f s wall (%s)\n", options.seconds, options.tickHz,
+        wallSeconds, options.paced ? "paced" : "as fast as possible");
+    std::printf("messages:      %zu injected, %zu invalid, %zu filtered, %zu queue drops, %zu expired in queue\n",
+        nextMessage, network.getInvalidCount(), network.getFilteredCount(), network.getDroppedCount(),
+        lobby.getExpiredDropCount());
+    std::printf("matchmaking:   %zu joins, %zu creates, last join %lld ms\n",
+        joins, creates, lobby.getLastJoinLatencyMs());
+    std::printf("ticks:         %llu, %zu over the %.0f us budget (%.3f%%)\n",
+        static_cast<unsigned long long>(game.ticks()), overBudget, options.budgetUs,
+        tickCost.count() ? 100.0 * overBudget / tickCost.count() : 0.0);
+    if (carSampler) {
+        std::printf("car streams:   %zu from %d cars, %llu bytes (%.1f KB/min)\n", carStreams, options.cars,
+            static_cast<unsigned long long>(carStreamBytes), carStreamBytes / 1024.0 / (options.seconds / 60.0));
+    }
+    std::printf("latency:\n");
+    tickCost.print("tick cost");
+    queueWait.print("queue wait", 1e6, "ms");
+    for (const std::string& line : lobby.profiler().report()) {
+        std::printf("  %s\n", line.c_str());
+    }
+    return 0;
+}
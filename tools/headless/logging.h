@@ -0,0 +1,38 @@
+#pragma once
+
+// Stand-in for the BakkesMod template's logging.h in headless tool builds
+// (-DSIXMANS_HEADLESS -Itools/headless): same LOG/DEBUGLOG surface, written to
+// stderr, and silenced with setHeadlessLogQuiet(true).
+
+#include <atomic>
+#include <cstdio>
+#include <format>
+#include <string>
+#include <string_view>
+
+constexpr bool DEBUG_LOG = false;
+
+inline std::atomic<bool>& headlessLogQuiet() {
+    static std::atomic<bool> quiet{ false };
+    return quiet;
+}
+
+inline void setHeadlessLogQuiet(bool quiet) {
+    headlessLogQuiet().store(quiet);
+}
+
+template<typename... Args>
+void LOG(std::string_view format, Args&&... args) {
+    if (headlessLogQuiet().load(std::memory_order_relaxed)) {
+        return;
+    }
+    std::string line = std::vformat(format, std::make_format_args(args...));
+    fprintf(stderr, "%s\n", line.c_str());
+}
+
+template<typename... Args>
+void DEBUGLOG(std::string_view format, Args&&... args) {
+    if constexpr (DEBUG_LOG) {
+        LOG(format, std::forward<Args>(args)...);
+    }
+}
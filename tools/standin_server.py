@@ -0,0 +1,579 @@
+#!/usr/bin/env python3
+"""Local stand-in for the 6mans server.
+
+Speaks just enough of the plugin's protocol to run it without the real
+backend: answers auth requests (echoing requestId), ignores pongs, honours
+"subscribe", and pushes a seeded synthetic stream of lobby and queue traffic
+at --rate frames/s to every primary connection. The live queue is a real
+document: changes go out as sequenced queue_delta JSON Patches and
+queue_resync is answered with a queue_snapshot. --drop-deltas skips a
+fraction of deltas per client to exercise gap detection.
+
+Each successful auth opens (or resumes) a session. Pushed messages carry a
+per-session "sessionSeq" and stay buffered until the client acks them; while
+the client is away they keep being buffered, and an auth presenting the
+session id replays everything after the client's lastSeq. --disconnect-every
+drops primary connections on a timer to exercise that. Standard library only.
+
+Lobby actions carry a "deadline" (server epoch ms, --action-ttl seconds out)
+and client pings are answered with a pong stamped with when the server got
+the ping and when it replied, for the client's clock offset estimate.
+--clock-skew shifts the server's clock to check the estimate.
+
+A client can authenticate in its upgrade request (Authorization: Bearer,
+X-SixMans-Request-Id, X-SixMans-Resume: sessionId:lastSeq); its first frame
+is then the auth_response, carrying the live queue for a new session, with
+no extra round trip. --no-handshake-auth ignores those headers like an older
+server would. --latency-ms delays the handshake and every request by that
+much, as a stand-in for a real round trip.
+
+A connection broker (tools/SixMansBroker) upgrades with X-SixMans-Multiplex: 1
+and speaks for several instances at once: each frame carries "link": n, and
+every link is handled like a client of its own whose replies and pushes are
+tagged with its number. link_closed ends a link as a disconnect would.
+
+For each session it counts the frames and bytes it sent, the ones the
+client's subscription let it skip, and the ones replayed after a resume, and
+prints the totals every --report seconds and on disconnect. Skipped bytes are
+the inbound traffic saved by server-side filtering.
+
+Reports from the client's outbound spool carry a "spoolSeq" and are answered
+with a spool_ack. Every --report seconds it lists, per token, how many spooled
+reports arrived, how many were repeats and which numbers never did.
+--drop-spooled N aborts the connection on every Nth spooled report instead of
+taking it, as a link dropping mid-flush; the client has to send it again after
+reconnecting, so nothing should ever show up as missing.
+
+Usage: standin_server.py [--host 127.0.0.1] [--port 8080] [--rate 20]
+                         [--token TOKEN] [--seed 1] [--report 10] [--drop-deltas 0.0]
+                         [--disconnect-every 0] [--action-ttl 20] [--clock-skew 0]
+                         [--no-handshake-auth] [--latency-ms 0] [--drop-spooled 0]
+
+Point the plugin at it with: serverEndpoints ws://127.0.0.1:8080/
+"""
+
+import argparse
+import asyncio
+import base64
+import collections
+import hashlib
+import itertools
+import json
+import random
+import struct
+import time
+
+WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+OP_TEXT, OP_CLOSE, OP_PING, OP_PONG = 0x1, 0x8, 0x9, 0xA
+PING_INTERVAL_S = 60
+SESSION_TTL_S = 300      # How long a detached session is kept for resume
+REPLAY_BUFFER = 10000    # Unacked messages kept per session
+
+
+class Session:
+    ids = itertools.count(1)
+
+    def __init__(self, token):
+        self.id = f"s{next(Session.ids)}-{random.getrandbits(32):08x}"
+        self.token = token
+        self.client = None
+        self.detached_at = None
+        self.subscription = None  # None: no subscribe received, send everything
+        self.seq = 0
+        self.unacked = collections.deque(maxlen=REPLAY_BUFFER)  # (sessionSeq, message)
+        self.sent_frames = self.sent_bytes = 0
+        self.skipped_frames = self.skipped_bytes = 0
+        self.replayed_frames = 0
+
+    def wants(self, message):
+        if self.subscription is None:
+            return True
+        types, actions = self.subscription
+        if message["type"] not in types:
+            return False
+        if message["type"] in ("lobby_action", "lobby_prepare") and "action" in message:
+            return message["action"] in actions
+        return True
+
+    def stamp(self, message):
+        self.seq += 1
+        stamped = dict(message, sessionSeq=self.seq)
+        self.unacked.append((self.seq, stamped))
+        return stamped
+
+    def ack(self, seq):
+        while self.unacked and self.unacked[0][0] <= seq:
+            self.unacked.popleft()
+
+    def report(self):
+        total = self.sent_bytes + self.skipped_bytes
+        saved = 100.0 * self.skipped_bytes / total if total else 0.0
+        state = f"client {self.client.id}" if self.client else "detached"
+        return (f"session {self.id} ({state}): sent {self.sent_frames} frames / {self.sent_bytes} B, "
+                f"skipped {self.skipped_frames} frames / {self.skipped_bytes} B ({saved:.1f}% of bytes saved), "
+                f"replayed {self.replayed_frames}, {len(self.unacked)} unacked")
+
+
+class Client:
+    ids = itertools.count(1)
+
+    def __init__(self, reader, writer):
+        self.id = next(Client.ids)
+        self.reader = reader
+        self.writer = writer
+        self.role = "primary"
+        self.session = None  # Set by a successful auth
+        self.subscription = None
+
+    async def send(self, message):
+        payload = json.dumps(message, separators=(",", ":")).encode()
+        self.writer.write(encode_frame(OP_TEXT, payload))
+        await self.writer.drain()
+        return len(payload)
+
+
+class LinkClient(Client):
+    """One instance behind a broker's multiplexed connection."""
+
+    def __init__(self, reader, writer, link):
+        super().__init__(reader, writer)
+        self.link = link
+
+    async def send(self, message):
+        return await super().send(dict(message, link=self.link))
+
+
+def encode_frame(opcode, payload):
+    header = bytes([0x80 | opcode])
+    n = len(payload)
+    if n < 126:
+        header += bytes([n])
+    elif n < 1 << 16:
+        header += bytes([126]) + struct.pack(">H", n)
+    else:
+        header += bytes([127]) + struct.pack(">Q", n)
+    return header + payload
+
+
+async def read_frame(reader):
+    """One complete message as (opcode, payload); continuation frames are joined."""
+    opcode, chunks = None, []
+    while True:
+        b0, b1 = await reader.readexactly(2)
+        n = b1 & 0x7F
+        if n == 126:
+            (n,) = struct.unpack(">H", await reader.readexactly(2))
+        elif n == 127:
+            (n,) = struct.unpack(">Q", await reader.readexactly(8))
+        mask = await reader.readexactly(4) if b1 & 0x80 else None
+        data = await reader.readexactly(n)
+        if mask:
+            data = bytes(c ^ mask[i % 4] for i, c in enumerate(data))
+        frame_op = b0 & 0x0F
+        if frame_op >= 0x8:
+            return frame_op, data  # Control frames are never fragmented
+        if frame_op != 0:
+            opcode = frame_op
+        chunks.append(data)
+        if b0 & 0x80:
+            return opcode, b"".join(chunks)
+
+
+async def handshake(reader, writer, latency):
+    """Upgrade the connection; returns the request headers, or None."""
+    request = await reader.readuntil(b"\r\n\r\n")
+    headers = {}
+    for line in request.decode("latin-1").split("\r\n")[1:]:
+        if ":" in line:
+            name, value = line.split(":", 1)
+            headers[name.strip().lower()] = value.strip()
+    key = headers.get("sec-websocket-key")
+    if not key:
+        writer.write(b"HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n")
+        await writer.drain()
+        return None
+    await asyncio.sleep(latency)
+    accept = base64.b64encode(hashlib.sha1((key + WS_GUID).encode()).digest()).decode()
+    writer.write(("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                  f"Sec-WebSocket-Accept: {accept}\r\n\r\n").encode())
+    await writer.drain()
+    return headers
+
+
+def handshake_auth(token, headers):
+    """The auth message a handshake's headers stand for."""
+    message = {"type": "auth", "token": token}
+    if headers.get("x-sixmans-request-id", "").isdigit():
+        message["requestId"] = int(headers["x-sixmans-request-id"])
+    session_id, _, last_seq = headers.get("x-sixmans-resume", "").rpartition(":")
+    if session_id and last_seq.isdigit():
+        message["resume"] = {"sessionId": session_id, "lastSeq": int(last_seq)}
+    return message
+
+
+class StandinServer:
+    def __init__(self, args):
+        self.args = args
+        self.clients = set()
+        self.sessions = {}
+        self.rng = random.Random(args.seed)
+        self.loss_rng = random.Random(args.seed + 1)  # Separate so loss doesn't change the stream
+        self.lobby = 0
+        self.queue = {"status": "waiting", "players": [], "teams": {"blue": [], "orange": []}}
+        self.queue_seq = 0
+        self.next_player = 1
+        self.spooled = collections.defaultdict(collections.Counter)  # token -> spoolSeq -> times received
+        self.spooled_frames = 0
+
+    async def handle(self, reader, writer):
+        try:
+            headers = await handshake(reader, writer, self.args.latency_ms / 1000.0)
+            if headers is None:
+                return
+        except (asyncio.IncompleteReadError, ConnectionError):
+            return
+
+        if headers.get("x-sixmans-multiplex") == "1":
+            await self.handle_multiplexed(reader, writer)
+            return
+
+        client = Client(reader, writer)
+        self.clients.add(client)
+        print(f"client {client.id} connected from {writer.get_extra_info('peername')}")
+        try:
+            auth = headers.get("authorization", "")
+            if auth.startswith("Bearer ") and not self.args.no_handshake_auth:
+                await self.on_auth(client, handshake_auth(auth[len("Bearer "):], headers))
+            while True:
+                opcode, payload = await read_frame(reader)
+                if opcode == OP_CLOSE:
+                    writer.write(encode_frame(OP_CLOSE, payload[:2]))
+                    break
+                if opcode == OP_PING:
+                    writer.write(encode_frame(OP_PONG, payload))
+                    continue
+                if opcode == OP_TEXT:
+                    await self.on_message(client, payload)
+        except (asyncio.IncompleteReadError, ConnectionError):
+            pass
+        finally:
+            self.detach(client)
+            writer.close()
+
+    async def handle_multiplexed(self, reader, writer):
+        links = {}
+        print(f"broker connected from {writer.get_extra_info('peername')}")
+        try:
+            while True:
+                opcode, payload = await read_frame(reader)
+                if opcode == OP_CLOSE:
+                    writer.write(encode_frame(OP_CLOSE, payload[:2]))
+                    break
+                if opcode == OP_PING:
+                    writer.write(encode_frame(OP_PONG, payload))
+                    continue
+                if opcode != OP_TEXT:
+                    continue
+                try:
+                    message = json.loads(payload)
+                    link = message.pop("link")
+                except (ValueError, KeyError, AttributeError):
+                    print("broker: frame without a link")
+                    continue
+                if message.get("type") == "link_closed":
+                    if link in links:
+                        self.detach(links.pop(link))
+                    continue
+                client = links.get(link)
+                if client is None:
+                    client = links[link] = LinkClient(reader, writer, link)
+                    self.clients.add(client)
+                    print(f"client {client.id} is link {link} of the broker")
+                await self.on_message(client, json.dumps(message))
+        except (asyncio.IncompleteReadError, ConnectionError):
+            pass
+        finally:
+            for client in links.values():
+                self.detach(client)
+            print(f"broker disconnected, {len(links)} link(s) with it")
+            writer.close()
+
+    def detach(self, client):
+        self.clients.discard(client)
+        session = client.session
+        if session and session.client is client:
+            session.client = None
+            session.detached_at = time.monotonic()
+        print(f"client {client.id} disconnected" + (f"; {session.report()}" if session else ""))
+
+    def now_ms(self):
+        return int(time.time() * 1000 + self.args.clock_skew)
+
+    async def on_message(self, client, payload):
+        received_at = self.now_ms()
+        try:
+            message = json.loads(payload)
+        except ValueError:
+            print(f"client {client.id}: invalid JSON")
+            return
+        kind = message.get("type")
+        spool_seq = message.get("spoolSeq") if isinstance(message, dict) else None
+        if type(spool_seq) is int:
+            self.spooled_frames += 1
+            if (self.args.drop_spooled > 0 and self.spooled_frames % self.args.drop_spooled == 0
+                    and not isinstance(client, LinkClient)):  # Its broker connection serves others too
+                print(f"dropping client {client.id} on spooled report {spool_seq}")
+                client.writer.transport.abort()
+                return
+        await asyncio.sleep(self.args.latency_ms / 1000.0)
+
+        if kind == "auth":
+            await self.on_auth(client, message)
+        elif kind == "subscribe":
+            client.subscription = (set(message.get("types", [])), set(message.get("actions", [])))
+            if client.session:
+                client.session.subscription = client.subscription
+            print(f"client {client.id} subscribed to types={sorted(client.subscription[0])} "
+                  f"actions={sorted(client.subscription[1])}")
+        elif kind == "ack":
+            if client.session:
+                client.session.ack(message.get("sessionSeq", 0))
+        elif kind == "queue_resync":
+            reply = {"type": "queue_snapshot", "seq": self.queue_seq, "state": self.queue}
+            if "requestId" in message:
+                reply["requestId"] = message["requestId"]
+            await client.send(reply)
+        elif kind == "session_role":
+            client.role = message.get("role", "primary")
+        elif kind == "lobby_status":
+            reason = f" ({message['reason']})" if "reason" in message else ""
+            print(f"client {client.id}: lobby {message.get('lobbyName')} {message.get('event')}{reason}")
+        elif kind == "match_report":
+            events = message.get("events", {})
+            print(f"client {client.id}: match in {message.get('lobbyName')} ended "
+                  f"{'-'.join(map(str, message.get('score', [])))}, {len(message.get('players', []))} players, "
+                  f"{len(events.get('kind', []))} events, {len(payload)} bytes")
+        elif kind == "pong":
+            pass
+        elif kind == "ping":
+            reply = {"type": "pong", "timestamp": message.get("timestamp"), "receivedAt": received_at}
+            if "requestId" in message:
+                reply["requestId"] = message["requestId"]
+            reply["sentAt"] = self.now_ms()
+            await client.send(reply)
+        else:
+            print(f"client {client.id}: {kind}")
+
+        if type(spool_seq) is int:
+            counts = self.spooled[client.session.token if client.session else ""]
+            counts[spool_seq] += 1
+            if counts[spool_seq] > 1:
+                print(f"client {client.id}: spooled report {spool_seq} again")
+            await client.send({"type": "spool_ack", "spoolSeq": spool_seq})
+
+    async def on_auth(self, client, message):
+        token = message.get("token", "")
+        reply = {"type": "auth_response", "success": bool(token) and self.args.token in (None, token)}
+        if "requestId" in message:
+            reply["requestId"] = message["requestId"]
+        if not reply["success"]:
+            reply["error"] = "Invalid token"
+            await client.send(reply)
+            return
+
+        resume = message.get("resume") or {}
+        session = self.sessions.get(resume.get("sessionId"))
+        resumed = session is not None and session.token == token
+        if resumed:
+            if session.client and session.client is not client:
+                if not isinstance(session.client, LinkClient):  # Its broker connection serves others too
+                    session.client.writer.close()  # The old connection is a zombie
+                session.detached_at = time.monotonic()
+            session.ack(resume.get("lastSeq", 0))
+            session.client = None
+        else:
+            session = Session(token)
+            session.detached_at = time.monotonic()
+            self.sessions[session.id] = session
+        if client.session and client.session is not session:
+            client.session.client = None
+            client.session.detached_at = time.monotonic()
+        if client.subscription is not None:
+            session.subscription = client.subscription
+        client.session = session
+
+        reply.update(sessionId=session.id, resumed=resumed)
+        if not resumed:
+            reply["queue"] = {"seq": self.queue_seq, "state": self.queue}  # Saves the client a queue_resync
+        await client.send(reply)
+
+        # Replay before attaching, including whatever is stamped while we do,
+        # so the client sees every sessionSeq in order
+        sent_through = resume.get("lastSeq", 0) if resumed else session.seq
+        replayed = 0
+        while True:
+            batch = [entry for entry in session.unacked if entry[0] > sent_through]
+            if not batch:
+                break
+            for seq, buffered in batch:
+                session.sent_bytes += await client.send(buffered)
+                sent_through = seq
+                replayed += 1
+        session.replayed_frames += replayed
+        session.client, session.detached_at = client, None
+        if resumed:
+            print(f"client {client.id} resumed {session.id}, replayed {replayed} frames")
+
+    def queue_delta(self):
+        """Advance the queue one step; returns the RFC 6902 ops that did it."""
+        queue = self.queue
+        if queue["status"] == "picking":
+            queue["status"] = "in_match"
+            ops = [{"op": "replace", "path": "/status", "value": "in_match"}]
+        elif queue["status"] == "in_match":
+            queue.update(status="waiting", players=[], teams={"blue": [], "orange": []})
+            ops = [{"op": "replace", "path": "/status", "value": "waiting"},
+                   {"op": "replace", "path": "/players", "value": []},
+                   {"op": "replace", "path": "/teams", "value": {"blue": [], "orange": []}}]
+        elif queue["players"] and self.rng.random() < 0.3:
+            index = self.rng.randrange(len(queue["players"]))
+            del queue["players"][index]
+            ops = [{"op": "remove", "path": f"/players/{index}"}]
+        else:
+            player = {"id": self.next_player, "name": f"player{self.next_player}"}
+            self.next_player += 1
+            queue["players"].append(player)
+            ops = [{"op": "add", "path": "/players/-", "value": player}]
+            if len(queue["players"]) == 6:
+                names = [p["name"] for p in queue["players"]]
+                self.rng.shuffle(names)
+                queue["status"] = "picking"
+                queue["teams"] = {"blue": names[:3], "orange": names[3:]}
+                ops += [{"op": "replace", "path": "/status", "value": "picking"},
+                        {"op": "replace", "path": "/teams", "value": queue["teams"]}]
+        self.queue_seq += 1
+        return {"type": "queue_delta", "seq": self.queue_seq, "patch": ops}
+
+    def next_messages(self):
+        """Queue deltas, chatter the plugin never acts on, and the occasional lobby."""
+        r = self.rng.random()
+        if r < 0.55:
+            return [self.queue_delta()]
+        if r < 0.85:
+            return [{"type": "announcement", "text": "Queue night starts at 8pm EST, bring a friend!",
+                     "channel": self.rng.choice(["general", "queue", "results"])}]
+        self.lobby += 1
+        action = "join" if r < 0.95 else "create"
+        deadline = self.now_ms() + int(self.args.action_ttl * 1000)  # The lobby fills or times out by then
+        if self.rng.random() < 0.5:
+            return [{"type": "lobby_action", "action": action, "lobbyName": f"sm{self.lobby}", "password": "pw",
+                     "deadline": deadline}]
+        prepare_id = f"prep{self.lobby}"
+        return [{"type": "lobby_prepare", "prepareId": prepare_id, "action": action,
+                 "lobbyName": f"sm{self.lobby}", "password": "pw", "deadline": deadline},
+                {"type": "lobby_action", "action": "go", "prepareId": prepare_id, "deadline": deadline}]
+
+    async def broadcast(self, message):
+        size = len(json.dumps(message, separators=(",", ":")))
+        now = time.monotonic()
+        for session in list(self.sessions.values()):
+            client = session.client
+            if client is None and now - session.detached_at > SESSION_TTL_S:
+                del self.sessions[session.id]
+                continue
+            if client is not None and client.role == "standby":
+                continue
+            if not session.wants(message):
+                session.skipped_frames += 1
+                session.skipped_bytes += size
+                continue
+            if message["type"] == "queue_delta" and self.loss_rng.random() < self.args.drop_deltas:
+                continue  # Simulated loss; the client sees a seq gap and resyncs
+
+            # Buffered even while detached, so a resume can replay it
+            stamped = session.stamp(message)
+            if client is None:
+                continue
+            try:
+                session.sent_bytes += await client.send(stamped)
+                session.sent_frames += 1
+            except ConnectionError:
+                pass
+
+    async def stream(self):
+        while True:
+            await asyncio.sleep(self.rng.expovariate(self.args.rate))
+            for message in self.next_messages():
+                await self.broadcast(message)
+
+    async def pinger(self):
+        while True:
+            await asyncio.sleep(PING_INTERVAL_S)
+            for client in list(self.clients):
+                try:
+                    await client.send({"type": "ping", "timestamp": self.now_ms()})
+                except ConnectionError:
+                    pass
+
+    def spool_report(self, token, counts):
+        missing = [seq for seq in range(min(counts), max(counts) + 1) if seq not in counts]
+        repeats = sum(counts.values()) - len(counts)
+        label = hashlib.sha1(token.encode()).hexdigest()[:8]
+        return (f"spooled reports from token {label}: {len(counts)} received, {repeats} repeated, "
+                f"{len(missing)} missing" + (f" {missing[:20]}" if missing else ""))
+
+    async def reporter(self):
+        while True:
+            await asyncio.sleep(self.args.report)
+            for session in list(self.sessions.values()):
+                print(session.report())
+            for token, counts in self.spooled.items():
+                print(self.spool_report(token, counts))
+
+    async def disconnector(self):
+        if self.args.disconnect_every <= 0:
+            return
+        while True:
+            await asyncio.sleep(self.args.disconnect_every)
+            for client in list(self.clients):
+                if client.role != "standby" and not client.writer.transport.is_closing():
+                    print(f"dropping client {client.id}")
+                    client.writer.transport.abort()
+
+
+async def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--rate", type=float, default=20.0, help="synthetic frames per second")
+    parser.add_argument("--token", help="only accept this token (default: any non-empty token)")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--report", type=float, default=10.0, help="seconds between traffic reports")
+    parser.add_argument("--drop-deltas", type=float, default=0.0, help="fraction of queue deltas to drop")
+    parser.add_argument("--disconnect-every", type=float, default=0.0,
+                        help="drop primary connections every N seconds (0: never)")
+    parser.add_argument("--action-ttl", type=float, default=20.0,
+                        help="seconds until a lobby action's deadline")
+    parser.add_argument("--clock-skew", type=float, default=0.0,
+                        help="milliseconds added to the server's clock")
+    parser.add_argument("--no-handshake-auth", action="store_true",
+                        help="ignore auth headers in the upgrade request")
+    parser.add_argument("--latency-ms", type=float, default=0.0,
+                        help="delay before answering the handshake and each request")
+    parser.add_argument("--drop-spooled", type=int, default=0,
+                        help="abort the connection on every Nth spooled report (0: never)")
+    args = parser.parse_args()
+
+    server = StandinServer(args)
+    listener = await asyncio.start_server(server.handle, args.host, args.port)
+    print(f"stand-in server on ws://{args.host}:{args.port}/")
+    async with listener:
+        await asyncio.gather(listener.serve_forever(), server.stream(), server.pinger(), server.reporter(),
+                             server.disconnector())
+
+
+if __name__ == "__main__":
+    try:
+        asyncio.run(main())
+    except KeyboardInterrupt:
+        pass